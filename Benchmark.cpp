@@ -0,0 +1,614 @@
+#include "RoboSim.hpp"
+#include "LoadBots.hpp"
+#include "PlayerRoster.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmark: microbenchmarks for the simulator's hot paths.<br>
+ * Each case runs for a fixed time budget and reports nanoseconds and heap
+ * allocations per operation as one JSON object per line, so runs can be
+ * diffed and compared.
+ *
+ * Usage: benchmark [--sizes 20,64,256,1024] [--densities 0,10,30]
+ *                  [--robots 5,50] [--layouts maze,dense,corridors,forts]
+ *                  [--loads demo,path,world,radio,build]
+ *                  [--budget SECONDS] [--filter NAME]
+ *
+ * Sizes are arena side lengths, densities are percentages of the arena
+ * covered with walls, and robot counts are per player.  The scenario case
+ * plays each generated layout (see Scenario) with both teams made of each
+ * load bot profile (see LoadBots.hpp).  The robotPool case compares robots
+ * kept in a RobotPool (see PlayerRoster.hpp) with robots made with plain
+ * new, as both teams' robots die and are replaced.  Full-world cases on 4096x4096
+ * arenas need several gigabytes of memory.
+ */
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using namespace robot_api;
+
+/*/**********************************************
+ * Allocation counting
+ ***********************************************/
+
+//Atomic, as simultaneous time steps allocate on several threads
+static std::atomic<unsigned long long> allocations(0);
+
+void* operator new(std::size_t size)
+{
+     allocations++;
+     if(void* to_return = std::malloc(size ? size : 1))
+          return to_return;
+     throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+     std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+     std::free(ptr);
+}
+
+namespace
+{
+     typedef std::chrono::steady_clock Clock;
+
+     struct Settings
+     {
+          vector<int> sizes = { 20, 64, 256, 1024 };
+          vector<int> densities = { 0, 10, 30 };
+          vector<int> robots = { 5, 50 };
+          vector<string> layouts = { "maze", "dense", "corridors", "forts" };
+          vector<string> loads = { "demo", "path", "world", "radio", "build" };
+          double budget = 0.25;
+          string filter;
+     };
+
+     /**Accumulates the cost of the operations being measured*/
+     struct Meter
+     {
+          long long ops = 0;
+          long long nanoseconds = 0;
+          unsigned long long allocations = 0;
+
+          template<class Op>
+          void time(Op op)
+               {
+                    const unsigned long long allocations_before = ::allocations;
+                    const Clock::time_point start = Clock::now();
+                    op();
+                    nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now()-start).count();
+                    allocations += ::allocations - allocations_before;
+                    ops++;
+               }
+     };
+
+     void report(const string& name, int size, int density, int robots, const Meter& meter, bool turns, const string& fields = "")
+     {
+          const double ns_per_op = meter.ops ? static_cast<double>(meter.nanoseconds)/meter.ops : 0;
+          cout << "{\"benchmark\":\"" << name << "\"" << fields << ",\"size\":" << size << ",\"density\":" << density << ",\"robots\":" << robots
+               << ",\"ops\":" << meter.ops << ",\"ns_per_op\":" << ns_per_op
+               << ",\"allocs_per_op\":" << (meter.ops ? static_cast<double>(meter.allocations)/meter.ops : 0);
+          if(turns)
+               cout << ",\"turns_per_sec\":" << (ns_per_op ? 1e9/ns_per_op : 0);
+          cout << '}' << endl;
+     }
+
+     int obstaclesFor(int size, int density)
+     {
+          return static_cast<long long>(size)*size*density/100;
+     }
+
+     bool overBudget(const Settings& settings, Clock::time_point start)
+     {
+          return std::chrono::duration<double>(Clock::now()-start).count() >= settings.budget;
+     }
+
+     /**
+      * Robot that runs benchmark code instead of playing.  Measurements
+      * of WorldAPI calls have to be taken from inside act(), since that's
+      * the only place a WorldAPI exists.
+      */
+     class ProbeBot : public Robot
+     {
+     public:
+          typedef std::function<void(WorldAPI&, const Robot_Status&)> Probe;
+
+     private:
+          Robot_Specs specs;
+          const Probe& probe;
+
+     public:
+          ProbeBot(Robot_Specs specs_, const Probe& probe_) : specs(specs_), probe(probe_) { }
+
+          Robot_Specs createRobot(WorldAPI* api, int skill_points, vector<uint8_t> message) { return specs; }
+
+          void act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t> > received_radio) { probe(api,status); }
+     };
+
+     /**Runs simulations of two teams of probe robots until the time budget
+      * is spent, or until the probe stops finding anything to measure*/
+     void runProbes(const Settings& settings, int size, int density, int robots, Robot_Specs specs, const ProbeBot::Probe& probe, const Meter& meter)
+     {
+          const Clock::time_point start = Clock::now();
+          const int skill_points = specs.attack + specs.defense + specs.power + specs.charge;
+          for(std::uint64_t seed=1; !overBudget(settings,start); seed++)
+          {
+               RoboSim sim(robots,skill_points,size,size,obstaclesFor(size,density),2,
+                           [&specs,&probe](int player) { return new ProbeBot(specs,probe); },
+                           seed);
+               const long long ops_before = meter.ops;
+               for(int turn=0; turn<100 && !overBudget(settings,start); turn++)
+                    if(sim.executeSingleTimeStep()!=-1)
+                         break;
+
+               //Nothing left to measure in this layout
+               if(meter.ops==ops_before && seed > 10)
+                    break;
+          }
+     }
+
+     /*/**********************************************
+      * Cases
+      ***********************************************/
+
+     void benchTimeStep(const Settings& settings, int size, int density, int robots)
+     {
+          Meter meter;
+          const Clock::time_point start = Clock::now();
+          for(std::uint64_t seed=1; !overBudget(settings,start); seed++)
+          {
+               RoboSim sim(robots,20,size,size,obstaclesFor(size,density),seed);
+               int winner = -1;
+               for(int turn=0; turn<200 && winner==-1 && !overBudget(settings,start); turn++)
+                    meter.time([&] { winner = sim.executeSingleTimeStep(); });
+          }
+          report("executeSingleTimeStep",size,density,robots,meter,true);
+     }
+
+     /**The same matches as executeSingleTimeStep, with the robots' act()
+      * called directly, as for robots of player_config.hpp's types, and
+      * through their vtables, as for robots made any other way*/
+     void benchDispatch(const Settings& settings, int size, int density, int robots)
+     {
+          Meter direct;
+          Meter virtual_call;
+          const RoboSim::RobotFactory plain = [](int player) -> Robot*
+               {
+                    if(player==1)
+                         return new DemoBot();
+                    return new DefenderBot();
+               };
+          const Clock::time_point start = Clock::now();
+          for(std::uint64_t seed=1; !overBudget(settings,start); seed++)
+          {
+               RoboSim roster(robots,20,size,size,obstaclesFor(size,density),seed);
+               RoboSim other(robots,20,size,size,obstaclesFor(size,density),2,plain,seed);
+               int winner = -1;
+               for(int turn=0; turn<200 && winner==-1 && !overBudget(settings,start); turn++)
+               {
+                    direct.time([&] { winner = roster.executeSingleTimeStep(); });
+                    virtual_call.time([&] { other.executeSingleTimeStep(); });
+               }
+          }
+          report("executeSingleTimeStep_dispatch",size,density,robots,direct,true,",\"dispatch\":\"direct\"");
+          report("executeSingleTimeStep_dispatch",size,density,robots,virtual_call,true,",\"dispatch\":\"virtual\"");
+     }
+
+     void benchSimultaneous(const Settings& settings, int size, int density, int robots)
+     {
+          Meter meter;
+          const Clock::time_point start = Clock::now();
+          for(std::uint64_t seed=1; !overBudget(settings,start); seed++)
+          {
+               RoboSim sim(robots,20,size,size,obstaclesFor(size,density),seed);
+               sim.setSimultaneousMoves(true);
+               int winner = -1;
+               for(int turn=0; turn<200 && winner==-1 && !overBudget(settings,start); turn++)
+                    meter.time([&] { winner = sim.executeSingleTimeStep(); });
+          }
+          report("simultaneousTimeStep",size,density,robots,meter,true);
+     }
+
+     void benchScenario(const Settings& settings, Scenario::Layout layout, const string& load, int size, int robots)
+     {
+          Meter meter;
+          const Clock::time_point start = Clock::now();
+          for(std::uint64_t seed=1; !overBudget(settings,start); seed++)
+          {
+               RoboSim sim(Scenario::generate(layout,size,size,2,robots,seed),20,
+                           [&load](int player) { return constructLoadBot(load); },
+                           seed);
+               int winner = -1;
+               for(int turn=0; turn<200 && winner==-1 && !overBudget(settings,start); turn++)
+                    meter.time([&] { winner = sim.executeSingleTimeStep(); });
+          }
+          report("scenario",size,layout==Scenario::DENSE ? Scenario::DEFAULT_DENSITY : 0,robots,meter,true,string(",\"layout\":\"") + Scenario::layoutName(layout) + "\",\"load\":\"" + load + "\"");
+     }
+
+     void benchShortestPath(const Settings& settings, int size, int density)
+     {
+          RoboSim sim(1,20,size,size,obstaclesFor(size,density),1);
+          vector<vector<GridCell> > grid = sim.getWorldGrid();
+
+          Xoshiro256 random(1);
+          Meter meter;
+          const Clock::time_point start = Clock::now();
+          while(!overBudget(settings,start))
+          {
+               GridCell& origin = grid[random.below(size)][random.below(size)];
+               GridCell& target = grid[random.below(size)][random.below(size)];
+               if(origin.contents!=EMPTY || target.contents!=EMPTY)
+                    continue;
+               meter.time([&] { RobotUtility::findShortestPath(origin,target,grid); });
+          }
+          report("findShortestPath",size,density,0,meter,false);
+     }
+
+     void benchNearestAlly(const Settings& settings, int size, int density, int robots)
+     {
+          RoboSim sim(robots,20,size,size,obstaclesFor(size,density),1);
+          vector<vector<GridCell> > grid = sim.getWorldGrid();
+          vector<GridCell*> origins;
+          for(vector<GridCell>& column : grid)
+               for(GridCell& cell : column)
+                    if(cell.contents==SELF)
+                         origins.push_back(&cell);
+
+          Meter meter;
+          const Clock::time_point start = Clock::now();
+          for(int i=0; !overBudget(settings,start); i++)
+               meter.time([&] { RobotUtility::findNearestAlly(*origins[i%origins.size()],grid); });
+          report("findNearestAlly",size,density,robots,meter,false);
+     }
+
+     void benchNeighborhood(const Settings& settings, int size, int density, int robots)
+     {
+          Meter meter;
+          const ProbeBot::Probe probe = [&meter](WorldAPI& api, const Robot_Status& status)
+               {
+                    meter.time([&] { api.getVisibleNeighborhood(); });
+               };
+          runProbes(settings,size,density,robots,Robot_Specs{5,5,5,5},probe,meter);
+          report("getVisibleNeighborhood",size,density,robots,meter,false);
+     }
+
+     void benchWorld(const Settings& settings, int size, int density, int robots)
+     {
+          Meter meter;
+          const ProbeBot::Probe probe = [&meter](WorldAPI& api, const Robot_Status& status)
+               {
+                    meter.time([&] { api.getWorld(3); });
+               };
+          runProbes(settings,size,density,robots,Robot_Specs{5,5,5,5},probe,meter);
+          report("getWorld",size,density,robots,meter,false);
+     }
+
+     void benchDeath(const Settings& settings, int size, int density, int robots)
+     {
+          //Every hit kills (10 health, 1 defense), so only hits are counted
+          Meter meter;
+          const ProbeBot::Probe probe = [&meter](WorldAPI& api, const Robot_Status& status)
+               {
+                    vector<vector<GridCell> > neighbors = api.getVisibleNeighborhood();
+                    GridCell* self = NULL;
+                    for(vector<GridCell>& column : neighbors)
+                         for(GridCell& cell : column)
+                              if(cell.contents==SELF)
+                                   self = &cell;
+                    for(vector<GridCell>& column : neighbors)
+                         for(GridCell& cell : column)
+                              if(cell.contents==ENEMY && std::abs(cell.x_coord-self->x_coord)+std::abs(cell.y_coord-self->y_coord)==1)
+                              {
+                                   Meter attack;
+                                   AttackResult result;
+                                   attack.time([&] { result = api.meleeAttack(1,cell); });
+                                   if(result==DESTROYED_TARGET)
+                                   {
+                                        meter.ops++;
+                                        meter.nanoseconds += attack.nanoseconds;
+                                        meter.allocations += attack.allocations;
+                                   }
+                                   return;
+                              }
+               };
+          runProbes(settings,size,density,robots,Robot_Specs{10,1,10,1},probe,meter);
+          report("processAttack_death",size,density,robots,meter,false);
+     }
+
+     void benchBroadcast(const Settings& settings, int size, int density, int robots)
+     {
+          Meter meter;
+          const vector<uint8_t> message(64);
+          const ProbeBot::Probe probe = [&meter,&message](WorldAPI& api, const Robot_Status& status)
+               {
+                    meter.time([&] { api.sendMessage(message,2); });
+               };
+          runProbes(settings,size,density,robots,Robot_Specs{5,5,5,5},probe,meter);
+          report("sendMessage_broadcast",size,density,robots,meter,false);
+     }
+
+     void benchRefusal(const Settings& settings, int size, int density, int robots)
+     {
+          //Moving farther than the arena is long is always refused
+          Meter thrown;
+          Meter returned;
+          const ProbeBot::Probe probe = [&thrown,&returned,size](WorldAPI& api, const Robot_Status& status)
+               {
+                    thrown.time([&]
+                         {
+                              try
+                              {
+                                   api.move(2*size,LEFT);
+                              }
+                              catch(RoboSimExecutionException&)
+                              {
+                              }
+                         });
+                    returned.time([&] { api.try_move(2*size,LEFT); });
+               };
+          runProbes(settings,size,density,robots,Robot_Specs{5,5,5,5},probe,thrown);
+          report("refusedMove_throw",size,density,robots,thrown,false);
+          report("refusedMove_try",size,density,robots,returned,false);
+     }
+
+     typedef PlayerRoster<DemoBot, DefenderBot> PoolRoster;
+
+     /**Saves a robot's state, called as the robot's own type*/
+     struct StateSaver
+     {
+          vector<uint8_t>& state;
+
+          template<class T>
+          void operator()(T& robot)
+               {
+                    state.clear();
+                    robot.saveState(state);
+               }
+     };
+
+     /**Both teams' robots (DemoBots and DefenderBots), with robots dying
+      * and being replaced among other allocations (as they are in a
+      * match), made by make: the cost of replacing one, and of a pass
+      * calling a virtual function of each (as a time step calls act()),
+      * through its vtable or, if direct, as its own type through
+      * PlayerRoster::visit()*/
+     void benchRobotPool(const Settings& settings, int robots, const char* allocator, const RoboSim::RobotFactory& make, bool direct)
+     {
+          const int clutter_size = RadioMessage::SIZE;
+          vector<Robot*> live;
+          vector<int> types;
+          vector<vector<uint8_t> > clutter;
+          for(int i=0; i<2*robots; i++)
+          {
+               live.push_back(make(i%2+1));
+               types.push_back(PoolRoster::typeOf(*live.back()));
+               clutter.emplace_back(clutter_size);
+          }
+
+          Xoshiro256 random(1);
+          Meter replaced;
+          Meter dispatched;
+          vector<uint8_t> state;
+          StateSaver saver{state};
+          const Clock::time_point start = Clock::now();
+          while(!overBudget(settings,start))
+          {
+               for(int i=0; i<int(live.size()); i++)
+               {
+                    const int dead = random.below(live.size());
+                    replaced.time([&]
+                         {
+                              delete live[dead];
+                              live[dead] = make(dead%2+1);
+                         });
+                    types[dead] = PoolRoster::typeOf(*live[dead]);
+                    clutter[random.below(clutter.size())].assign(clutter_size,0);
+               }
+               if(direct)
+                    dispatched.time([&]
+                         {
+                              for(int i=0; i<int(live.size()); i++)
+                                   PoolRoster::visit(types[i],*live[i],saver);
+                         });
+               else
+                    dispatched.time([&]
+                         {
+                              for(Robot* robot : live)
+                              {
+                                   state.clear();
+                                   robot->saveState(state);
+                              }
+                         });
+          }
+          for(Robot* robot : live)
+               delete robot;
+
+          const string fields = string(",\"allocator\":\"") + allocator + "\",\"dispatch\":\"" + (direct ? "direct" : "virtual") + '"';
+          report("robotPool_replace",0,0,robots,replaced,false,fields);
+          report("robotPool_dispatch",0,0,robots,dispatched,false,fields);
+     }
+
+     /*/**********************************************
+      * Driver
+      ***********************************************/
+
+     bool parseNames(const char* arg, vector<string>& out)
+     {
+          std::istringstream in(arg);
+          string item;
+          out.clear();
+          while(std::getline(in,item,','))
+               out.push_back(item);
+          return !out.empty();
+     }
+
+     bool parseList(const char* arg, vector<int>& out)
+     {
+          std::istringstream in(arg);
+          string item;
+          out.clear();
+          while(std::getline(in,item,','))
+          {
+               const int value = std::atoi(item.c_str());
+               if(value < 0)
+                    return false;
+               out.push_back(value);
+          }
+          return !out.empty();
+     }
+
+     bool parseArgs(int argc, const char** argv, Settings& settings)
+     {
+          for(int i=1; i<argc; i+=2)
+          {
+               if(i+1==argc)
+                    return false;
+               const char* flag = argv[i];
+               const char* value = argv[i+1];
+               if(!std::strcmp(flag,"--sizes"))
+               {
+                    if(!parseList(value,settings.sizes))
+                         return false;
+               }
+               else if(!std::strcmp(flag,"--densities"))
+               {
+                    if(!parseList(value,settings.densities))
+                         return false;
+               }
+               else if(!std::strcmp(flag,"--robots"))
+               {
+                    if(!parseList(value,settings.robots))
+                         return false;
+               }
+               else if(!std::strcmp(flag,"--layouts"))
+               {
+                    Scenario::Layout layout;
+                    if(!parseNames(value,settings.layouts))
+                         return false;
+                    for(const string& name : settings.layouts)
+                         if(!Scenario::layoutFromName(name,layout))
+                              return false;
+               }
+               else if(!std::strcmp(flag,"--loads"))
+               {
+                    if(!parseNames(value,settings.loads))
+                         return false;
+                    for(const string& name : settings.loads)
+                    {
+                         Robot* robot = constructLoadBot(name);
+                         if(robot==NULL)
+                              return false;
+                         delete robot;
+                    }
+               }
+               else if(!std::strcmp(flag,"--budget"))
+                    settings.budget = std::atof(value);
+               else if(!std::strcmp(flag,"--filter"))
+                    settings.filter = value;
+               else
+                    return false;
+          }
+          return settings.budget > 0;
+     }
+
+     bool wanted(const Settings& settings, const string& name)
+     {
+          return settings.filter.empty() || name.find(settings.filter)!=string::npos;
+     }
+}
+
+int main(int argc, const char** argv)
+{
+     Settings settings;
+     if(!parseArgs(argc,argv,settings))
+     {
+          cerr << "Usage: " << argv[0] << " [--sizes 20,64,256,1024] [--densities 0,10,30] [--robots 5,50]\n"
+               << "       [--layouts maze,dense,corridors,forts] [--loads demo,path,world,radio,build]\n"
+               << "       [--budget SECONDS] [--filter NAME]" << endl;
+          return 1;
+     }
+
+     for(int size : settings.sizes)
+          for(int density : settings.densities)
+          {
+               if(wanted(settings,"findShortestPath"))
+                    benchShortestPath(settings,size,density);
+               for(int robots : settings.robots)
+               {
+                    //Robots need room to be placed
+                    if(2*robots + obstaclesFor(size,density) >= size*size)
+                         continue;
+
+                    if(wanted(settings,"executeSingleTimeStep"))
+                         benchTimeStep(settings,size,density,robots);
+                    if(wanted(settings,"executeSingleTimeStep_dispatch"))
+                         benchDispatch(settings,size,density,robots);
+                    if(wanted(settings,"simultaneousTimeStep"))
+                         benchSimultaneous(settings,size,density,robots);
+                    if(wanted(settings,"findNearestAlly"))
+                         benchNearestAlly(settings,size,density,robots);
+                    if(wanted(settings,"getVisibleNeighborhood"))
+                         benchNeighborhood(settings,size,density,robots);
+                    if(wanted(settings,"getWorld"))
+                         benchWorld(settings,size,density,robots);
+                    if(wanted(settings,"processAttack_death"))
+                         benchDeath(settings,size,density,robots);
+                    if(wanted(settings,"sendMessage_broadcast"))
+                         benchBroadcast(settings,size,density,robots);
+                    if(wanted(settings,"refusedMove"))
+                         benchRefusal(settings,size,density,robots);
+               }
+          }
+
+     if(wanted(settings,"robotPool"))
+          for(int robots : settings.robots)
+          {
+               const RoboSim::RobotFactory plain = [](int player) -> Robot*
+                    {
+                         if(player==1)
+                              return new DemoBot();
+                         return new DefenderBot();
+                    };
+               benchRobotPool(settings,robots,"new",plain,false);
+               benchRobotPool(settings,robots,"pool",PoolRoster::construct,false);
+               benchRobotPool(settings,robots,"pool",PoolRoster::construct,true);
+          }
+
+     if(wanted(settings,"scenario"))
+          for(int size : settings.sizes)
+               for(const string& name : settings.layouts)
+                    for(const string& load : settings.loads)
+                         for(int robots : settings.robots)
+                         {
+                              Scenario::Layout layout;
+                              Scenario::layoutFromName(name,layout);
+                              try
+                              {
+                                   benchScenario(settings,layout,load,size,robots);
+                              }
+                              catch(std::invalid_argument&)
+                              {
+                                   //Robots don't fit in this layout at this size
+                              }
+                         }
+     return 0;
+}
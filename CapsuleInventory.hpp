@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace robot_api
+{
+     /**
+      * CapsuleInventory: the energy capsules a robot holds.<br>
+      * Capsules of the same power are interchangeable, so the inventory
+      * keeps a count per power rather than a list of capsules: checking
+      * for, adding and removing a capsule take constant time, and copying
+      * an inventory allocates nothing.  Powers below SMALL_POWERS (which
+      * covers any capsule a robot with fewer than SMALL_POWERS points of
+      * attack plus defense can use) are counted in place; the rare more
+      * powerful ones are kept in a list on the side.<br>
+      * Iterating over the inventory visits every capsule's power, lowest
+      * first, so code written for a list of powers still works.
+      */
+     class CapsuleInventory
+     {
+     public:
+          static const int SMALL_POWERS = 64;
+
+     private:
+          std::uint16_t counts[SMALL_POWERS];
+          int total;
+
+          //Capsules of power SMALL_POWERS or more, in no particular order
+          std::vector<int> large;
+
+     public:
+          /**Iterates over capsule powers, lowest first*/
+          class const_iterator
+          {
+          private:
+               friend class CapsuleInventory;
+
+               const CapsuleInventory* inventory;
+
+               //Power whose capsules we're visiting (SMALL_POWERS once
+               //we've reached the large ones), and which one
+               int power;
+               int copy;
+
+               const_iterator(const CapsuleInventory* inventory_, int power_, int copy_) : inventory(inventory_), power(power_), copy(copy_) { skipEmpty(); }
+
+               void skipEmpty()
+                    {
+                         while(power < SMALL_POWERS && copy==inventory->counts[power])
+                         {
+                              power++;
+                              copy = 0;
+                         }
+                    }
+
+          public:
+               typedef std::forward_iterator_tag iterator_category;
+               typedef int value_type;
+               typedef std::ptrdiff_t difference_type;
+               typedef const int* pointer;
+               typedef int reference;
+
+               int operator*() const { return power < SMALL_POWERS ? power : inventory->large[copy]; }
+               const_iterator& operator++() { copy++; skipEmpty(); return *this; }
+               const_iterator operator++(int) { const_iterator to_return = *this; ++*this; return to_return; }
+               bool operator==(const const_iterator& other) const { return power==other.power && copy==other.copy; }
+               bool operator!=(const const_iterator& other) const { return !(*this==other); }
+          };
+
+          CapsuleInventory() : total(0) { std::fill(counts,counts+SMALL_POWERS,0); }
+
+          const_iterator begin() const { return const_iterator(this,0,0); }
+          const_iterator end() const { return const_iterator(this,SMALL_POWERS,large.size()); }
+
+          /**@return number of capsules held*/
+          int size() const { return total; }
+
+          bool empty() const { return total==0; }
+
+          /**@return number of capsules held of the given power*/
+          int count(int power) const
+               {
+                    if(power < 0)
+                         return 0;
+                    if(power < SMALL_POWERS)
+                         return counts[power];
+                    return std::count(large.begin(),large.end(),power);
+               }
+
+          /**@return whether a capsule of the given power is held*/
+          bool has(int power) const { return count(power)!=0; }
+
+          /**Adds a capsule of the given power (which must not be negative)*/
+          void add(int power)
+               {
+                    if(power < SMALL_POWERS)
+                         counts[power]++;
+                    else
+                         large.push_back(power);
+                    total++;
+               }
+
+          /**Removes a capsule of the given power
+           * @return whether there was one to remove*/
+          bool remove(int power)
+               {
+                    if(power < 0)
+                         return false;
+                    if(power < SMALL_POWERS)
+                    {
+                         if(counts[power]==0)
+                              return false;
+                         counts[power]--;
+                    }
+                    else
+                    {
+                         auto it = std::find(large.begin(),large.end(),power);
+                         if(it==large.end())
+                              return false;
+                         *it = large.back();
+                         large.pop_back();
+                    }
+                    total--;
+                    return true;
+               }
+
+          void clear()
+               {
+                    std::fill(counts,counts+SMALL_POWERS,0);
+                    total = 0;
+                    large.clear();
+               }
+     };
+}
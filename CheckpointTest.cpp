@@ -0,0 +1,195 @@
+#include "DemoBot.hpp"
+#include "RoboSim.hpp"
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * CheckpointTest: checks that RoboSim refuses corrupt checkpoints.<br>
+ * Plays a few turns, takes a checkpoint, and restores it as it is and with
+ * each of a list of corruptions (values out of range, robots sharing a
+ * cell or missing from theirs, truncation...).  The checkpoint as it is
+ * must restore to the same state; every corrupted one must be refused
+ * with a RoboSimExecutionException rather than crash the simulator later.
+ * Prints a line per case and exits with 1 if any failed.
+ *
+ * Usage: checkpoint_test
+ */
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using robot_api::RoboSimExecutionException;
+
+namespace
+{
+     const int LENGTH = 20;
+     const int WIDTH = 20;
+
+     //Where things are in a checkpoint (see RoboSim::saveCheckpoint())
+     const int NUM_PLAYERS_AT = 8;
+     const int LENGTH_AT = 88;
+     const int WIDTH_AT = 92;
+     const int CELLS_AT = 96;
+     const int CELL_BYTES = 4;
+
+     /**Offsets of a robot's fields in a checkpoint*/
+     struct RobotFields
+     {
+          int assoc_cell;
+          int what_building;
+          int invested_assoc_cell;
+          int radio_messages;
+          int state_size; //-1 if the robot saved no state
+     };
+
+     struct Layout
+     {
+          int turn_order_pos;
+          vector<RobotFields> robots;
+     };
+
+     int integerAt(const string& data, int pos)
+     {
+          int value;
+          std::memcpy(&value,data.data()+pos,sizeof(value));
+          return value;
+     }
+
+     void setInteger(string& data, int pos, int value)
+     {
+          std::memcpy(&data[pos],&value,sizeof(value));
+     }
+
+     Layout layoutOf(const string& data)
+     {
+          Layout layout;
+          int pos = CELLS_AT + LENGTH*WIDTH*CELL_BYTES;
+          layout.turn_order_pos = pos;
+          const int robots = integerAt(data,pos+4);
+          pos += 8;
+          for(int i=0; i<robots; i++)
+          {
+               RobotFields x;
+               x.assoc_cell = pos+4;
+
+               //player, assoc_cell, specs and status
+               pos += 10*4;
+               pos += 4 + 4*integerAt(data,pos);
+               x.what_building = pos;
+               x.invested_assoc_cell = pos+8;
+               x.radio_messages = pos+12;
+               pos += 12;
+               const int messages = integerAt(data,pos);
+               pos += 4 + messages*(4+RadioMessage::SIZE);
+               const bool saved = integerAt(data,pos);
+               pos += 4;
+               x.state_size = saved ? pos : -1;
+               if(saved)
+                    pos += 4 + integerAt(data,pos);
+               layout.robots.push_back(x);
+          }
+          return layout;
+     }
+
+     RoboSim* restore(const string& data)
+     {
+          std::istringstream in(data);
+          return new RoboSim(in,[](int player) { return new DemoBot(); });
+     }
+
+     string checkpointOf(const RoboSim& sim)
+     {
+          std::ostringstream out;
+          sim.saveCheckpoint(out);
+          return out.str();
+     }
+
+     struct Corruption
+     {
+          const char* name;
+          std::function<void(string& data, const Layout& layout)> apply;
+     };
+}
+
+int main()
+{
+     RoboSim sim(5,20,LENGTH,WIDTH,30,2,[](int player) { return new DemoBot(); },7);
+     for(int i=0; i<5; i++)
+          sim.executeSingleTimeStep();
+     const string original = checkpointOf(sim);
+     const Layout layout = layoutOf(original);
+
+     int failures = 0;
+     {
+          bool same = false;
+          try
+          {
+               RoboSim* const restored = restore(original);
+               same = checkpointOf(*restored)==original;
+               delete restored;
+          }
+          catch(RoboSimExecutionException e)
+          {
+               cout << e.msg << endl;
+          }
+          cout << (same ? "ok   " : "FAIL ") << "intact checkpoint restores as it was" << endl;
+          failures += !same;
+     }
+
+     //A cell that's neither a robot's nor an obstacle, to mark
+     int empty_cell = 0;
+     while((original[CELLS_AT+empty_cell*CELL_BYTES] & 0xF)!=robot_api::EMPTY)
+          empty_cell++;
+     const int robot_cell = integerAt(original,layout.robots[0].assoc_cell);
+
+     //State a robot saved, to claim is huge
+     int state_size = -1;
+     for(const RobotFields& x : layout.robots)
+          if(state_size==-1)
+               state_size = x.state_size;
+
+     const Corruption corruptions[] =
+     {
+          { "no players", [](string& data, const Layout& layout) { setInteger(data,NUM_PLAYERS_AT,0); } },
+          { "contents past CAPSULE", [](string& data, const Layout& layout) { data[CELLS_AT] = 0xF; } },
+          { "ALLY in the world", [](string& data, const Layout& layout) { data[CELLS_AT] = robot_api::ALLY; } },
+          { "fort orientation out of range", [](string& data, const Layout& layout) { data[CELLS_AT] = robot_api::FORT | 5 << 4; } },
+          { "turn order position out of range", [](string& data, const Layout& layout) { setInteger(data,layout.turn_order_pos,-1); } },
+          { "build target out of range", [](string& data, const Layout& layout) { setInteger(data,layout.robots[0].what_building,99); } },
+          { "build cell past the end", [](string& data, const Layout& layout) { setInteger(data,layout.robots[0].invested_assoc_cell,LENGTH*WIDTH); } },
+          { "build cell before -1", [](string& data, const Layout& layout) { setInteger(data,layout.robots[0].invested_assoc_cell,-2); } },
+          { "negative radio message count", [](string& data, const Layout& layout) { setInteger(data,layout.robots[0].radio_messages,-1); } },
+          { "robots sharing a cell", [](string& data, const Layout& layout) { setInteger(data,layout.robots[1].assoc_cell,integerAt(data,layout.robots[0].assoc_cell)); } },
+          { "robot in a cell not marked SELF", [robot_cell](string& data, const Layout& layout) { data[CELLS_AT+robot_cell*CELL_BYTES] = robot_api::EMPTY; } },
+          { "SELF cell without a robot", [empty_cell](string& data, const Layout& layout) { data[CELLS_AT+empty_cell*CELL_BYTES] = robot_api::SELF; } },
+          { "truncated", [](string& data, const Layout& layout) { data.resize(data.size()-1); } },
+          { "robot state longer than the checkpoint", [state_size](string& data, const Layout& layout) { setInteger(data,state_size,0x7fffffff); } },
+          { "grid larger than the checkpoint", [](string& data, const Layout& layout) { setInteger(data,LENGTH_AT,0x10000); setInteger(data,WIDTH_AT,0x7fff); } },
+          { "grid cell count overflowing", [](string& data, const Layout& layout) { setInteger(data,LENGTH_AT,0x10000); setInteger(data,WIDTH_AT,0x10000); } },
+     };
+     for(const Corruption& x : corruptions)
+     {
+          string data = original;
+          x.apply(data,layout);
+          bool refused = false;
+          try
+          {
+               delete restore(data);
+          }
+          catch(RoboSimExecutionException e)
+          {
+               refused = true;
+          }
+          cout << (refused ? "ok   " : "FAIL ") << x.name << " is refused" << endl;
+          failures += !refused;
+     }
+
+     return failures ? 1 : 0;
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "Robot.hpp"
 #include <iostream>
 
@@ -36,6 +38,14 @@ public:
                return to_return;
           }
 
+     bool saveState(vector<uint8_t>& state)
+          {
+               saveSpecs(my_specs,state);
+               return true;
+          }
+
+     void loadState(const vector<uint8_t>& state) { loadSpecs(state,my_specs); }
+
      void act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t>> received_radio)
           {
                int remaining_power = status.power;
@@ -47,14 +57,9 @@ public:
                     int repair_amount = (my_specs.charge*10 - status.health) * 2;
                     if(repair_amount > status.power)
                          repair_amount = status.power - status.power%2;
-                    try
-                    {
-                         api.repair(repair_amount);
-                    }
-                    catch(RoboSimExecutionException e)
-                    {
-                         cerr << e.msg << endl;
-                    }
+                    const ActionResult repaired = api.try_repair(repair_amount);
+                    if(!repaired)
+                         cerr << repaired.message() << endl;
                     remaining_power-=repair_amount;
                     remaining_charge-=repair_amount;
                }
@@ -75,13 +80,10 @@ public:
 
                //Any remaining power we put toward defense
                if(remaining_power > 0)
-                    try
-                    {
-                         api.defend((remaining_power <= my_specs.defense) ? remaining_power : my_specs.defense);
-                    }
-                    catch(RoboSimExecutionException e)
-                    {
-                         cerr << e.msg << endl;
-                    }
+               {
+                    const ActionResult defended = api.try_defend((remaining_power <= my_specs.defense) ? remaining_power : my_specs.defense);
+                    if(!defended)
+                         cerr << defended.message() << endl;
+               }
           }
 };
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "Robot.hpp"
 
 #include <cmath>
@@ -46,6 +48,14 @@ public:
                return to_return;
           }
 
+     bool saveState(vector<uint8_t>& state)
+          {
+               saveSpecs(my_specs,state);
+               return true;
+          }
+
+     void loadState(const vector<uint8_t>& state) { loadSpecs(state,my_specs); }
+
 private:
      static bool isAdjacent(const GridCell& c1, const GridCell& c2)
           {
@@ -62,7 +72,7 @@ private:
                     for(int j=0; j<neighbors[0].size(); j++)
                          if(neighbors[i][j].contents==ENEMY)
                          {
-                              auto path = RobotUtility::findShortestPath(self,neighbors[i][j],neighbors);
+                              auto path = RobotUtility::findShortestPathCells(self,neighbors[i][j],neighbors);
                               if(path.size())
                               {
                                    auto end_pos = path.end();
@@ -94,6 +104,7 @@ private:
                return remaining_power;
           }
 
+public:
      void act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t>> received_radio)
           {
                int remaining_power = status.power;
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace robot_api
+{
+     using std::uint32_t;
+     using std::vector;
+
+     /**
+      * LandmarkTable: precomputed distances for ALT (A*, landmarks,
+      * triangle inequality) heuristics.<br>
+      * Holds the distance from each of a few landmark cells to every cell
+      * of a grid, computed with walls and forts as the only obstacles.
+      * Since robots, capsules, and construction sites only ever make the
+      * real grid harder to cross, the triangle inequality over these
+      * distances gives a lower bound on the length of any real path, for
+      * as long as no wall or fort has been removed since the table was
+      * built.  Cells are identified by index x*width+y, as in WorldGrid.
+      */
+     class LandmarkTable
+     {
+     private:
+          int length_;
+          int width_;
+          vector<int> landmarks;
+          vector<std::uint8_t> open;
+
+          //distances[k*size+cell] is the distance from landmark k to cell, or -1
+          vector<int> distances;
+
+          void distancesFrom(int landmark, int* row, vector<int>& queue) const
+               {
+                    const int size = length_*width_;
+                    std::fill(row,row+size,-1);
+                    int head = 0;
+                    int tail = 0;
+                    row[landmark] = 0;
+                    queue[tail++] = landmark;
+                    while(head!=tail)
+                    {
+                         const int current = queue[head++];
+
+                         //Closed cells can be reached, but not crossed
+                         if(!open[current])
+                              continue;
+
+                         const int x = current / width_;
+                         const int y = current % width_;
+                         const int adjacent[4] = { x!=0 ? current-width_ : -1,
+                                                   x!=length_-1 ? current+width_ : -1,
+                                                   y!=0 ? current-1 : -1,
+                                                   y!=width_-1 ? current+1 : -1 };
+                         for(int next : adjacent)
+                              if(next!=-1 && row[next]==-1)
+                              {
+                                   row[next] = row[current]+1;
+                                   queue[tail++] = next;
+                              }
+                    }
+               }
+
+     public:
+          LandmarkTable() : length_(0), width_(0) { }
+
+          bool empty() const { return landmarks.empty(); }
+          int length() const { return length_; }
+          int width() const { return width_; }
+
+          /**
+           * (Re)computes the table.  Landmarks are picked greedily within the
+           * largest region of connected open cells, each one as far as
+           * possible from the ones already chosen, which puts them around
+           * the edges of the map where they do the most good.
+           * @param length extent of x coordinate of grid
+           * @param width extent of y coordinate of grid
+           * @param count maximum number of landmarks to use
+           * @param isOpen callable taking a cell index: is this cell free of
+           *               walls and forts?
+           */
+          template<class IsOpen>
+          void build(int length, int width, int count, IsOpen isOpen)
+               {
+                    const int size = length*width;
+                    length_ = length;
+                    width_ = width;
+                    landmarks.clear();
+                    open.resize(size);
+                    for(int i=0; i<size; i++)
+                         open[i] = isOpen(i);
+
+                    if(count < 1)
+                    {
+                         distances.clear();
+                         return;
+                    }
+
+                    vector<int> queue(size);
+                    vector<int> nearest(size,-1);
+
+                    //Landmarks go in the largest region of open cells, so sealed
+                    //pockets don't use them up (nearest[] holds region labels here)
+                    int start = -1;
+                    int start_region_size = 0;
+                    for(int i=0; i<size; i++)
+                    {
+                         if(!open[i] || nearest[i]!=-1)
+                              continue;
+                         int head = 0;
+                         int tail = 0;
+                         nearest[i] = i;
+                         queue[tail++] = i;
+                         while(head!=tail)
+                         {
+                              const int current = queue[head++];
+                              const int x = current / width_;
+                              const int y = current % width_;
+                              const int adjacent[4] = { x!=0 ? current-width_ : -1,
+                                                        x!=length_-1 ? current+width_ : -1,
+                                                        y!=0 ? current-1 : -1,
+                                                        y!=width_-1 ? current+1 : -1 };
+                              for(int next : adjacent)
+                                   if(next!=-1 && open[next] && nearest[next]==-1)
+                                   {
+                                        nearest[next] = i;
+                                        queue[tail++] = next;
+                                   }
+                         }
+                         if(tail > start_region_size)
+                         {
+                              start = i;
+                              start_region_size = tail;
+                         }
+                    }
+                    if(start==-1)
+                    {
+                         distances.clear();
+                         return;
+                    }
+
+                    distances.assign(size_t(count)*size,-1);
+
+                    //nearest[cell]: distance to closest landmark so far (-1: not reachable)
+                    distancesFrom(start,&nearest[0],queue);
+                    for(int k=0; k<count; k++)
+                    {
+                         int best = -1;
+                         int best_distance = 0;
+                         for(int i=0; i<size; i++)
+                              if(open[i] && nearest[i] > best_distance)
+                              {
+                                   best = i;
+                                   best_distance = nearest[i];
+                              }
+                         if(best==-1)
+                              break;
+
+                         int* row = &distances[size_t(k)*size];
+                         distancesFrom(best,row,queue);
+                         landmarks.push_back(best);
+                         for(int i=0; i<size; i++)
+                              if(row[i]!=-1 && (k==0 || row[i] < nearest[i]))
+                                   nearest[i] = row[i];
+                    }
+                    distances.resize(landmarks.size()*size);
+               }
+
+          /**
+           * @param from index of an open cell
+           * @param target index of any cell
+           * @return lower bound on the length of a path from from to target
+           */
+          int lowerBound(int from, int target) const
+               {
+                    const int size = length_*width_;
+                    const bool target_open = open[target];
+                    int best = 0;
+                    for(int k=0; k<int(landmarks.size()); k++)
+                    {
+                         const int from_distance = distances[size_t(k)*size+from];
+                         const int target_distance = distances[size_t(k)*size+target];
+                         if(from_distance==-1 || target_distance==-1)
+                              continue;
+
+                         //d(L,t) <= d(L,from) + d(from,t)
+                         if(target_distance-from_distance > best)
+                              best = target_distance-from_distance;
+
+                         //d(from,L) <= d(from,t) + d(t,L), which needs d symmetric at t
+                         if(target_open && from_distance-target_distance > best)
+                              best = from_distance-target_distance;
+                    }
+                    return best;
+               }
+     };
+
+     /**
+      * PathSearch: allocation-free searches over a grid.<br>
+      * Holds scratch buffers which are reused from one search to the next:
+      * a generation-stamped visited array (so nothing has to be cleared
+      * between searches), parent and cost arrays, the breadth-first search
+      * queue and the A* open list.  The buffers grow to the size of the
+      * largest grid searched and are then never reallocated.<br>
+      * Cells are identified by index x*width+y, as in WorldGrid.  The
+      * results of a search (distanceTo(), pathTo()) remain valid until the
+      * next search with the same PathSearch object.
+      */
+     class PathSearch
+     {
+     private:
+          /**Entry in the A* open list*/
+          struct OpenEntry
+          {
+               int estimate;
+               int cost;
+               int cell;
+
+               /**Heap order: lowest estimate first, deepest first among equals*/
+               bool operator<(const OpenEntry& other) const
+                    {
+                         if(estimate!=other.estimate)
+                              return estimate > other.estimate;
+                         if(cost!=other.cost)
+                              return cost < other.cost;
+                         return cell > other.cell;
+                    }
+          };
+
+          vector<uint32_t> visited;
+          vector<int> parent;
+          vector<int> cost;
+          vector<int> frontier;
+          vector<OpenEntry> open_list;
+          uint32_t generation;
+
+          void prepare(int size)
+               {
+                    if(visited.size() < size_t(size))
+                    {
+                         visited.assign(size,0);
+                         parent.resize(size);
+                         cost.resize(size);
+                         frontier.resize(size);
+                         generation = 0;
+                    }
+
+                    //When the stamp wraps, stale stamps could look current again
+                    if(++generation==0)
+                    {
+                         visited.assign(visited.size(),0);
+                         generation = 1;
+                    }
+               }
+
+     public:
+          PathSearch() : generation(0) { }
+
+          /**@return scratch buffers private to the calling thread*/
+          static PathSearch& forThisThread()
+               {
+                    static thread_local PathSearch scratch;
+                    return scratch;
+               }
+
+          /**
+           * Breadth-first search from origin to the nearest target.<br>
+           * Neighbors are visited in the order (-1,0),(1,0),(0,-1),(0,1), so
+           * ties between equally short paths are broken the same way every
+           * time.  The origin itself may be impassable; a target is always
+           * enterable even if it is not passable.
+           * @param length extent of x coordinate of grid
+           * @param width extent of y coordinate of grid
+           * @param origin index of starting cell
+           * @param isTarget callable taking a cell index: is this cell a destination?
+           * @param isPassable callable taking a cell index: may a path cross this cell?
+           * @return index of the target found, or -1 if none is reachable
+           */
+          template<class IsTarget, class IsPassable>
+          int breadthFirst(int length, int width, int origin, IsTarget isTarget, IsPassable isPassable)
+               {
+                    prepare(length*width);
+
+                    //Each cell enters the queue at most once, so the queue never wraps
+                    int head = 0;
+                    int tail = 0;
+                    visited[origin] = generation;
+                    parent[origin] = -1;
+                    frontier[tail++] = origin;
+
+                    while(head!=tail)
+                    {
+                         const int current = frontier[head++];
+                         if(isTarget(current))
+                              return current;
+
+                         const int x = current / width;
+                         const int y = current % width;
+                         const int adjacent[4] = { x!=0 ? current-width : -1,
+                                                   x!=length-1 ? current+width : -1,
+                                                   y!=0 ? current-1 : -1,
+                                                   y!=width-1 ? current+1 : -1 };
+                         for(int next : adjacent)
+                         {
+                              if(next==-1 || visited[next]==generation)
+                                   continue;
+                              if(!isPassable(next) && !isTarget(next))
+                                   continue;
+                              visited[next] = generation;
+                              parent[next] = current;
+                              frontier[tail++] = next;
+                         }
+                    }
+
+                    return -1;
+               }
+
+          /**
+           * A* search from origin to a single target.<br>
+           * The heuristic must never overestimate the number of steps left
+           * and must be consistent (differ by at most 1 between adjacent
+           * cells); then the path found is a shortest one.  The origin
+           * itself may be impassable; the target is always enterable even
+           * if it is not passable.
+           * @param length extent of x coordinate of grid
+           * @param width extent of y coordinate of grid
+           * @param origin index of starting cell
+           * @param target index of ending cell
+           * @param isPassable callable taking a cell index: may a path cross this cell?
+           * @param heuristic callable taking a cell index: lower bound on
+           *                  steps from that cell to target
+           * @return target, or -1 if it is not reachable
+           */
+          template<class IsPassable, class Heuristic>
+          int aStar(int length, int width, int origin, int target, IsPassable isPassable, Heuristic heuristic)
+               {
+                    prepare(length*width);
+                    open_list.clear();
+
+                    visited[origin] = generation;
+                    parent[origin] = -1;
+                    cost[origin] = 0;
+                    OpenEntry first = { heuristic(origin), 0, origin };
+                    open_list.push_back(first);
+
+                    while(!open_list.empty())
+                    {
+                         std::pop_heap(open_list.begin(),open_list.end());
+                         const OpenEntry current = open_list.back();
+                         open_list.pop_back();
+
+                         //Skip entries superseded by a cheaper route
+                         if(current.cost!=cost[current.cell])
+                              continue;
+                         if(current.cell==target)
+                              return target;
+
+                         const int x = current.cell / width;
+                         const int y = current.cell % width;
+                         const int adjacent[4] = { x!=0 ? current.cell-width : -1,
+                                                   x!=length-1 ? current.cell+width : -1,
+                                                   y!=0 ? current.cell-1 : -1,
+                                                   y!=width-1 ? current.cell+1 : -1 };
+                         for(int next : adjacent)
+                         {
+                              if(next==-1 || (next!=target && !isPassable(next)))
+                                   continue;
+                              const int next_cost = current.cost+1;
+                              if(visited[next]==generation && cost[next] <= next_cost)
+                                   continue;
+                              visited[next] = generation;
+                              parent[next] = current.cell;
+                              cost[next] = next_cost;
+                              OpenEntry entry = { next_cost+heuristic(next), next_cost, next };
+                              open_list.push_back(entry);
+                              std::push_heap(open_list.begin(),open_list.end());
+                         }
+                    }
+
+                    return -1;
+               }
+
+          /**
+           * A* search using the Manhattan distance as the heuristic, tightened
+           * with a landmark table if one is given.
+           * @param landmarks landmark table for this grid, or NULL
+           * @see aStar()
+           */
+          template<class IsPassable>
+          int aStar(int length, int width, int origin, int target, IsPassable isPassable, const LandmarkTable* landmarks)
+               {
+                    const int target_x = target / width;
+                    const int target_y = target % width;
+                    if(landmarks==NULL || landmarks->empty())
+                         return aStar(length,width,origin,target,isPassable,[=](int cell)
+                                      {
+                                           return std::abs(cell/width - target_x) + std::abs(cell%width - target_y);
+                                      });
+
+                    return aStar(length,width,origin,target,isPassable,[=](int cell)
+                                 {
+                                      const int manhattan = std::abs(cell/width - target_x) + std::abs(cell%width - target_y);
+                                      const int alt = landmarks->lowerBound(cell,target);
+                                      return alt > manhattan ? alt : manhattan;
+                                 });
+               }
+
+          /**
+           * @param cell index of cell reached by the last search
+           * @return number of steps from the origin to cell
+           */
+          int distanceTo(int cell) const
+               {
+                    int steps = 0;
+                    for(int i=parent[cell]; i!=-1; i=parent[i])
+                         steps++;
+                    return steps;
+               }
+
+          /**
+           * @param cell index of cell reached by the last search
+           * @return index of the cell before it on the path, or -1 for the origin
+           */
+          int parentOf(int cell) const { return parent[cell]; }
+
+          /**
+           * Reconstructs the path found by the last search.
+           * @param cell index of cell reached by the last search
+           * @param out filled in with the indices of the cells on the path,
+           *            from the origin (exclusive) to cell (inclusive)
+           */
+          void pathTo(int cell, vector<int>& out) const
+               {
+                    out.resize(distanceTo(cell));
+                    for(int i=out.size()-1; i>=0; i--)
+                    {
+                         out[i] = cell;
+                         cell = parent[cell];
+                    }
+               }
+     };
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "robot_api.hpp"
+#include "SharedWorld.hpp"
+#include "WorldGrid.hpp"
+
+namespace robot_api
+{
+     /**
+      * GridView: read-only window onto the simulator's world, as seen by
+      * one player.<br>
+      * Nothing is copied when a view is made: each cell is read out of the
+      * world and sanitized (robots become ALLY or ENEMY, the robot the view
+      * was made for becomes SELF) when it is accessed.  Cells are addressed
+      * relative to the window, so view.cell(i,j) corresponds to
+      * grid[i][j] of the vector<vector<GridCell> > the equivalent copying
+      * WorldAPI call returns.<br>
+      * A view always shows the world as it is <i>now</i>, so it reflects
+      * the robot's own actions; it is only valid during the act() call in
+      * which it was obtained.<br>
+      * In a robot worker process, views read the SharedWorld the
+      * simulator publishes instead, whose cells are already sanitized.
+      */
+     class GridView
+     {
+     private:
+          const WorldGrid* world;
+          const SharedWorld* shared;
+          const RobotData* self;
+          int player;
+          int x_left;
+          int y_up;
+          int length_;
+          int width_;
+          int world_width;
+
+          int worldIndex(int i, int j) const { return (x_left+i)*world_width + y_up+j; }
+
+     public:
+          GridView() : world(NULL), shared(NULL), self(NULL), player(0), x_left(0), y_up(0), length_(0), width_(0), world_width(0) { }
+
+          /**
+           * Creates a view of part of the world
+           * @param world_ world to view
+           * @param self_ robot to show as SELF (may be null)
+           * @param player_ player whose robots are shown as ALLY
+           * @param x_left_ world x coordinate of the window's first column
+           * @param y_up_ world y coordinate of the window's first row
+           * @param length_in extent of window in x
+           * @param width_in extent of window in y
+           */
+          GridView(const WorldGrid& world_, const RobotData* self_, int player_, int x_left_, int y_up_, int length_in, int width_in)
+               : world(&world_), shared(NULL), self(self_), player(player_), x_left(x_left_), y_up(y_up_), length_(length_in), width_(width_in), world_width(world_.width()) { }
+
+          /**Creates a view of part of a shared world (see GridView(const
+           * WorldGrid&,const RobotData*,int,int,int,int,int))*/
+          GridView(const SharedWorld& shared_, int x_left_, int y_up_, int length_in, int width_in)
+               : world(NULL), shared(&shared_), self(NULL), player(0), x_left(x_left_), y_up(y_up_), length_(length_in), width_(width_in), world_width(shared_.width()) { }
+
+          /**@return extent of the window in x*/
+          int length() const { return length_; }
+
+          /**@return extent of the window in y*/
+          int width() const { return width_; }
+
+          /**@return world x coordinate of column 0 of the window*/
+          int xOffset() const { return x_left; }
+
+          /**@return world y coordinate of row 0 of the window*/
+          int yOffset() const { return y_up; }
+
+          /**@return whether window-relative [i][j] is inside the window*/
+          bool inBounds(int i, int j) const { return i >= 0 && i < length_ && j >= 0 && j < width_; }
+
+          /**@return sanitized contents of window-relative cell [i][j]*/
+          GridObject contents(int i, int j) const
+               {
+                    const int idx = worldIndex(i,j);
+                    if(shared)
+                         return shared->contents(idx);
+                    const GridObject to_return = world->contents(idx);
+                    if(to_return!=SELF)
+                         return to_return;
+                    const RobotData* occupant = world->occupant(idx);
+                    if(occupant==self)
+                         return SELF;
+                    return occupant->player==player ? ALLY : ENEMY;
+               }
+
+          /**@return sanitized copy of window-relative cell [i][j], with
+           *         world coordinates*/
+          GridCell cell(int i, int j) const
+               {
+                    const int idx = worldIndex(i,j);
+                    GridCell to_return;
+                    to_return.x_coord = x_left+i;
+                    to_return.y_coord = y_up+j;
+                    to_return.contents = contents(i,j);
+                    to_return.fort_orientation = shared ? shared->fortOrientation(idx) : world->fortOrientation(idx);
+                    to_return.capsule_power = shared ? shared->capsulePower(idx) : world->capsulePower(idx);
+                    to_return.has_private_members = false;
+                    to_return.occupant_data = NULL;
+                    to_return.wallforthealth = 0;
+                    return to_return;
+               }
+
+          /**
+           * Copies the view in the layout the copying WorldAPI calls use
+           * @param out filled in with a [length][width] copy of the view
+           */
+          void copyTo(vector<vector<GridCell> >& out) const
+               {
+                    out.resize(length_);
+                    for(int i=0; i<length_; i++)
+                    {
+                         out[i].resize(width_);
+                         for(int j=0; j<width_; j++)
+                              out[i][j] = cell(i,j);
+                    }
+               }
+     };
+}
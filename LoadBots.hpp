@@ -0,0 +1,191 @@
+#pragma once
+
+#include "Robot.hpp"
+#include "DemoBot.hpp"
+#include "DefenderBot.hpp"
+#include "Random.hpp"
+
+#include <iostream>
+#include <string>
+
+using std::cerr;
+using std::endl;
+
+/*
+ * Load bots: robots with known, extreme usage profiles, for stress testing
+ * the simulator rather than for winning.  Each one leans on a single part
+ * of the engine as hard as the rules allow:
+ *  - PathBot walks to random destinations, planning a path across the
+ *    whole world every turn
+ *  - SurveyorBot asks for a copy of the whole world several times a turn
+ *  - RadioBot broadcasts to its whole team as often as it has power
+ *  - BuilderBot spends everything on building robots, so teams grow until
+ *    the map is full
+ * They never attack, so matches between them don't end on their own.
+ */
+
+/**Base for the load bots: balanced specs, like DemoBot's.  They use robot
+ * interface version 2, so the simulator's cost of calling them isn't
+ * mixed up with copying their arguments.*/
+class LoadBot : public RobotV2
+{
+protected:
+     Robot_Specs my_specs;
+
+     //Finds our own cell, in world coordinates
+     static GridCell findSelf(WorldAPI& api)
+          {
+               const GridView neighbors = api.getVisibleNeighborhoodView();
+               for(int i=0; i<neighbors.length(); i++)
+                    for(int j=0; j<neighbors.width(); j++)
+                         if(neighbors.contents(i,j)==SELF)
+                              return neighbors.cell(i,j);
+               return neighbors.cell(0,0);
+          }
+
+public:
+     Robot_Specs createRobot(WorldAPI* api, int skill_points, MessageView message)
+          {
+               my_specs.attack = my_specs.defense = my_specs.power = my_specs.charge = skill_points/4;
+               my_specs.charge += skill_points%4;
+               return my_specs;
+          }
+};
+
+class PathBot : public LoadBot
+{
+private:
+     std::uint64_t turns = 0;
+
+public:
+     void act(WorldAPI& api, const Robot_Status& status, const RadioInbox& received_radio)
+          {
+               try
+               {
+                    GridCell self = findSelf(api);
+                    const GridView world = api.getWorldView(3);
+
+                    //Destinations depend only on where we are and when, so
+                    //runs are reproducible
+                    Xoshiro256 random((static_cast<std::uint64_t>(self.x_coord) << 40) ^ (static_cast<std::uint64_t>(self.y_coord) << 20) ^ turns++);
+                    GridCell target = world.cell(random.below(world.length()),random.below(world.width()));
+                    if(target.contents!=EMPTY)
+                         return;
+
+                    int remaining_power = status.power;
+                    for(Direction way : RobotUtility::findShortestPathDirections(self,target,world))
+                    {
+                         if(remaining_power==0)
+                              break;
+                         api.move(1,way);
+                         remaining_power--;
+                    }
+               }
+               catch(RoboSimExecutionException e)
+               {
+                    cerr << e.msg << endl;
+               }
+          }
+};
+
+class SurveyorBot : public LoadBot
+{
+public:
+     void act(WorldAPI& api, const Robot_Status& status, const RadioInbox& received_radio)
+          {
+               try
+               {
+                    for(int i=0; i+3<=status.power; i+=3)
+                         api.getWorld(3);
+               }
+               catch(RoboSimExecutionException e)
+               {
+                    cerr << e.msg << endl;
+               }
+          }
+};
+
+class RadioBot : public LoadBot
+{
+public:
+     void act(WorldAPI& api, const Robot_Status& status, const RadioInbox& received_radio)
+          {
+               vector<uint8_t> message(64);
+               try
+               {
+                    for(int i=0; i+2<=status.power; i+=2)
+                    {
+                         message[0] = i;
+                         api.sendMessage(message,2);
+                    }
+               }
+               catch(RoboSimExecutionException e)
+               {
+                    cerr << e.msg << endl;
+               }
+          }
+};
+
+class BuilderBot : public LoadBot
+{
+public:
+     //Enough for a robot with one point in each skill
+     static const int CHILD_COST = 4*20;
+
+     void act(WorldAPI& api, const Robot_Status& status, const RadioInbox& received_radio)
+          {
+               try
+               {
+                    //Done with the last one?  Finish it (starting the next
+                    //one finalizes it).
+                    if(api.getBuildStatus()==ROBOT && api.getInvestedBuildPower() >= CHILD_COST)
+                         api.setBuildTarget(NOTHING,NULL);
+
+                    if(api.getBuildStatus()==NOTHING)
+                    {
+                         const GridView neighbors = api.getVisibleNeighborhoodView();
+                         const GridCell self = findSelf(api);
+                         static const int dx[4] = { 0, 0, -1, 1 };
+                         static const int dy[4] = { -1, 1, 0, 0 };
+                         for(int i=0; i<4; i++)
+                         {
+                              const int x = self.x_coord+dx[i]-neighbors.xOffset();
+                              const int y = self.y_coord+dy[i]-neighbors.yOffset();
+                              if(neighbors.inBounds(x,y) && neighbors.contents(x,y)==EMPTY)
+                              {
+                                   GridCell site = neighbors.cell(x,y);
+                                   api.setBuildTarget(ROBOT,&site);
+                                   break;
+                              }
+                         }
+                    }
+
+                    if(api.getBuildStatus()==ROBOT)
+                         api.build(status.power);
+               }
+               catch(RoboSimExecutionException e)
+               {
+                    cerr << e.msg << endl;
+               }
+          }
+};
+
+/**@param profile one of "demo", "defender", "path", "world", "radio" or
+ *                "build"
+ * @return new robot with that profile, or NULL if there's no such profile*/
+inline Robot* constructLoadBot(const std::string& profile)
+{
+     if(profile=="demo")
+          return new DemoBot();
+     if(profile=="defender")
+          return new DefenderBot();
+     if(profile=="path")
+          return new PathBot();
+     if(profile=="world")
+          return new SurveyorBot();
+     if(profile=="radio")
+          return new RadioBot();
+     if(profile=="build")
+          return new BuilderBot();
+     return NULL;
+}
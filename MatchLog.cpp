@@ -0,0 +1,601 @@
+#include "MatchLog.hpp"
+
+using std::int64_t;
+using std::string;
+using std::uint64_t;
+
+using robot_api::RoboSimExecutionException;
+
+namespace match_log
+{
+     static const char MAGIC[4] = { 'R', 'P', 'W', 'L' };
+     static const int FORMAT_VERSION = 1;
+
+     /*/**********************************************
+      * LogWriter
+      ***********************************************/
+
+     LogWriter::LogWriter(std::ostream& out_, const MatchSettings& settings) : out(out_)
+     {
+          out.write(MAGIC,sizeof(MAGIC));
+          integer(FORMAT_VERSION);
+          integer(settings.initial_robots_per_combatant);
+          integer(settings.skill_points);
+          integer(settings.length);
+          integer(settings.width);
+          integer(settings.obstacles);
+          integer(settings.players);
+          integer(static_cast<int64_t>(settings.seed));
+     }
+
+     void LogWriter::integer(int64_t value)
+     {
+          //Zigzag, so small negative numbers stay small
+          uint64_t bits = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+          while(bits >= 0x80)
+          {
+               out.put(static_cast<char>(bits | 0x80));
+               bits >>= 7;
+          }
+          out.put(static_cast<char>(bits));
+     }
+
+     void LogWriter::bytes(const vector<uint8_t>& data)
+     {
+          integer(data.size());
+          out.write(reinterpret_cast<const char*>(data.data()),data.size());
+     }
+
+     /*/**********************************************
+      * LogReader
+      ***********************************************/
+
+     LogReader::LogReader(std::istream& in_) : in(in_)
+     {
+          char magic[sizeof(MAGIC)];
+          if(!in.read(magic,sizeof(magic)) || !std::equal(magic,magic+sizeof(magic),MAGIC))
+               throw ReplayError("not a match log");
+          if(integer()!=FORMAT_VERSION)
+               throw ReplayError("unsupported match log version");
+          settings_.initial_robots_per_combatant = integer();
+          settings_.skill_points = integer();
+          settings_.length = integer();
+          settings_.width = integer();
+          settings_.obstacles = integer();
+          settings_.players = integer();
+          settings_.seed = static_cast<uint64_t>(integer());
+     }
+
+     Opcode LogReader::op()
+     {
+          const int code = in.get();
+          if(code==std::char_traits<char>::eof())
+               throw ReplayError("match log ended early");
+          return Opcode(code);
+     }
+
+     Opcode LogReader::peek()
+     {
+          const int code = in.peek();
+          if(code==std::char_traits<char>::eof())
+               throw ReplayError("match log ended early");
+          return Opcode(code);
+     }
+
+     void LogReader::expect(Opcode code)
+     {
+          if(op()!=code)
+               throw ReplayError("match log out of step with simulation");
+     }
+
+     int64_t LogReader::integer()
+     {
+          uint64_t bits = 0;
+          for(int shift=0; shift<64; shift+=7)
+          {
+               const int byte = in.get();
+               if(byte==std::char_traits<char>::eof())
+                    throw ReplayError("match log ended early");
+               bits |= static_cast<uint64_t>(byte & 0x7F) << shift;
+               if(!(byte & 0x80))
+                    return static_cast<int64_t>(bits >> 1) ^ -static_cast<int64_t>(bits & 1);
+          }
+          throw ReplayError("malformed integer in match log");
+     }
+
+     GridCell LogReader::cell()
+     {
+          GridCell to_return;
+          to_return.x_coord = integer();
+          to_return.y_coord = integer();
+          return to_return;
+     }
+
+     vector<uint8_t> LogReader::bytes()
+     {
+          vector<uint8_t> to_return(integer());
+          if(!in.read(reinterpret_cast<char*>(to_return.data()),to_return.size()))
+               throw ReplayError("match log ended early");
+          return to_return;
+     }
+
+     /*/**********************************************
+      * Recording
+      ***********************************************/
+
+     template<class Call>
+     auto RecordingWorldAPI::forward(Call call) -> decltype(call())
+     {
+          try
+          {
+               return call();
+          }
+          catch(RoboSimExecutionException&)
+          {
+               log.op(THREW);
+               throw;
+          }
+     }
+
+     ActionResult RecordingWorldAPI::finish(const ActionResult& result)
+     {
+          log.op(result ? RETURNED : THREW);
+          return result;
+     }
+
+     ActionResult RecordingWorldAPI::try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result)
+     {
+          log.op(MELEE_ATTACK);
+          log.integer(power);
+          log.cell(adjacent_cell);
+          const ActionResult to_return = finish(forward([&] { return api.try_meleeAttack(power,adjacent_cell,result); }));
+          if(to_return)
+               log.integer(result);
+          return to_return;
+     }
+
+     ActionResult RecordingWorldAPI::try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result)
+     {
+          log.op(RANGED_ATTACK);
+          log.integer(power);
+          log.cell(nonadjacent_cell);
+          const ActionResult to_return = finish(forward([&] { return api.try_rangedAttack(power,nonadjacent_cell,result); }));
+          if(to_return)
+               log.integer(result);
+          return to_return;
+     }
+
+     ActionResult RecordingWorldAPI::try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result)
+     {
+          log.op(CAPSULE_ATTACK);
+          log.integer(power_of_capsule);
+          log.cell(cell);
+          const ActionResult to_return = finish(forward([&] { return api.try_capsuleAttack(power_of_capsule,cell,result); }));
+          if(to_return)
+               log.integer(result);
+          return to_return;
+     }
+
+     ActionResult RecordingWorldAPI::try_defend(int power)
+     {
+          log.op(DEFEND);
+          log.integer(power);
+          return finish(forward([&] { return api.try_defend(power); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_move(int steps, Direction way)
+     {
+          log.op(MOVE);
+          log.integer(steps);
+          log.integer(way);
+          return finish(forward([&] { return api.try_move(steps,way); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_pick_up_capsule(GridCell& adjacent_cell)
+     {
+          log.op(PICK_UP_CAPSULE);
+          log.cell(adjacent_cell);
+          return finish(forward([&] { return api.try_pick_up_capsule(adjacent_cell); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule)
+     {
+          log.op(DROP_CAPSULE);
+          log.cell(adjacent_cell);
+          log.integer(power_of_capsule);
+          return finish(forward([&] { return api.try_drop_capsule(adjacent_cell,power_of_capsule); }));
+     }
+
+     BuildStatus RecordingWorldAPI::getBuildStatus()
+     {
+          log.op(GET_BUILD_STATUS);
+          const BuildStatus to_return = forward([&] { return api.getBuildStatus(); });
+          log.op(RETURNED);
+          log.integer(to_return);
+          return to_return;
+     }
+
+     GridCell* RecordingWorldAPI::getBuildTarget()
+     {
+          log.op(GET_BUILD_TARGET);
+          GridCell* const to_return = forward([&] { return api.getBuildTarget(); });
+          log.op(RETURNED);
+          log.integer(to_return!=NULL);
+          if(to_return!=NULL)
+               log.cell(*to_return);
+          return to_return;
+     }
+
+     int RecordingWorldAPI::getInvestedBuildPower()
+     {
+          log.op(GET_INVESTED_BUILD_POWER);
+          const int to_return = forward([&] { return api.getInvestedBuildPower(); });
+          log.op(RETURNED);
+          log.integer(to_return);
+          return to_return;
+     }
+
+     ActionResult RecordingWorldAPI::try_setBuildTarget(BuildStatus status, GridCell* location)
+     {
+          log.op(SET_BUILD_TARGET);
+          log.integer(status);
+          log.integer(location!=NULL);
+          if(location!=NULL)
+               log.cell(*location);
+          return finish(forward([&] { return api.try_setBuildTarget(status,location); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message)
+     {
+          log.op(SET_BUILD_TARGET_MESSAGE);
+          log.integer(status);
+          log.integer(location!=NULL);
+          if(location!=NULL)
+               log.cell(*location);
+          log.bytes(message);
+          return finish(forward([&] { return api.try_setBuildTarget(status,location,message); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_build(int power)
+     {
+          log.op(BUILD);
+          log.integer(power);
+          return finish(forward([&] { return api.try_build(power); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_repair(int power)
+     {
+          log.op(REPAIR);
+          log.integer(power);
+          return finish(forward([&] { return api.try_repair(power); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_charge(int power, GridCell& ally)
+     {
+          log.op(CHARGE);
+          log.integer(power);
+          log.cell(ally);
+          return finish(forward([&] { return api.try_charge(power,ally); }));
+     }
+
+     ActionResult RecordingWorldAPI::try_sendMessage(const vector<uint8_t>& message, int power)
+     {
+          log.op(SEND_MESSAGE);
+          log.bytes(message);
+          log.integer(power);
+          return finish(forward([&] { return api.try_sendMessage(message,power); }));
+     }
+
+     vector<vector<GridCell> > RecordingWorldAPI::getVisibleNeighborhood()
+     {
+          log.op(GET_VISIBLE_NEIGHBORHOOD);
+          vector<vector<GridCell> > to_return = forward([&] { return api.getVisibleNeighborhood(); });
+          log.op(RETURNED);
+          return to_return;
+     }
+
+     GridView RecordingWorldAPI::getVisibleNeighborhoodView()
+     {
+          log.op(GET_VISIBLE_NEIGHBORHOOD_VIEW);
+          const GridView to_return = forward([&] { return api.getVisibleNeighborhoodView(); });
+          log.op(RETURNED);
+          return to_return;
+     }
+
+     vector<vector<GridCell> > RecordingWorldAPI::getWorld(int power)
+     {
+          log.op(GET_WORLD);
+          log.integer(power);
+          vector<vector<GridCell> > to_return = forward([&] { return api.getWorld(power); });
+          log.op(RETURNED);
+          return to_return;
+     }
+
+     GridView RecordingWorldAPI::getWorldView(int power)
+     {
+          log.op(GET_WORLD_VIEW);
+          log.integer(power);
+          const GridView to_return = forward([&] { return api.getWorldView(power); });
+          log.op(RETURNED);
+          return to_return;
+     }
+
+     WorldSnapshot RecordingWorldAPI::getWorldSnapshot(int power)
+     {
+          log.op(GET_WORLD_SNAPSHOT);
+          log.integer(power);
+          const WorldSnapshot to_return = forward([&] { return api.getWorldSnapshot(power); });
+          log.op(RETURNED);
+          return to_return;
+     }
+
+     ActionResult RecordingWorldAPI::try_scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)
+     {
+          log.op(SCAN_ENEMY);
+          log.cell(toScan);
+          const ActionResult to_return = finish(forward([&] { return api.try_scanEnemy(enemySpecs,enemyStatus,toScan); }));
+          if(to_return)
+               log.integer(enemyStatus.health);
+          return to_return;
+     }
+
+     Robot_Specs RecordingRobot::createRobot(WorldAPI* api, int skill_points, vector<uint8_t> message)
+     {
+          const Robot_Specs to_return = robot->createRobot(api,skill_points,message);
+          log.op(CREATE);
+          log.integer(to_return.attack);
+          log.integer(to_return.defense);
+          log.integer(to_return.power);
+          log.integer(to_return.charge);
+          return to_return;
+     }
+
+     void RecordingRobot::act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t> > received_radio)
+     {
+          log.op(ACT_BEGIN);
+          RecordingWorldAPI recorder(api,log);
+          try
+          {
+               robot->act(recorder,status,received_radio);
+          }
+          catch(...)
+          {
+               log.op(ABORT);
+               throw;
+          }
+          log.op(ACT_END);
+     }
+
+     /*/**********************************************
+      * Replay
+      ***********************************************/
+
+     /**
+      * Makes a recorded call, checking it had the same outcome as when it
+      * was recorded.  Exceptions the robot caught are swallowed again; the
+      * one that ended the match is rethrown.
+      * @return whether the call returned normally
+      */
+     template<class Call>
+     static bool replay(LogReader& log, Call call)
+     {
+          try
+          {
+               call();
+          }
+          catch(RoboSimExecutionException&)
+          {
+               if(log.op()!=THREW)
+                    throw ReplayError("simulator rejected a call it accepted when the match was recorded");
+               if(log.peek()==ABORT)
+               {
+                    log.op();
+                    throw;
+               }
+               return false;
+          }
+          if(log.op()!=RETURNED)
+               throw ReplayError("simulator accepted a call it rejected when the match was recorded");
+          return true;
+     }
+
+     static void check(LogReader& log, int64_t result)
+     {
+          if(log.integer()!=result)
+               throw ReplayError("simulator gave a different result than when the match was recorded");
+     }
+
+     void ReplayRobot::replayCall(WorldAPI& api, Opcode code)
+     {
+          switch(code)
+          {
+          case MELEE_ATTACK:
+          {
+               const int power = log.integer();
+               GridCell cell = log.cell();
+               AttackResult result;
+               if(replay(log,[&] { result = api.meleeAttack(power,cell); }))
+                    check(log,result);
+               break;
+          }
+          case RANGED_ATTACK:
+          {
+               const int power = log.integer();
+               GridCell cell = log.cell();
+               AttackResult result;
+               if(replay(log,[&] { result = api.rangedAttack(power,cell); }))
+                    check(log,result);
+               break;
+          }
+          case CAPSULE_ATTACK:
+          {
+               const int power = log.integer();
+               GridCell cell = log.cell();
+               AttackResult result;
+               if(replay(log,[&] { result = api.capsuleAttack(power,cell); }))
+                    check(log,result);
+               break;
+          }
+          case DEFEND:
+          {
+               const int power = log.integer();
+               replay(log,[&] { api.defend(power); });
+               break;
+          }
+          case MOVE:
+          {
+               const int steps = log.integer();
+               const Direction way = Direction(log.integer());
+               replay(log,[&] { api.move(steps,way); });
+               break;
+          }
+          case PICK_UP_CAPSULE:
+          {
+               GridCell cell = log.cell();
+               replay(log,[&] { api.pick_up_capsule(cell); });
+               break;
+          }
+          case DROP_CAPSULE:
+          {
+               GridCell cell = log.cell();
+               const int power = log.integer();
+               replay(log,[&] { api.drop_capsule(cell,power); });
+               break;
+          }
+          case GET_BUILD_STATUS:
+          {
+               BuildStatus result;
+               if(replay(log,[&] { result = api.getBuildStatus(); }))
+                    check(log,result);
+               break;
+          }
+          case GET_BUILD_TARGET:
+          {
+               GridCell* result;
+               if(replay(log,[&] { result = api.getBuildTarget(); }))
+               {
+                    check(log,result!=NULL);
+                    if(result!=NULL)
+                    {
+                         check(log,result->x_coord);
+                         check(log,result->y_coord);
+                    }
+               }
+               break;
+          }
+          case GET_INVESTED_BUILD_POWER:
+          {
+               int result;
+               if(replay(log,[&] { result = api.getInvestedBuildPower(); }))
+                    check(log,result);
+               break;
+          }
+          case SET_BUILD_TARGET:
+          case SET_BUILD_TARGET_MESSAGE:
+          {
+               const BuildStatus status = BuildStatus(log.integer());
+               GridCell cell;
+               GridCell* location = NULL;
+               if(log.integer())
+               {
+                    cell = log.cell();
+                    location = &cell;
+               }
+               if(code==SET_BUILD_TARGET)
+                    replay(log,[&] { api.setBuildTarget(status,location); });
+               else
+               {
+                    const vector<uint8_t> message = log.bytes();
+                    replay(log,[&] { api.setBuildTarget(status,location,message); });
+               }
+               break;
+          }
+          case BUILD:
+          {
+               const int power = log.integer();
+               replay(log,[&] { api.build(power); });
+               break;
+          }
+          case REPAIR:
+          {
+               const int power = log.integer();
+               replay(log,[&] { api.repair(power); });
+               break;
+          }
+          case CHARGE:
+          {
+               const int power = log.integer();
+               GridCell cell = log.cell();
+               replay(log,[&] { api.charge(power,cell); });
+               break;
+          }
+          case SEND_MESSAGE:
+          {
+               const vector<uint8_t> message = log.bytes();
+               const int power = log.integer();
+               replay(log,[&] { api.sendMessage(message,power); });
+               break;
+          }
+          case GET_VISIBLE_NEIGHBORHOOD:
+               replay(log,[&] { api.getVisibleNeighborhood(); });
+               break;
+          case GET_VISIBLE_NEIGHBORHOOD_VIEW:
+               replay(log,[&] { api.getVisibleNeighborhoodView(); });
+               break;
+          case GET_WORLD:
+          {
+               const int power = log.integer();
+               replay(log,[&] { api.getWorld(power); });
+               break;
+          }
+          case GET_WORLD_VIEW:
+          {
+               const int power = log.integer();
+               replay(log,[&] { api.getWorldView(power); });
+               break;
+          }
+          case GET_WORLD_SNAPSHOT:
+          {
+               const int power = log.integer();
+               replay(log,[&] { api.getWorldSnapshot(power); });
+               break;
+          }
+          case SCAN_ENEMY:
+          {
+               const GridCell cell = log.cell();
+               Robot_Specs specs;
+               Robot_Status status;
+               if(replay(log,[&] { api.scanEnemy(specs,status,cell); }))
+                    check(log,status.health);
+               break;
+          }
+          default:
+               throw ReplayError("match log out of step with simulation");
+          }
+     }
+
+     Robot_Specs ReplayRobot::createRobot(WorldAPI* api, int skill_points, vector<uint8_t> message)
+     {
+          log.expect(CREATE);
+          Robot_Specs to_return;
+          to_return.attack = log.integer();
+          to_return.defense = log.integer();
+          to_return.power = log.integer();
+          to_return.charge = log.integer();
+          return to_return;
+     }
+
+     void ReplayRobot::act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t> > received_radio)
+     {
+          log.expect(ACT_BEGIN);
+          while(true)
+          {
+               const Opcode code = log.op();
+               if(code==ACT_END)
+                    return;
+               if(code==ABORT)
+                    throw ReplayError("robot code threw an exception here when the match was recorded");
+               replayCall(api,code);
+          }
+     }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Robot.hpp"
+#include "WorldPublisher.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Match logs: compact binary recordings of every decision robots made in a
+ * match, for re-simulating the match without running any robot code.<br>
+ * A log starts with the settings of the match.  Then come, in the order
+ * the simulator asked for them, the specs each robot chose when it was
+ * created and every WorldAPI call each robot made from act(), with its
+ * arguments and result.  Integers are stored as zigzag varints, so most
+ * calls take a handful of bytes.<br>
+ * Since a simulation is a deterministic function of its seed and of the
+ * robots' decisions, feeding the recorded decisions back into a simulator
+ * built with the same settings plays out the same match.
+ */
+namespace match_log
+{
+     using robot_api::GridCell;
+     using std::uint8_t;
+     using std::vector;
+
+     /**Settings needed to rebuild the simulator a log was recorded on*/
+     struct MatchSettings
+     {
+          int initial_robots_per_combatant;
+          int skill_points;
+          int length;
+          int width;
+          int obstacles;
+          int players;
+          std::uint64_t seed;
+     };
+
+     /**Record types.  Each WorldAPI call is recorded as its opcode and
+      * arguments, then RETURNED and its result, or THREW if the simulator
+      * rejected it.  If robot code lets an exception escape act(), ABORT
+      * ends the robot's turn (and the log).*/
+     enum Opcode
+     {
+          CREATE, ACT_BEGIN, ACT_END, ABORT, RETURNED, THREW,
+          MELEE_ATTACK, RANGED_ATTACK, CAPSULE_ATTACK, DEFEND,
+          MOVE, PICK_UP_CAPSULE, DROP_CAPSULE,
+          GET_BUILD_STATUS, GET_BUILD_TARGET, GET_INVESTED_BUILD_POWER,
+          SET_BUILD_TARGET, SET_BUILD_TARGET_MESSAGE, BUILD, REPAIR, CHARGE,
+          SEND_MESSAGE, GET_VISIBLE_NEIGHBORHOOD, GET_VISIBLE_NEIGHBORHOOD_VIEW,
+          GET_WORLD, GET_WORLD_VIEW, GET_WORLD_SNAPSHOT, SCAN_ENEMY
+     };
+
+     /**Thrown when a log is malformed, or a replay stops matching it*/
+     struct ReplayError : std::runtime_error
+     {
+          explicit ReplayError(const std::string& what) : std::runtime_error(what) { }
+     };
+
+     /**Appends records to a binary stream*/
+     class LogWriter
+     {
+     private:
+          std::ostream& out;
+
+     public:
+          LogWriter(std::ostream& out_, const MatchSettings& settings);
+
+          void op(Opcode code) { out.put(static_cast<char>(code)); }
+          void integer(std::int64_t value);
+          void cell(const GridCell& cell) { integer(cell.x_coord); integer(cell.y_coord); }
+          void bytes(const vector<uint8_t>& data);
+     };
+
+     /**Reads back records written by LogWriter*/
+     class LogReader
+     {
+     private:
+          std::istream& in;
+          MatchSettings settings_;
+
+     public:
+          explicit LogReader(std::istream& in_);
+
+          const MatchSettings& settings() const { return settings_; }
+
+          /**@return whether every record has been read*/
+          bool atEnd() { return in.peek()==std::char_traits<char>::eof(); }
+
+          Opcode op();
+          Opcode peek();
+          void expect(Opcode code);
+          std::int64_t integer();
+          GridCell cell();
+          vector<uint8_t> bytes();
+     };
+
+     /**
+      * WorldAPI decorator that records every call made through it before
+      * passing it on to the simulator.
+      */
+     class RecordingWorldAPI : public WorldAPI, public WorldPublisher
+     {
+     private:
+          WorldAPI& api;
+          LogWriter& log;
+
+          //Calls the simulator, noting in the log if it threw
+          template<class Call>
+          auto forward(Call call) -> decltype(call());
+
+          //Notes in the log whether the simulator carried out an action
+          ActionResult finish(const ActionResult& result);
+
+     public:
+          RecordingWorldAPI(WorldAPI& api_, LogWriter& log_) : api(api_), log(log_) { }
+
+          ActionResult try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result);
+          ActionResult try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result);
+          ActionResult try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result);
+          ActionResult try_defend(int power);
+          ActionResult try_move(int steps, Direction way);
+          ActionResult try_pick_up_capsule(GridCell& adjacent_cell);
+          ActionResult try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule);
+          BuildStatus getBuildStatus();
+          GridCell* getBuildTarget();
+          int getInvestedBuildPower();
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location);
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message);
+          ActionResult try_build(int power);
+          ActionResult try_repair(int power);
+          ActionResult try_charge(int power, GridCell& ally);
+          ActionResult try_sendMessage(const vector<uint8_t>& message, int power);
+          vector<vector<GridCell> > getVisibleNeighborhood();
+          GridView getVisibleNeighborhoodView();
+          vector<vector<GridCell> > getWorld(int power);
+          GridView getWorldView(int power);
+          WorldSnapshot getWorldSnapshot(int power);
+          ActionResult try_scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan);
+
+          //Not a decision of the robot's, so not recorded
+          void publishWorld(SharedWorld& shared) { robot_api::publishWorld(api,shared); }
+     };
+
+     /**
+      * Robot decorator that records the decisions of the robot it wraps.
+      * Takes ownership of the wrapped robot.
+      */
+     class RecordingRobot : public Robot
+     {
+     private:
+          std::unique_ptr<Robot> robot;
+          LogWriter& log;
+
+     public:
+          RecordingRobot(Robot* robot_, LogWriter& log_) : robot(robot_), log(log_) { }
+
+          Robot_Specs createRobot(WorldAPI* api, int skill_points, vector<uint8_t> message);
+          void act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t> > received_radio);
+     };
+
+     /**
+      * Stand-in for the robots of a recorded match: makes the recorded
+      * decisions instead of running any robot code, and checks that the
+      * simulator answers the way it did when the log was recorded.  All
+      * the robots of a match share one reader.
+      */
+     class ReplayRobot : public Robot
+     {
+     private:
+          LogReader& log;
+
+          void replayCall(WorldAPI& api, Opcode code);
+
+     public:
+          explicit ReplayRobot(LogReader& log_) : log(log_) { }
+
+          Robot_Specs createRobot(WorldAPI* api, int skill_points, vector<uint8_t> message);
+          void act(WorldAPI& api, Robot_Status status, vector<vector<uint8_t> > received_radio);
+     };
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Robot.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * RobotPool: storage for the robots of one type, one pool per thread.
+ * Robots are carved out of slabs, each holding many of them side by side,
+ * and freed slots are reused, so a team's robots sit together in memory
+ * rather than wherever the heap put them.<br>
+ * Each thread allocates from its own pool without locking.  A robot freed
+ * on another thread than made it goes to that thread's pool, which is
+ * fine, as slabs are never given back: a pool outlives its thread, and
+ * holds as much memory as the most robots it ever had out at once.
+ */
+template<class T>
+class RobotPool
+{
+private:
+     union Slot
+     {
+          Slot* next;
+          typename std::aligned_storage<sizeof(T),alignof(T)>::type bytes;
+     };
+
+     //Slabs double in size, starting from this many robots
+     static const int FIRST_SLAB = 64;
+
+     std::vector<std::unique_ptr<Slot[]> > slabs;
+     int slab_size = FIRST_SLAB;
+     Slot* free_list = NULL;
+
+public:
+     /**@return this thread's pool for robots of type T.  It's never
+      *         destroyed, so robots may be deleted at any time, even after
+      *         the thread or the program is done.*/
+     static RobotPool& forThisThread()
+     {
+          static thread_local RobotPool* const pool = new RobotPool();
+          return *pool;
+     }
+
+     /**@return uninitialized storage for one robot*/
+     void* allocate()
+     {
+          if(!free_list)
+          {
+               Slot* const slab = new Slot[slab_size];
+               slabs.emplace_back(slab);
+               for(int i=0; i<slab_size; i++)
+                    slab[i].next = i+1 < slab_size ? &slab[i+1] : NULL;
+               free_list = slab;
+               slab_size *= 2;
+          }
+          Slot* const slot = free_list;
+          free_list = slot->next;
+          return slot;
+     }
+
+     /**Returns storage from allocate() to the pool*/
+     void release(void* memory)
+     {
+          Slot* const slot = static_cast<Slot*>(memory);
+          slot->next = free_list;
+          free_list = slot;
+     }
+};
+
+/**
+ * Pooled: a robot of type T that lives in RobotPool storage.  The
+ * simulator deletes robots through Robot*, which (destructors being
+ * virtual) finds the operator delete here, so it needn't know.
+ */
+template<class T>
+class Pooled final : public T
+{
+public:
+     static void* operator new(std::size_t) { return RobotPool<Pooled>::forThisThread().allocate(); }
+     static void operator delete(void* memory) { RobotPool<Pooled>::forThisThread().release(memory); }
+};
+
+namespace player_roster
+{
+     /**Finds a robot's type among Types, starting at index I*/
+     template<int I, class... Types>
+     struct TypeList;
+
+     template<int I>
+     struct TypeList<I>
+     {
+          static int indexOf(const Robot&) { return -1; }
+
+          template<class Visitor>
+          static bool visit(int, Robot&, Visitor&) { return false; }
+     };
+
+     template<int I, class T, class... Rest>
+     struct TypeList<I,T,Rest...>
+     {
+          static int indexOf(const Robot& robot)
+          {
+               return typeid(robot)==typeid(Pooled<T>) ? I : TypeList<I+1,Rest...>::indexOf(robot);
+          }
+
+          template<class Visitor>
+          static bool visit(int type, Robot& robot, Visitor& visitor)
+          {
+               if(type!=I)
+                    return TypeList<I+1,Rest...>::visit(type,robot,visitor);
+               visitor(static_cast<Pooled<T>&>(robot));
+               return true;
+          }
+     };
+}
+
+/**
+ * PlayerRoster: the players compiled into the simulator, as a list of
+ * robot types; player n plays the nth.  Each type must be
+ * default-constructible, with a public act().  There can be any number of them.<br>
+ * Robots are made through a table built at compile time, one entry per
+ * player, and each type's robots are kept together in a RobotPool.  As
+ * the types are known at compile time, so is which act() to call: given
+ * typeOf() a robot, visit() hands it to a visitor as its own (final)
+ * type, through a chain of comparisons the compiler turns into a switch,
+ * so the visitor's calls to it are direct and can be inlined.
+ */
+template<class... Players>
+class PlayerRoster
+{
+private:
+     template<class T>
+     static Robot* make() { return new Pooled<T>(); }
+
+public:
+     /**number of players*/
+     static const int players = sizeof...(Players);
+
+     /**@return new robot for the given player (numbered from 1), which the
+      *         caller owns, or NULL if there's no such player*/
+     static Robot* construct(int player)
+     {
+          static Robot* (* const makers[])() = { &make<Players>... };
+          return player >= 1 && player <= players ? makers[player-1]() : NULL;
+     }
+
+     /**@return index of robot's type among Players, if construct() made
+      *         it, or -1 if something else did*/
+     static int typeOf(const Robot& robot) { return player_roster::TypeList<0,Players...>::indexOf(robot); }
+
+     /**Calls visitor(robot), with robot as its own type
+      * @param type typeOf(robot)
+      * @return false (without calling visitor) if type is -1*/
+     template<class Visitor>
+     static bool visit(int type, Robot& robot, Visitor& visitor) { return player_roster::TypeList<0,Players...>::visit(type,robot,visitor); }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace robot_api
+{
+     using std::uint8_t;
+     using std::vector;
+
+     /**A radio message: always exactly 64 bytes*/
+     struct RadioMessage
+     {
+          static const int SIZE = 64;
+
+          uint8_t bytes[SIZE];
+     };
+
+     /**Read-only view of a byte array (a radio or creation message); valid
+      * only as long as the bytes it views*/
+     class MessageView
+     {
+     private:
+          const uint8_t* bytes;
+          std::size_t length;
+
+     public:
+          MessageView(const uint8_t* bytes_, std::size_t length_) : bytes(bytes_), length(length_) { }
+          MessageView(const vector<uint8_t>& message) : bytes(message.data()), length(message.size()) { }
+
+          const uint8_t* data() const { return bytes; }
+          std::size_t size() const { return length; }
+          uint8_t operator[](std::size_t i) const { return bytes[i]; }
+          const uint8_t* begin() const { return bytes; }
+          const uint8_t* end() const { return bytes+length; }
+
+          /**@return copy of the bytes, for keeping past the view's lifetime*/
+          vector<uint8_t> copy() const { return vector<uint8_t>(bytes,bytes+length); }
+     };
+
+     /**
+      * RadioPool: storage for the radio messages in flight in a simulation.<br>
+      * Messages are referred to by their position in the pool and counted
+      * by reference, so a broadcast stores its payload once no matter how
+      * many robots receive it.  Released positions are reused, so once the
+      * pool has grown to the busiest turn's traffic, sending a message
+      * allocates nothing.  Stored messages never move, so views of them
+      * stay valid while more messages are sent.
+      */
+     class RadioPool
+     {
+     private:
+          struct Entry
+          {
+               RadioMessage message;
+               int refs;
+          };
+
+          std::deque<Entry> entries;
+          vector<int> free_entries;
+
+     public:
+          /**
+           * Stores a message.
+           * @param bytes RadioMessage::SIZE bytes of payload
+           * @param refs number of inboxes the message will be put in
+           * @return position of message in the pool
+           */
+          int store(const uint8_t* bytes, int refs)
+               {
+                    int to_return;
+                    if(free_entries.empty())
+                    {
+                         to_return = entries.size();
+                         entries.emplace_back();
+                    }
+                    else
+                    {
+                         to_return = free_entries.back();
+                         free_entries.pop_back();
+                    }
+                    std::memcpy(entries[to_return].message.bytes,bytes,RadioMessage::SIZE);
+                    entries[to_return].refs = refs;
+                    return to_return;
+               }
+
+          const RadioMessage& operator[](int message) const { return entries[message].message; }
+
+          /**Drops one reference to a message, freeing it after the last*/
+          void release(int message)
+               {
+                    if(--entries[message].refs==0)
+                         free_entries.push_back(message);
+               }
+
+          /**Releases every message in an inbox and empties it (keeping its
+           * storage for the next turn)*/
+          void releaseAll(vector<int>& inbox)
+               {
+                    for(int message : inbox)
+                         release(message);
+                    inbox.clear();
+               }
+     };
+
+     /**
+      * RadioInbox: read-only view of the radio messages a robot received,
+      * without copying them.  Valid only during the act() call it's passed
+      * to.
+      */
+     class RadioInbox
+     {
+     private:
+          //Either messages in a pool...
+          const RadioPool* pool;
+          const vector<int>* positions;
+
+          //...or a robot interface v1 style inbox
+          const vector<vector<uint8_t> >* copies;
+
+     public:
+          RadioInbox(const RadioPool& pool_, const vector<int>& positions_) : pool(&pool_), positions(&positions_), copies(NULL) { }
+          explicit RadioInbox(const vector<vector<uint8_t> >& copies_) : pool(NULL), positions(NULL), copies(&copies_) { }
+
+          /**@return number of messages*/
+          int size() const { return pool ? positions->size() : copies->size(); }
+
+          bool empty() const { return size()==0; }
+
+          /**@return view of a message (always RadioMessage::SIZE bytes)*/
+          MessageView operator[](int i) const
+               {
+                    if(pool)
+                         return MessageView((*pool)[(*positions)[i]].bytes,RadioMessage::SIZE);
+                    return MessageView((*copies)[i]);
+               }
+     };
+}
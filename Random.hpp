@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * SplitMix64: tiny generator used to turn one 64-bit seed into as many
+ * well-mixed 64-bit values as needed (for seeding Xoshiro256).
+ */
+class SplitMix64
+{
+private:
+     std::uint64_t state;
+
+public:
+     explicit SplitMix64(std::uint64_t seed) : state(seed) { }
+
+     std::uint64_t next()
+          {
+               std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+               z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+               z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+               return z ^ (z >> 31);
+          }
+};
+
+/**
+ * Xoshiro256: xoshiro256** pseudorandom number generator.<br>
+ * Fast, small (32 bytes of state), and statistically sound.  Each
+ * simulator keeps its own, so simulations neither share hidden state nor
+ * depend on each other's random numbers.  jump() splits off streams that
+ * won't overlap for 2^128 draws.
+ */
+class Xoshiro256
+{
+private:
+     std::uint64_t s[4];
+
+     static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+     /**@param seed any value; expanded into the full state with SplitMix64*/
+     explicit Xoshiro256(std::uint64_t seed = 0)
+          {
+               SplitMix64 expand(seed);
+               for(std::uint64_t& x : s)
+                    x = expand.next();
+          }
+
+     std::uint64_t next()
+          {
+               const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+               const std::uint64_t t = s[1] << 17;
+               s[2] ^= s[0];
+               s[3] ^= s[1];
+               s[1] ^= s[2];
+               s[0] ^= s[3];
+               s[2] ^= t;
+               s[3] = rotl(s[3], 45);
+               return result;
+          }
+
+     /**@return random number in [0,bound), for bound > 0*/
+     int below(int bound)
+          {
+               return static_cast<int>(((next() >> 32) * static_cast<std::uint64_t>(bound)) >> 32);
+          }
+
+     /**@param out filled in with the generator's state (for checkpoints)*/
+     void getState(std::uint64_t out[4]) const
+          {
+               for(int i=0; i<4; i++)
+                    out[i] = s[i];
+          }
+
+     /**@param in state previously returned by getState()*/
+     void setState(const std::uint64_t in[4])
+          {
+               for(int i=0; i<4; i++)
+                    s[i] = in[i];
+          }
+
+     /**Advances the generator by 2^128 draws*/
+     void jump()
+          {
+               static const std::uint64_t JUMP[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+               std::uint64_t t[4] = { 0, 0, 0, 0 };
+               for(std::uint64_t word : JUMP)
+                    for(int b=0; b<64; b++)
+                    {
+                         if(word & (static_cast<std::uint64_t>(1) << b))
+                              for(int i=0; i<4; i++)
+                                   t[i] ^= s[i];
+                         next();
+                    }
+               for(int i=0; i<4; i++)
+                    s[i] = t[i];
+          }
+};
@@ -0,0 +1,93 @@
+#include "MatchLog.hpp"
+#include "RoboSim.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/*
+ * Replay: re-simulates a match recorded with "tournament --record",
+ * feeding the recorded decisions straight into the simulator so no robot
+ * code runs.  Useful for profiling the engine on a real workload.
+ *
+ * Usage: replay LOG [repetitions]
+ */
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+using namespace match_log;
+
+int main(int argc, const char** argv)
+{
+     if(argc!=2 && argc!=3)
+     {
+          cerr << "Usage: " << argv[0] << " LOG [repetitions]" << endl;
+          return 1;
+     }
+     const int repetitions = argc==3 ? std::atoi(argv[2]) : 1;
+
+     //Read the whole log up front so the replay doesn't time the disk
+     std::ifstream file(argv[1],std::ios::binary);
+     std::ostringstream contents;
+     contents << file.rdbuf();
+     if(!file)
+     {
+          cerr << "Could not read " << argv[1] << endl;
+          return 1;
+     }
+     const string log_data = contents.str();
+
+     int winner = -1;
+     int turns = 0;
+     string error;
+     const auto start = std::chrono::steady_clock::now();
+     try
+     {
+          for(int i=0; i<repetitions; i++)
+          {
+               std::istringstream in(log_data);
+               LogReader log(in);
+               const MatchSettings& settings = log.settings();
+               RoboSim sim(settings.initial_robots_per_combatant,settings.skill_points,settings.length,settings.width,settings.obstacles,settings.players,
+                           [&log](int player) { return new ReplayRobot(log); },
+                           settings.seed);
+
+               winner = -1;
+               turns = 0;
+               error.clear();
+               try
+               {
+                    while(winner==-1 && !log.atEnd())
+                    {
+                         winner = sim.executeSingleTimeStep();
+                         turns++;
+                    }
+               }
+               catch(robot_api::RoboSimExecutionException e)
+               {
+                    error = e.msg;
+               }
+          }
+     }
+     catch(ReplayError& e)
+     {
+          cerr << "Replay failed: " << e.what() << endl;
+          return 1;
+     }
+     const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+     if(!error.empty())
+          cout << "Ended with: " << error << endl;
+     if(winner==RoboSim::NO_SURVIVORS)
+          cout << "No survivors" << endl;
+     else
+          cout << "Winner: " << winner << endl;
+     cout << "Turns: " << turns << endl;
+     cout << "Seconds per replay: " << seconds/repetitions << endl;
+     return 0;
+}
@@ -2,12 +2,16 @@
 #include "player_config.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
 
 using std::ceil;
-using std::find;
 using std::list;
-using std::rand;
-using std::to_string;
+using std::string;
 
 using namespace robot_api;
 
@@ -31,78 +35,556 @@ bool RoboSim::SimGridAllyDeterminant::operator()(const GridCell& potential_ally)
      }
 }
 
-vector<vector<GridCell> > RoboSim::getSanitizedSubGrid(int x_left, int y_up, int x_right, int y_down, int player) const
+GridCell RoboSim::getSanitizedCell(int idx, int player) const
 {
-     const int x_length = x_right - x_left + 1;
-     const int y_height = y_down - y_up + 1;
-     
-     vector<vector<GridCell> > to_return(x_length,vector<GridCell>(y_height));
-     for(int i=x_left; i<=x_right; i++)
-          for(int j=y_up; j<=y_down; j++)
+     GridCell sanitized;
+     sanitized.x_coord = worldGrid.xOf(idx);
+     sanitized.y_coord = worldGrid.yOf(idx);
+     sanitized.contents = worldGrid.contents(idx);
+     sanitized.fort_orientation = worldGrid.fortOrientation(idx);
+     sanitized.capsule_power = worldGrid.capsulePower(idx);
+     if(sanitized.contents==SELF)
+          if(worldGrid.occupant(idx)->player==player)
+               sanitized.contents = ALLY;
+          else
+               sanitized.contents = ENEMY;
+     sanitized.has_private_members = false;
+     sanitized.occupant_data = NULL;
+     sanitized.wallforthealth = 0;
+     return sanitized;
+}
+
+WorldSnapshot RoboSim::getWorldSnapshot(const RobotData& self) const
+{
+     std::lock_guard<std::mutex> guard(snapshot_lock);
+     if(int(snapshots.size()) <= self.player)
+          snapshots.resize(self.player+1);
+
+     SnapshotEntry& entry = snapshots[self.player];
+     if(!entry.cells || entry.version!=worldGrid.version())
+     {
+          //If no robot is holding on to the stale copy, refill it in place
+          if(!entry.cells || entry.cells.use_count()!=1)
+               entry.cells = std::make_shared<vector<GridCell> >(worldGrid.size());
+
+          vector<GridCell>& cells = *entry.cells;
+          for(int i=0; i<worldGrid.size(); i++)
+               cells[i] = getSanitizedCell(i,self.player);
+          entry.version = worldGrid.version();
+     }
+
+     return WorldSnapshot(entry.cells,worldGrid.length(),worldGrid.width(),self.assoc_cell);
+}
+
+//Source of world_id
+static std::atomic<unsigned long long> world_ids(0);
+
+void RoboSim::publishWorld(SharedWorld& shared, const RobotData& self) const
+{
+     //Rewrite only what changed since the last publication, unless the
+     //shared cells came from elsewhere
+     const bool fresh = !shared.publishedFrom(world_id,self.player);
+     if(fresh || shared.publishedVersion()!=worldGrid.version())
+     {
+          for(int chunk=0; chunk<worldGrid.chunks(); chunk++)
           {
-               GridCell& sanitized = to_return[i-x_left][j-y_up];
-               sanitized = worldGrid[i][j];
-               if(sanitized.contents==SELF)
-                    if(sanitized.occupant_data->player==player)
-                         sanitized.contents = ALLY;
-                    else
-                         sanitized.contents = ENEMY;
-               sanitized.has_private_members = false;
-               sanitized.occupant_data = NULL;
-               sanitized.wallforthealth = 0;
+               if(!fresh && worldGrid.chunkVersion(chunk) <= shared.publishedVersion())
+                    continue;
+
+               const int end = std::min((chunk+1) << WorldGrid::CHUNK_BITS,worldGrid.size());
+               for(int idx=chunk << WorldGrid::CHUNK_BITS; idx<end; idx++)
+               {
+                    WorldGrid::PackedCell cell = worldGrid.packed(idx);
+                    if(cell.contents()==SELF)
+                         cell.state = (cell.state & ~0xF) | (worldGrid.occupant(idx)->player==self.player ? ALLY : ENEMY);
+                    cell.wallforthealth = 0;
+                    shared.store(idx,cell);
+               }
           }
-     
+          shared.published(world_id,worldGrid.version(),self.player);
+     }
+
+     const GridView neighborhood = getVisibleNeighborhood(self);
+     const SharedWorld::Window window = { neighborhood.xOffset(), neighborhood.yOffset(), neighborhood.length(), neighborhood.width() };
+     shared.setSelf(self.assoc_cell,window);
+}
+
+int RoboSim::shortestPathLength(int origin, int target) const
+{
+     if(origin==target)
+          return 0;
+
+     const unsigned long long key = PathQueryCache::key(origin,target);
+     int cached;
+     if(pathCache.lookup(key,worldGrid.version(),cached))
+          return cached;
+
+     const LandmarkTable* table = NULL;
+     if(landmark_count > 0)
+     {
+          //Build a new table rather than rebuild the old one in place, as
+          //forks of this simulator may still be using it
+          if(!landmarks || landmarks_version!=worldGrid.obstacleVersion())
+          {
+               std::shared_ptr<LandmarkTable> fresh = std::make_shared<LandmarkTable>();
+               fresh->build(worldGrid.length(),worldGrid.width(),landmark_count,[this](int idx)
+                            {
+                                 return worldGrid.contents(idx)!=WALL && worldGrid.contents(idx)!=FORT;
+                            });
+               landmarks = fresh;
+               landmarks_version = worldGrid.obstacleVersion();
+          }
+          table = landmarks.get();
+     }
+
+     PathSearch& search = PathSearch::forThisThread();
+     const int found = search.aStar(worldGrid.length(),worldGrid.width(),origin,target,
+                                    [this](int idx) { return worldGrid.contents(idx)==EMPTY; },
+                                    table);
+     const int to_return = found==-1 ? 0 : search.distanceTo(found);
+     pathCache.store(key,worldGrid.version(),to_return);
      return to_return;
 }
 
+int RoboSim::findNearestAlly(int origin) const
+{
+     if(!allies.built())
+     {
+          allies.build(worldGrid.length(),worldGrid.width(),num_players);
+          for(const RobotData& x : turnOrder)
+               allies.add(x.player,x.assoc_cell);
+     }
+
+     return allies.nearest(worldGrid.occupant(origin)->player,origin);
+}
+
+void RoboSim::attachRobot(RobotData& data, Robot* robot)
+{
+     data.robot = robot;
+     data.robot_v2 = dynamic_cast<RobotV2*>(robot);
+     data.roster_type = robot ? Players::typeOf(*robot) : -1;
+}
+
+struct RoboSim::ActCall
+{
+     RoboSim& sim;
+     RobotData& data;
+     WorldAPI& api;
+     const Robot_Status& status;
+
+     template<class T>
+     void operator()(T& robot) { call(robot,std::is_base_of<RobotV2,T>()); }
+
+     template<class T>
+     void call(T& robot, std::true_type)
+          {
+               const Robot_Status copy = status;
+               robot.act(api,copy,RadioInbox(sim.radio,data.buffered_radio));
+          }
+
+     template<class T>
+     void call(T& robot, std::false_type) { robot.act(api,status,sim.deliverRadio(data)); }
+};
+
+void RoboSim::actRobot(RobotData& data, WorldAPI& api, const Robot_Status& status)
+{
+     //Robots from elsewhere (plugins, workers, recorders...) are called
+     //through their vtables
+     ActCall call{*this,data,api,status};
+     if(Players::visit(data.roster_type,*data.robot,call))
+          return;
+
+     if(data.robot_v2)
+     {
+          const Robot_Status copy = status;
+          data.robot_v2->act(api,copy,RadioInbox(radio,data.buffered_radio));
+     }
+     else
+          data.robot->act(api,status,deliverRadio(data));
+}
+
+RoboSim::~RoboSim()
+{
+     for(RobotData& x : turnOrder)
+          delete x.robot;
+}
+
+namespace
+{
+     const char CHECKPOINT_MAGIC[4] = { 'R', 'P', 'W', 'C' };
+     const int CHECKPOINT_VERSION = 1;
+
+     //Byte strings are read this much at a time, so a corrupt length can't
+     //make us allocate much more than the stream holds
+     const size_t CHECKPOINT_BYTES_CHUNK = 1 << 16;
+
+     //Checkpoints go straight to and from their stream, rather than
+     //through a copy in memory, which would double the memory a large
+     //arena's checkpoint takes
+     class CheckpointWriter
+     {
+     private:
+          std::ostream& out;
+
+     public:
+          explicit CheckpointWriter(std::ostream& out_) : out(out_) { }
+
+          void raw(const void* data, size_t size) { out.write(static_cast<const char*>(data),size); }
+
+          void integer(int value) { raw(&value,sizeof(value)); }
+          void word(std::uint64_t value) { raw(&value,sizeof(value)); }
+
+          void bytes(const vector<uint8_t>& data)
+               {
+                    integer(data.size());
+                    raw(data.data(),data.size());
+               }
+     };
+
+     class CheckpointReader
+     {
+     private:
+          std::istream& in;
+          std::streamoff end;
+
+     public:
+          explicit CheckpointReader(std::istream& in_) : in(in_), end(-1)
+               {
+                    //Find where the stream ends, if it can tell us
+                    const std::streampos start = in.tellg();
+                    if(start!=std::streampos(-1) && in.seekg(0,std::ios::end))
+                    {
+                         end = in.tellg();
+                         in.seekg(start);
+                    }
+                    in.clear();
+               }
+
+          /**@return whether at least size bytes are left to read (true if
+           *         the stream can't tell)*/
+          bool has(std::uint64_t size)
+               {
+                    if(end < 0)
+                         return true;
+                    const std::streamoff pos = in.tellg();
+                    return pos >= 0 && pos <= end && size <= std::uint64_t(end-pos);
+               }
+
+          void raw(void* out, size_t size)
+               {
+                    in.read(static_cast<char*>(out),size);
+                    if(size_t(in.gcount())!=size)
+                         throw RoboSimExecutionException("checkpoint is truncated");
+               }
+
+          int integer()
+               {
+                    int value;
+                    raw(&value,sizeof(value));
+                    return value;
+               }
+
+          std::uint64_t word()
+               {
+                    std::uint64_t value;
+                    raw(&value,sizeof(value));
+                    return value;
+               }
+
+          vector<uint8_t> bytes()
+               {
+                    const int size = integer();
+                    if(size < 0)
+                         throw RoboSimExecutionException("checkpoint is corrupt");
+                    if(!has(size))
+                         throw RoboSimExecutionException("checkpoint is truncated");
+                    vector<uint8_t> to_return;
+                    for(size_t done=0; done<size_t(size); done=to_return.size())
+                    {
+                         to_return.resize(done+min(CHECKPOINT_BYTES_CHUNK,size-done));
+                         raw(&to_return[done],to_return.size()-done);
+                    }
+                    return to_return;
+               }
+     };
+}
+
+void RoboSim::saveCheckpoint(std::ostream& out) const
+{
+     CheckpointWriter writer(out);
+     writer.raw(CHECKPOINT_MAGIC,sizeof(CHECKPOINT_MAGIC));
+     writer.integer(CHECKPOINT_VERSION);
+
+     //Simulation settings and random number generators
+     writer.integer(num_players);
+     writer.integer(landmark_count);
+     writer.word(seed);
+     std::uint64_t rng_state[4];
+     placement_rng.getState(rng_state);
+     writer.raw(rng_state,sizeof(rng_state));
+     combat_rng.getState(rng_state);
+     writer.raw(rng_state,sizeof(rng_state));
+
+     //World grid (occupants are rebuilt from the robots' cells)
+     writer.integer(worldGrid.length());
+     writer.integer(worldGrid.width());
+     const int chunk_size = WorldGrid::CHUNK_SIZE;
+     for(int i=0; i<int(worldGrid.cell_chunks.size()); i++)
+          writer.raw(worldGrid.cell_chunks[i]->cells,min(chunk_size,worldGrid.size()-i*chunk_size)*sizeof(WorldGrid::PackedCell));
+
+     //Robots
+     writer.integer(turnOrder_pos);
+     writer.integer(turnOrder.size());
+     vector<uint8_t> robot_state;
+     for(const RobotData& x : turnOrder)
+     {
+          writer.integer(x.player);
+          writer.integer(x.assoc_cell);
+          writer.integer(x.specs.attack);
+          writer.integer(x.specs.defense);
+          writer.integer(x.specs.power);
+          writer.integer(x.specs.charge);
+          writer.integer(x.status.power);
+          writer.integer(x.status.charge);
+          writer.integer(x.status.health);
+          writer.integer(x.status.defense_boost);
+          writer.integer(x.status.capsules.size());
+          for(int capsule : x.status.capsules)
+               writer.integer(capsule);
+          writer.integer(x.whatBuilding);
+          writer.integer(x.investedPower);
+          writer.integer(x.invested_assoc_cell);
+          writer.integer(x.buffered_radio.size());
+          for(int message : x.buffered_radio)
+          {
+               writer.integer(RadioMessage::SIZE);
+               writer.raw(radio[message].bytes,RadioMessage::SIZE);
+          }
+
+          robot_state.clear();
+          const bool saved = x.robot->saveState(robot_state);
+          writer.integer(saved);
+          if(saved)
+               writer.bytes(robot_state);
+     }
+}
+
+RoboSim::RoboSim(std::istream& checkpoint) : RoboSim(checkpoint,rbp_construct_robot) { }
+
+RoboSim::RoboSim(std::istream& checkpoint, RobotFactory factory) :
+     turnOrder_pos(0), num_players(0), robot_factory(factory), seed(0),
+     landmark_count(0), landmarks_version(0), world_id(++world_ids), simultaneous(false)
+{
+     CheckpointReader reader(checkpoint);
+     char magic[sizeof(CHECKPOINT_MAGIC)];
+     reader.raw(magic,sizeof(magic));
+     if(!std::equal(magic,magic+sizeof(magic),CHECKPOINT_MAGIC) || reader.integer()!=CHECKPOINT_VERSION)
+          throw RoboSimExecutionException("not a checkpoint, or from an incompatible version");
+
+     num_players = reader.integer();
+     if(num_players < 1)
+          throw RoboSimExecutionException("checkpoint is corrupt");
+     landmark_count = reader.integer();
+     seed = reader.word();
+     std::uint64_t rng_state[4];
+     reader.raw(rng_state,sizeof(rng_state));
+     placement_rng.setState(rng_state);
+     reader.raw(rng_state,sizeof(rng_state));
+     combat_rng.setState(rng_state);
+
+     const int length = reader.integer();
+     const int width = reader.integer();
+     if(length <= 0 || width <= 0 || length > (std::numeric_limits<int>::max()-WorldGrid::CHUNK_SIZE)/width)
+          throw RoboSimExecutionException("checkpoint is corrupt");
+     if(!reader.has(std::uint64_t(length)*width*sizeof(WorldGrid::PackedCell)))
+          throw RoboSimExecutionException("checkpoint is truncated");
+     worldGrid = WorldGrid(length,width);
+     worldGrid.robots = &turnOrder;
+     const int chunk_size = WorldGrid::CHUNK_SIZE;
+     for(int i=0; i<int(worldGrid.cell_chunks.size()); i++)
+          reader.raw(worldGrid.cell_chunks[i]->cells,min(chunk_size,worldGrid.size()-i*chunk_size)*sizeof(WorldGrid::PackedCell));
+
+     //Only what the simulator itself puts in the world: robots are SELF
+     //(allies and enemies exist only in views), and there are four
+     //orientations
+     for(int i=0; i<worldGrid.size(); i++)
+     {
+          const GridObject contents = worldGrid.contents(i);
+          if(contents > CAPSULE || contents==ALLY || contents==ENEMY || worldGrid.fortOrientation(i) > RIGHT)
+               throw RoboSimExecutionException("checkpoint is corrupt");
+     }
+
+     turnOrder_pos = reader.integer();
+     const int robots = reader.integer();
+     if(robots < 0 || robots > worldGrid.size() || turnOrder_pos < 0 || turnOrder_pos > robots)
+          throw RoboSimExecutionException("checkpoint is corrupt");
+
+     try
+     {
+          for(int i=0; i<robots; i++)
+          {
+               RobotData& x = turnOrder.add();
+               x.robot = NULL;
+               x.player = reader.integer();
+               x.assoc_cell = reader.integer();
+               if(x.player < 1 || x.player > num_players || x.assoc_cell < 0 || x.assoc_cell >= worldGrid.size())
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+
+               //Each robot is in a cell of its own, marked as a robot's
+               if(worldGrid.contents(x.assoc_cell)!=SELF || worldGrid.occupant(x.assoc_cell)!=NULL)
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+               x.specs.attack = reader.integer();
+               x.specs.defense = reader.integer();
+               x.specs.power = reader.integer();
+               x.specs.charge = reader.integer();
+               x.status.power = reader.integer();
+               x.status.charge = reader.integer();
+               x.status.health = reader.integer();
+               x.status.defense_boost = reader.integer();
+               const int capsules = reader.integer();
+               if(capsules < 0 || capsules > x.specs.attack+x.specs.defense)
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+               for(int j=0; j<capsules; j++)
+               {
+                    const int capsule = reader.integer();
+                    if(capsule < 0)
+                         throw RoboSimExecutionException("checkpoint is corrupt");
+                    x.status.capsules.add(capsule);
+               }
+
+               //Robots build nothing, robots, or (as BuildStatus has no
+               //names for them) walls, forts and capsules
+               const int building = reader.integer();
+               if(building!=NOTHING && building!=ROBOT && building!=WALL && building!=FORT && building!=CAPSULE)
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+               x.whatBuilding = BuildStatus(building);
+               x.investedPower = reader.integer();
+               x.invested_assoc_cell = reader.integer();
+               if(x.invested_assoc_cell < -1 || x.invested_assoc_cell >= worldGrid.size())
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+
+               const int messages = reader.integer();
+               if(messages < 0)
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+               for(int j=0; j<messages; j++)
+               {
+                    const vector<uint8_t> bytes = reader.bytes();
+                    if(bytes.size()!=RadioMessage::SIZE)
+                         throw RoboSimExecutionException("checkpoint is corrupt");
+                    x.buffered_radio.push_back(radio.store(bytes.data(),1));
+               }
+
+               attachRobot(x,robot_factory(x.player));
+               if(reader.integer())
+                    x.robot->loadState(reader.bytes());
+               worldGrid.setOccupant(x.assoc_cell,&x);
+          }
+
+          //...and every cell marked as a robot's has one
+          for(int i=0; i<worldGrid.size(); i++)
+               if(worldGrid.contents(i)==SELF && worldGrid.occupant(i)==NULL)
+                    throw RoboSimExecutionException("checkpoint is corrupt");
+     }
+     catch(...)
+     {
+          for(RobotData& x : turnOrder)
+               delete x.robot;
+          throw;
+     }
+}
+
+RoboSim::RobotClonePolicy RoboSim::copyRobotState(RobotFactory factory)
+{
+     return [factory](Robot* original, int player)
+          {
+               Robot* to_return = factory(player);
+               vector<uint8_t> state;
+               if(original->saveState(state))
+                    to_return->loadState(state);
+               return to_return;
+          };
+}
+
+RoboSim::RobotClonePolicy RoboSim::substituteRobots(RobotFactory factory)
+{
+     return [factory](Robot* original, int player) { return factory(player); };
+}
+
+std::unique_ptr<RoboSim> RoboSim::fork() const
+{
+     return fork(copyRobotState(robot_factory));
+}
+
+std::unique_ptr<RoboSim> RoboSim::fork(const RobotClonePolicy& policy) const
+{
+     return std::unique_ptr<RoboSim>(new RoboSim(*this,policy));
+}
+
+RoboSim::RoboSim(const RoboSim& original, const RobotClonePolicy& policy) :
+     worldGrid(original.worldGrid), turnOrder(original.turnOrder), turnOrder_pos(original.turnOrder_pos),
+     num_players(original.num_players), robot_factory(original.robot_factory),
+     seed(original.seed), placement_rng(original.placement_rng), combat_rng(original.combat_rng),
+     landmark_count(original.landmark_count), landmarks(original.landmarks), landmarks_version(original.landmarks_version),
+     snapshots(original.snapshots), world_id(++world_ids), radio(original.radio),
+     simultaneous(original.simultaneous)
+{
+     //The grid's chunks are now shared with the original; the occupant
+     //plane holds slots in turnOrder, so it's valid for our copy too
+     worldGrid.robots = &turnOrder;
+
+     for(RobotData& x : turnOrder)
+          x.robot = NULL;
+     try
+     {
+          RobotTable::const_iterator from = original.turnOrder.begin();
+          for(RobotData& x : turnOrder)
+          {
+               attachRobot(x,policy(from->robot,x.player));
+               if(x.robot==NULL)
+                    throw RoboSimExecutionException("robot clone policy failed to supply a robot",x.player);
+               ++from;
+          }
+     }
+     catch(...)
+     {
+          for(RobotData& x : turnOrder)
+               delete x.robot;
+          throw;
+     }
+}
+
 Robot_Specs RoboSim::checkSpecsValid(Robot_Specs proposed, int player, int skill_points)
 {
-     if(proposed.attack + proposed.defense + proposed.power + proposed.charge != skill_points)
+     if(!specsValid(proposed,skill_points))
           throw RoboSimExecutionException("attempted to create invalid robot!",player);
      else
           return proposed;
 }
 
-RoboSim::RoboSim(int initial_robots_per_combatant, int skill_points, int length, int width, int obstacles) :
-     worldGrid(length,vector<GridCell>(width)), turnOrder(RBP_NUM_PLAYERS*initial_robots_per_combatant),
-     turnOrder_pos(0)
+RoboSim::RoboSim(int initial_robots_per_combatant, int skill_points, int length, int width, int obstacles, std::uint64_t seed) :
+     RoboSim(initial_robots_per_combatant,skill_points,length,width,obstacles,RBP_NUM_PLAYERS,rbp_construct_robot,seed) { }
+
+RoboSim::RoboSim(int initial_robots_per_combatant, int skill_points, int length, int width, int obstacles, int players, RobotFactory factory, std::uint64_t seed_) :
+     worldGrid(length,width), turnOrder_pos(0), num_players(players), robot_factory(factory),
+     seed(seed_), placement_rng(seed_), combat_rng(seed_),
+     landmark_count(0), landmarks_version(0), world_id(++world_ids), simultaneous(false)
 {
-     for(int i=0; i<length; i++)
-          for(int j=0; j<width; j++)
-          {
-               worldGrid[i][j].x_coord = i;
-               worldGrid[i][j].y_coord = j;
-               worldGrid[i][j].contents = EMPTY;
-          }
+     worldGrid.robots = &turnOrder;
+     combat_rng.jump();
 
      //Add robots for each combatant
-     for(int player=1; player<=RBP_NUM_PLAYERS; player++)
+     for(int player=1; player<=num_players; player++)
      {
           for(int i=0; i<initial_robots_per_combatant; i++)
           {
                int x_pos,y_pos;
                do
                {
-                    x_pos = rand()%length;
-                    y_pos = rand()%width;
-               } while(worldGrid[x_pos][y_pos].contents!=EMPTY);
-
-               worldGrid[x_pos][y_pos].contents = SELF;
-               RobotData& data = turnOrder[(player-1)*initial_robots_per_combatant+i];
-               worldGrid[x_pos][y_pos].occupant_data = &data;
-               data.assoc_cell = &worldGrid[x_pos][y_pos];
-               data.robot = RBP_CALL_CONSTRUCTOR(player);
-               data.player = player;
-               vector<uint8_t> creation_message(64);
-               creation_message[1] = turnOrder_pos % 256;
-               creation_message[0] = turnOrder_pos / 256;
-               data.specs = checkSpecsValid(data.robot->createRobot(NULL, skill_points, creation_message), player, skill_points);
-               data.status.charge = data.status.health = data.specs.charge*10;
+                    x_pos = placement_rng.below(length);
+                    y_pos = placement_rng.below(width);
+               } while(worldGrid.contents(x_pos,y_pos)!=EMPTY);
 
-               data.status.defense_boost = 0;
-               data.whatBuilding = NOTHING;
-               data.investedPower = 0;
-               data.invested_assoc_cell = NULL;
+               spawnRobot(turnOrder.add(),player,worldGrid.index(x_pos,y_pos),skill_points);
           }
      }
 
@@ -112,25 +594,84 @@ RoboSim::RoboSim(int initial_robots_per_combatant, int skill_points, int length,
           int x_pos, y_pos;
           do
           {
-               x_pos = rand()%length;
-               y_pos = rand()%width;
-          } while(worldGrid[x_pos][y_pos].contents!=EMPTY);
-          worldGrid[x_pos][y_pos].contents = WALL;
-          worldGrid[x_pos][y_pos].wallforthealth = WALL_HEALTH;
+               x_pos = placement_rng.below(length);
+               y_pos = placement_rng.below(width);
+          } while(worldGrid.contents(x_pos,y_pos)!=EMPTY);
+          worldGrid.setContents(worldGrid.index(x_pos,y_pos),WALL);
+          worldGrid.setWallHealth(worldGrid.index(x_pos,y_pos),WALL_HEALTH);
      }
 }
 
-AttackResult RoboSim::RoboAPIImplementor::processAttack(int attack, GridCell& cell_to_attack, int power)
+RoboSim::RoboSim(const Scenario& scenario, int skill_points, RobotFactory factory, std::uint64_t seed_) :
+     worldGrid(scenario.length,scenario.width), turnOrder_pos(0),
+     num_players(scenario.players), robot_factory(factory),
+     seed(seed_), placement_rng(seed_), combat_rng(seed_),
+     landmark_count(0), landmarks_version(0), world_id(++world_ids), simultaneous(false)
+{
+     worldGrid.robots = &turnOrder;
+     combat_rng.jump();
+
+     if(int(scenario.terrain.size())!=worldGrid.size() || int(scenario.fort_orientation.size())!=worldGrid.size() || int(scenario.spawns.size())!=num_players)
+          throw RoboSimExecutionException("scenario is malformed");
+
+     for(int i=0; i<worldGrid.size(); i++)
+          switch(scenario.terrain[i])
+          {
+          case EMPTY:
+               break;
+          case FORT:
+               worldGrid.setFortOrientation(i,scenario.fort_orientation[i]);
+               //fall through
+          case WALL:
+               worldGrid.setContents(i,scenario.terrain[i]);
+               worldGrid.setWallHealth(i,WALL_HEALTH);
+               break;
+          default:
+               throw RoboSimExecutionException("scenario has terrain other than walls and forts");
+          }
+
+     for(int player=1; player<=num_players; player++)
+          for(int idx : scenario.spawns[player-1])
+          {
+               if(idx<0 || idx>=worldGrid.size() || (worldGrid.contents(idx)!=EMPTY && worldGrid.contents(idx)!=FORT))
+                    throw RoboSimExecutionException("scenario starts a robot on an occupied cell",player);
+               spawnRobot(turnOrder.add(),player,idx,skill_points);
+          }
+}
+
+void RoboSim::spawnRobot(RobotData& data, int player, int idx, int skill_points)
+{
+     worldGrid.setContents(idx,SELF);
+     worldGrid.setOccupant(idx,&data);
+     data.assoc_cell = idx;
+     attachRobot(data,robot_factory(player));
+     data.player = player;
+     vector<uint8_t> creation_message(64);
+     creation_message[1] = turnOrder_pos % 256;
+     creation_message[0] = turnOrder_pos / 256;
+     data.specs = checkSpecsValid(createRobot(data, skill_points, creation_message), player, skill_points);
+     data.status.charge = data.status.health = data.specs.charge*10;
+
+     data.status.defense_boost = 0;
+     data.whatBuilding = NOTHING;
+     data.investedPower = 0;
+     data.invested_assoc_cell = -1;
+}
+
+AttackResult RoboSim::RoboAPIImplementor::processAttack(int attack, int cell_to_attack, int power)
 {
      //Holds result of attack
      AttackResult to_return = MISSED;
 
+     WorldGrid& worldGrid = rsim.worldGrid;
+     RobotData* const occupant = worldGrid.occupant(cell_to_attack);
+
      //Calculate defense skill of opponent
      int defense = 0;
-     switch(cell_to_attack.contents)
+     switch(worldGrid.contents(cell_to_attack))
      {
      case SELF:
-          defense = cell_to_attack.occupant_data->specs.defense + cell_to_attack.occupant_data->status.defense_boost;
+          defense = occupant->specs.defense + occupant->status.defense_boost;
           break;
 
      case FORT:
@@ -146,85 +687,87 @@ AttackResult RoboSim::RoboAPIImplementor::processAttack(int attack, GridCell& ce
           //We hit
           to_return = HIT;
 
-          if(cell_to_attack.occupant_data!=NULL)
+          if(occupant!=NULL)
           {
                //we're a robot
-               for(int i=0; true; i++)
-                    if(&rsim.turnOrder[i]==cell_to_attack.occupant_data)
-                    {
-                         if((cell_to_attack.occupant_data->status.health-=power)<=0)
-                         {
-                              //We destroyed the opponent!
-                              to_return = DESTROYED_TARGET;
-
-                              //Handle in-progress build, reusing setBuildTarget() to handle interruption of build due to death
-                              RoboAPIImplementor(rsim,*(cell_to_attack.occupant_data)).setBuildTarget(NOTHING,cell_to_attack.occupant_data->invested_assoc_cell);
-
-                              //Handle cell
-                              cell_to_attack.occupant_data = NULL;
-                              cell_to_attack.contents = cell_to_attack.wallforthealth>0 ? FORT : EMPTY;
-
-                              //Handle turnOrder position
-                              rsim.turnOrder.erase(rsim.turnOrder.begin()+i);
-                              if(i<rsim.turnOrder_pos)
-                                   rsim.turnOrder_pos--;
-                         }
-                         break;
-                    }
+               if((occupant->status.health-=power)<=0)
+               {
+                    //We destroyed the opponent!
+                    to_return = DESTROYED_TARGET;
+
+                    //Handle in-progress build, reusing setBuildTarget() to handle interruption of build due to death
+                    //(the build is finalized from the robot's own record of it, so no location is needed)
+                    RoboAPIImplementor(rsim,*occupant).setBuildTarget(NOTHING,NULL);
+
+                    //Handle cell
+                    worldGrid.setOccupant(cell_to_attack,NULL);
+                    rsim.allies.remove(occupant->player,cell_to_attack);
+                    worldGrid.setContents(cell_to_attack,worldGrid.wallHealth(cell_to_attack)>0 ? FORT : EMPTY);
+
+                    //Messages waiting for it won't be read
+                    rsim.radio.releaseAll(occupant->buffered_radio);
+
+                    //Handle turnOrder position (the slot is freed at the end of the time step)
+                    delete occupant->robot;
+                    attachRobot(*occupant,NULL);
+                    rsim.turnOrder.kill(*occupant);
+               }
           }
           else
-               if((cell_to_attack.wallforthealth-=power)<=0)
+          {
+               const int wallforthealth = worldGrid.wallHealth(cell_to_attack)-power;
+               worldGrid.setWallHealth(cell_to_attack,wallforthealth);
+               if(wallforthealth<=0)
                {
                     //We destroyed the target!
                     to_return = DESTROYED_TARGET;
 
-                    cell_to_attack.wallforthealth = 0;
-                    cell_to_attack.contents = EMPTY;
+                    worldGrid.setContents(cell_to_attack,EMPTY);
                }
+          }
      }
 
      return to_return;
 }
 
-AttackResult RoboSim::RoboAPIImplementor::meleeAttack(int power, GridCell& adjacent_cell)
+ActionResult RoboSim::RoboAPIImplementor::try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result)
 {
      //Lots of error checking here (as everywhere...)
 
      //Check that we're using a valid amount of power
      if(power > actingRobot.status.power || power > actingRobot.specs.attack || power < 1)
-          throw RoboSimExecutionException("attempted melee attack with illegal power level",actingRobot.player,*actingRobot.assoc_cell);
+          return refuse(INVALID_POWER,"attempted melee attack with illegal power level");
 
      //Are cells adjacent?
      if(!isAdjacent(adjacent_cell))
-          throw RoboSimExecutionException("attempted to melee attack nonadjacent cell",actingRobot.player,*actingRobot.assoc_cell);
+          return refuse(OUT_OF_RANGE,"attempted to melee attack nonadjacent cell");
 
      //Does cell exist in grid?
      //(could put this in isAdjacent() method but want to give students more useful error messages)
-     if(adjacent_cell.x_coord > rsim.worldGrid.size() || adjacent_cell.y_coord > rsim.worldGrid[0].size() ||
-        adjacent_cell.x_coord < 0 || adjacent_cell.y_coord < 0)
-          throw RoboSimExecutionException("passed invalid cell coordinates to meleeAttack()",actingRobot.player,*actingRobot.assoc_cell,adjacent_cell);
+     if(!rsim.worldGrid.inBounds(adjacent_cell.x_coord,adjacent_cell.y_coord))
+          return refuse(INVALID_CELL,"passed invalid cell coordinates to meleeAttack()",adjacent_cell);
 
      //Safe to use this now, checked for oob condition from student
-     GridCell& cell_to_attack = rsim.worldGrid[adjacent_cell.x_coord][adjacent_cell.y_coord];
+     const int cell_to_attack = rsim.worldGrid.index(adjacent_cell.x_coord,adjacent_cell.y_coord);
 
      //Is there an enemy, fort, or wall at the cell's location?
-     switch(cell_to_attack.contents)
+     switch(rsim.worldGrid.contents(cell_to_attack))
      {
      case EMPTY:
-          throw RoboSimExecutionException("attempted to attack empty cell",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack empty cell",cell_to_attack);
      case BLOCKED:
-          throw RoboSimExecutionException("attempted to attack blocked tile",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack blocked tile",cell_to_attack);
      case SELF:
-          if(cell_to_attack.occupant_data->player==actingRobot.player)
-               throw RoboSimExecutionException("attempted to attack ally",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          if(rsim.worldGrid.occupant(cell_to_attack)->player==actingRobot.player)
+               return refuseAt(INVALID_TARGET,"attempted to attack ally",cell_to_attack);
           break;
      case CAPSULE:
-          throw RoboSimExecutionException("attempted to attack energy capsule",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack energy capsule",cell_to_attack);
      case ALLY:
-          throw RoboSimExecutionException("ERROR in RoboSim.RoboAPIImplementor.meleeAttack().  This is probably not the student's fault.  Contact Patrick Simmons about this message.  (Not the Doobie Brother...)");
+          return ActionResult(INTERNAL_ERROR,"ERROR in RoboSim.RoboAPIImplementor.meleeAttack().  This is probably not the student's fault.  Contact Patrick Simmons about this message.  (Not the Doobie Brother...)");
      }
                     
-     //Okay, if we haven't thrown an exception, the cell is valid to attack.  Perform the attack.
+     //Okay, if we haven't refused, the cell is valid to attack.  Perform the attack.
      //Update this robot's charge status and power status.
      actingRobot.status.charge-=power;
      actingRobot.status.power-=power;
@@ -233,62 +776,62 @@ AttackResult RoboSim::RoboAPIImplementor::meleeAttack(int power, GridCell& adjac
      int raw_attack = actingRobot.specs.attack;
 
      //If we're outside a fort attacking someone in the fort, range penalty applies
-     if(cell_to_attack.wallforthealth > 0 && cell_to_attack.occupant_data!=NULL)
+     if(rsim.worldGrid.wallHealth(cell_to_attack) > 0 && rsim.worldGrid.occupant(cell_to_attack)!=NULL)
           raw_attack/=2;
 
      //Attack adds power of attack to raw skill
      int attack = raw_attack + power;
 
      //Process attack
-     return processAttack(attack,cell_to_attack,power);
+     result = processAttack(attack,cell_to_attack,power);
+     return ActionResult();
 }
 
-AttackResult RoboSim::RoboAPIImplementor::rangedAttack(int power, GridCell& nonadjacent_cell)
+ActionResult RoboSim::RoboAPIImplementor::try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result)
 {
      //Lots of error checking here (as everywhere...)
 
      //Check that we're using a valid amount of power
      if(power > actingRobot.status.power || power > actingRobot.specs.attack || power < 1)
-          throw RoboSimExecutionException("attempted ranged attack with illegal power level",actingRobot.player,*actingRobot.assoc_cell);
+          return refuse(INVALID_POWER,"attempted ranged attack with illegal power level");
 
      //Does cell exist in grid?
      //(could put this in isAdjacent() method but want to give students more useful error messages)
-     if(nonadjacent_cell.x_coord > rsim.worldGrid.size() || nonadjacent_cell.y_coord > rsim.worldGrid[0].size() ||
-        nonadjacent_cell.x_coord < 0 || nonadjacent_cell.y_coord < 0)
-          throw RoboSimExecutionException("passed invalid cell coordinates to rangedAttack()",actingRobot.player,*actingRobot.assoc_cell,nonadjacent_cell);
+     if(!rsim.worldGrid.inBounds(nonadjacent_cell.x_coord,nonadjacent_cell.y_coord))
+          return refuse(INVALID_CELL,"passed invalid cell coordinates to rangedAttack()",nonadjacent_cell);
 
      //Are cells nonadjacent?
      if(isAdjacent(nonadjacent_cell))
-          throw RoboSimExecutionException("attempted to range attack adjacent cell",actingRobot.player,*actingRobot.assoc_cell);
+          return refuse(OUT_OF_RANGE,"attempted to range attack adjacent cell");
 
      //Safe to use this now, checked for oob condition from student
-     GridCell& cell_to_attack = rsim.worldGrid[nonadjacent_cell.x_coord][nonadjacent_cell.y_coord];
+     const int cell_to_attack = rsim.worldGrid.index(nonadjacent_cell.x_coord,nonadjacent_cell.y_coord);
 
      //Do we have a "clear shot"?
-     list<GridCell*> shortest_path = robot_api::RobotUtility::findShortestPath(*actingRobot.assoc_cell,cell_to_attack,rsim.worldGrid);
-     if(!shortest_path.size()) //we don't have a clear shot
-          throw RoboSimExecutionException("attempted to range attack cell with no clear path",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
-     else if(shortest_path.size()>actingRobot.specs.defense) //out of range
-          throw RoboSimExecutionException("attempted to range attack cell more than (defense) tiles away",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+     const int shortest_path = rsim.shortestPathLength(actingRobot.assoc_cell,cell_to_attack);
+     if(!shortest_path) //we don't have a clear shot
+          return refuseAt(PATH_BLOCKED,"attempted to range attack cell with no clear path",cell_to_attack);
+     else if(shortest_path>actingRobot.specs.defense) //out of range
+          return refuseAt(OUT_OF_RANGE,"attempted to range attack cell more than (defense) tiles away",cell_to_attack);
 
      //Is there an enemy, fort, or wall at the cell's location?
-     switch(cell_to_attack.contents)
+     switch(rsim.worldGrid.contents(cell_to_attack))
      {
      case EMPTY:
-          throw RoboSimExecutionException("attempted to attack empty cell",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack empty cell",cell_to_attack);
      case BLOCKED:
-          throw RoboSimExecutionException("attempted to attack blocked tile",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack blocked tile",cell_to_attack);
      case SELF:
-          if(cell_to_attack.occupant_data->player==actingRobot.player)
-               throw RoboSimExecutionException("attempted to attack ally",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          if(rsim.worldGrid.occupant(cell_to_attack)->player==actingRobot.player)
+               return refuseAt(INVALID_TARGET,"attempted to attack ally",cell_to_attack);
           break;
      case CAPSULE:
-          throw RoboSimExecutionException("attempted to attack energy capsule",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack energy capsule",cell_to_attack);
      case ALLY:
-          throw RoboSimExecutionException("ERROR in RoboSim.RoboAPIImplementor.rangedAttack().  This is probably not the student's fault.  Contact Patrick Simmons about this message.  (Not the Doobie Brother...)");
+          return ActionResult(INTERNAL_ERROR,"ERROR in RoboSim.RoboAPIImplementor.rangedAttack().  This is probably not the student's fault.  Contact Patrick Simmons about this message.  (Not the Doobie Brother...)");
      }
 
-     //Okay, if we haven't thrown an exception, the cell is valid to attack.  Perform the attack.
+     //Okay, if we haven't refused, the cell is valid to attack.  Perform the attack.
      //Update this robot's charge status.
      actingRobot.status.charge-=power;
      actingRobot.status.power-=power;
@@ -300,73 +843,74 @@ AttackResult RoboSim::RoboAPIImplementor::rangedAttack(int power, GridCell& nona
      int attack = raw_attack + power;
 
      //Process attack
-     return processAttack(attack,cell_to_attack,power);
+     result = processAttack(attack,cell_to_attack,power);
+     return ActionResult();
 }
 
-AttackResult RoboSim::RoboAPIImplementor::capsuleAttack(int power_of_capsule, GridCell& cell)
+ActionResult RoboSim::RoboAPIImplementor::try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result)
 {
      //Error checking, *sigh*...
 
      //Does cell exist in grid?
-     if(cell.x_coord > rsim.worldGrid.size() || cell.y_coord > rsim.worldGrid[0].size() || cell.x_coord < 0 || cell.y_coord < 0)
-          throw RoboSimExecutionException("passed invalid cell coordinates to capsuleAttack()",actingRobot.player,*actingRobot.assoc_cell,cell);
+     if(!rsim.worldGrid.inBounds(cell.x_coord,cell.y_coord))
+          return refuse(INVALID_CELL,"passed invalid cell coordinates to capsuleAttack()",cell);
 
      //Cell to attack
-     GridCell& cell_to_attack = rsim.worldGrid[cell.x_coord][cell.y_coord];
+     const int cell_to_attack = rsim.worldGrid.index(cell.x_coord,cell.y_coord);
 
      //Do we have a capsule of this power rating?
-     auto capsule_it = find(actingRobot.status.capsules.begin(),actingRobot.status.capsules.end(),power_of_capsule);
-
-     if(capsule_it==actingRobot.status.capsules.end())
-          throw RoboSimExecutionException(string("passed invalid power to capsuleAttack(): doesn't have capsule of power ")+to_string(power_of_capsule),actingRobot.player,*actingRobot.assoc_cell);
+     if(!actingRobot.status.capsules.has(power_of_capsule))
+          return refuse(CAPSULE_UNAVAILABLE,"passed invalid power to capsuleAttack(): doesn't have capsule of power %d").withDetail(power_of_capsule);
 
      //Can we use this capsule? (attack + defense >= power)
      if(actingRobot.specs.attack + actingRobot.specs.defense < power_of_capsule)
-          throw RoboSimExecutionException("attempted to use capsule of greater power than attack+defense",actingRobot.player,*actingRobot.assoc_cell);
+          return refuse(INVALID_POWER,"attempted to use capsule of greater power than attack+defense");
 
      //Can we hit the target?  Range is power of capsule + defense.
-     list<GridCell*> shortest_path = robot_api::RobotUtility::findShortestPath(*actingRobot.assoc_cell,cell_to_attack,rsim.worldGrid);
+     const int shortest_path = rsim.shortestPathLength(actingRobot.assoc_cell,cell_to_attack);
 
-     if(!shortest_path.size())
-          throw RoboSimExecutionException("no clear shot to target",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+     if(!shortest_path)
+          return refuseAt(PATH_BLOCKED,"no clear shot to target",cell_to_attack);
 
-     if(shortest_path.size() > power_of_capsule + actingRobot.specs.defense)
-          throw RoboSimExecutionException("target not in range",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+     if(shortest_path > power_of_capsule + actingRobot.specs.defense)
+          return refuseAt(OUT_OF_RANGE,"target not in range",cell_to_attack);
 
      //Is there an enemy, fort, or wall at the cell's location?
-     switch(cell_to_attack.contents)
+     switch(rsim.worldGrid.contents(cell_to_attack))
      {
      case EMPTY:
-          throw RoboSimExecutionException("attempted to attack empty cell",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack empty cell",cell_to_attack);
      case BLOCKED:
-          throw RoboSimExecutionException("attempted to attack blocked tile",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack blocked tile",cell_to_attack);
      case SELF:
-          if(cell_to_attack.occupant_data->player==actingRobot.player)
-               throw RoboSimExecutionException("attempted to attack ally",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          if(rsim.worldGrid.occupant(cell_to_attack)->player==actingRobot.player)
+               return refuseAt(INVALID_TARGET,"attempted to attack ally",cell_to_attack);
           break;
      case CAPSULE:
-          throw RoboSimExecutionException("attempted to attack energy capsule",actingRobot.player,*actingRobot.assoc_cell,cell_to_attack);
+          return refuseAt(INVALID_TARGET,"attempted to attack energy capsule",cell_to_attack);
      case ALLY:
-          throw RoboSimExecutionException("ERROR in RoboSim.RoboAPIImplementor.capsuleAttack().  This is probably not the student's fault.  Contact Patrick Simmons about this message.  (Not the Doobie Brother...)");
+          return ActionResult(INTERNAL_ERROR,"ERROR in RoboSim.RoboAPIImplementor.capsuleAttack().  This is probably not the student's fault.  Contact Patrick Simmons about this message.  (Not the Doobie Brother...)");
      }
 
      /*Okay, if we're still here, we can use the capsule.
        Need to delete capsule from robot status structure.
      */
-     actingRobot.status.capsules.erase(capsule_it);
+     actingRobot.status.capsules.remove(power_of_capsule);
 
      //Process attack
-     return processAttack(actingRobot.specs.attack + power_of_capsule,cell_to_attack,(int)(ceil(0.1 * power_of_capsule * actingRobot.specs.attack)));
+     result = processAttack(actingRobot.specs.attack + power_of_capsule,cell_to_attack,(int)(ceil(0.1 * power_of_capsule * actingRobot.specs.attack)));
+     return ActionResult();
 }
 
-void RoboSim::RoboAPIImplementor::move(int steps, Direction way)
+ActionResult RoboSim::RoboAPIImplementor::try_move(int steps, Direction way)
 {
      if(steps<1)
-          return;
+          return ActionResult();
 
-     int x_coord = actingRobot.assoc_cell->x_coord;
+     WorldGrid& worldGrid = rsim.worldGrid;
+     int x_coord = worldGrid.xOf(actingRobot.assoc_cell);
      const int actor_x = x_coord;
-     int y_coord = actingRobot.assoc_cell->y_coord;
+     int y_coord = worldGrid.yOf(actingRobot.assoc_cell);
      const int actor_y = y_coord;
      switch(way)
      {
@@ -385,16 +929,18 @@ void RoboSim::RoboAPIImplementor::move(int steps, Direction way)
      }
 
      //Is our destination in the map?
-     if(x_coord < 0 || x_coord > rsim.worldGrid.size() || y_coord < 0 || y_coord > rsim.worldGrid[0].size())
-          throw RoboSimExecutionException("attempted to move out of bounds",actingRobot.player,*actingRobot.assoc_cell);
+     if(!worldGrid.inBounds(x_coord,y_coord))
+          return refuse(INVALID_CELL,"attempted to move out of bounds");
+
+     const int destination = worldGrid.index(x_coord,y_coord);
 
      //Is our destination empty?
-     if(rsim.worldGrid[x_coord][y_coord].contents!=EMPTY && rsim.worldGrid[x_coord][y_coord].contents!=FORT)
-          throw RoboSimExecutionException("attempted to move onto illegal cell",actingRobot.player,*actingRobot.assoc_cell,rsim.worldGrid[x_coord][y_coord]);
+     if(worldGrid.contents(destination)!=EMPTY && worldGrid.contents(destination)!=FORT)
+          return refuseAt(INVALID_TARGET,"attempted to move onto illegal cell",destination);
 
      //Are we approaching the fort from the right angle?
-     if(rsim.worldGrid[x_coord][y_coord].contents==FORT && rsim.worldGrid[x_coord][y_coord].fort_orientation!=way)
-          throw RoboSimExecutionException("attempted to move onto a fort from an illegal direction",actingRobot.player,*actingRobot.assoc_cell,rsim.worldGrid[x_coord][y_coord]);
+     if(worldGrid.contents(destination)==FORT && worldGrid.fortOrientation(destination)!=way)
+          return refuseAt(INVALID_TARGET,"attempted to move onto a fort from an illegal direction",destination);
 
      //Okay, now we have to make sure each step is empty
      const bool x_left = x_coord<actor_x;
@@ -402,58 +948,60 @@ void RoboSim::RoboAPIImplementor::move(int steps, Direction way)
      if(x_coord!=actor_x)
      {
           for(int i=(x_left ? actor_x-1 : actor_x+1); i!=x_coord; i=(x_left ? i-1 : i+1))
-               if(rsim.worldGrid[i][y_coord].contents!=EMPTY)
-                    throw RoboSimExecutionException("attempted to cross illegal cell",actingRobot.player,*actingRobot.assoc_cell,rsim.worldGrid[i][y_coord]);
+               if(worldGrid.contents(i,y_coord)!=EMPTY)
+                    return refuse(PATH_BLOCKED,"attempted to cross illegal cell",i,y_coord);
      }
      else
      {
           for(int i=(y_left ? actor_y-1 : actor_y+1); i!=y_coord; i=(y_left ? i-1 : i+1))
-               if(rsim.worldGrid[x_coord][i].contents!=EMPTY)
-                    throw RoboSimExecutionException("attempted to cross illegal cell",actingRobot.player,*actingRobot.assoc_cell,rsim.worldGrid[x_coord][i]);
+               if(worldGrid.contents(x_coord,i)!=EMPTY)
+                    return refuse(PATH_BLOCKED,"attempted to cross illegal cell",x_coord,i);
      }
 
      //Okay, now: do we have enough power/charge?
      if(steps > actingRobot.status.power)
-          throw RoboSimExecutionException("attempted to move too far (not enough power)",actingRobot.player,*actingRobot.assoc_cell,rsim.worldGrid[x_coord][y_coord]);
+          return refuseAt(INVALID_POWER,"attempted to move too far (not enough power)",destination);
 
      //Account for power cost
      actingRobot.status.power-=steps;
      actingRobot.status.charge-=steps;
 
      //Change position of robot.
-     actingRobot.assoc_cell->contents = EMPTY;
-     actingRobot.assoc_cell->occupant_data = NULL;
-     actingRobot.assoc_cell = &rsim.worldGrid[x_coord][y_coord];
-     actingRobot.assoc_cell->contents = SELF;
-     actingRobot.assoc_cell->occupant_data = &actingRobot;
+     worldGrid.setContents(actingRobot.assoc_cell,EMPTY);
+     worldGrid.setOccupant(actingRobot.assoc_cell,NULL);
+     rsim.allies.move(actingRobot.player,actingRobot.assoc_cell,destination);
+     actingRobot.assoc_cell = destination;
+     worldGrid.setContents(destination,SELF);
+     worldGrid.setOccupant(destination,&actingRobot);
+     return ActionResult();
 }
 
-void RoboSim::RoboAPIImplementor::pick_up_capsule(GridCell& adjacent_cell)
+ActionResult RoboSim::RoboAPIImplementor::try_pick_up_capsule(GridCell& adjacent_cell)
 {
      //Error checking, *sigh*...
 
      //Does cell exist in grid?
-     if(adjacent_cell.x_coord > rsim.worldGrid.size() || adjacent_cell.y_coord > rsim.worldGrid[0].size() || adjacent_cell.x_coord < 0 || adjacent_cell.y_coord < 0)
-          throw RoboSimExecutionException("passed invalid cell coordinates to pick_up_capsule()",actingRobot.player,*actingRobot.assoc_cell,adjacent_cell);
+     if(!rsim.worldGrid.inBounds(adjacent_cell.x_coord,adjacent_cell.y_coord))
+          return refuse(INVALID_CELL,"passed invalid cell coordinates to pick_up_capsule()",adjacent_cell);
 
      //Cell in question
-     GridCell& gridCell = rsim.worldGrid[adjacent_cell.x_coord][adjacent_cell.y_coord];
+     const int gridCell = rsim.worldGrid.index(adjacent_cell.x_coord,adjacent_cell.y_coord);
 
      //Cell must be adjacent
      if(!isAdjacent(adjacent_cell))
-          throw RoboSimExecutionException("attempted to pick up capsule in nonadjacent cell",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+          return refuseAt(OUT_OF_RANGE,"attempted to pick up capsule in nonadjacent cell",gridCell);
 
      //We need at least one power.
      if(actingRobot.status.power==0)
-          throw RoboSimExecutionException("attempted to pick up capsule with no power",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+          return refuseAt(INVALID_POWER,"attempted to pick up capsule with no power",gridCell);
 
      //Is there actually a capsule there?
-     if(gridCell.contents!=CAPSULE)
-          throw RoboSimExecutionException("attempted to pick up capsule from cell with no capsule",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+     if(rsim.worldGrid.contents(gridCell)!=CAPSULE)
+          return refuseAt(INVALID_TARGET,"attempted to pick up capsule from cell with no capsule",gridCell);
 
      //Do we have "room" for this capsule?
      if(actingRobot.status.capsules.size()+1>actingRobot.specs.attack+actingRobot.specs.defense)
-          throw RoboSimExecutionException("attempted to pick up too many capsules",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+          return refuseAt(CAPSULE_UNAVAILABLE,"attempted to pick up too many capsules",gridCell);
 
      //If still here, yes.
 
@@ -461,47 +1009,51 @@ void RoboSim::RoboAPIImplementor::pick_up_capsule(GridCell& adjacent_cell)
      actingRobot.status.power--;
 
      //Put capsule in our inventory, delete it from world
-     actingRobot.status.capsules.push_back(gridCell.capsule_power);
-     gridCell.contents = EMPTY;
-     gridCell.capsule_power = 0;
+     actingRobot.status.capsules.add(rsim.worldGrid.capsulePower(gridCell));
+     rsim.worldGrid.setContents(gridCell,EMPTY);
+     rsim.worldGrid.setCapsulePower(gridCell,0);
+     return ActionResult();
 }
 
-void RoboSim::RoboAPIImplementor::drop_capsule(GridCell& adjacent_cell, int power_of_capsule)
+ActionResult RoboSim::RoboAPIImplementor::try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule)
 {
      //Error checking, *sigh*...
      //Does cell exist in grid?
-     if(adjacent_cell.x_coord > rsim.worldGrid.size() || adjacent_cell.y_coord > rsim.worldGrid[0].size() || adjacent_cell.x_coord < 0 || adjacent_cell.y_coord < 0)
-          throw RoboSimExecutionException("passed invalid cell coordinates to pick_up_capsule()",actingRobot.player,*actingRobot.assoc_cell,adjacent_cell);
+     if(!rsim.worldGrid.inBounds(adjacent_cell.x_coord,adjacent_cell.y_coord))
+          return refuse(INVALID_CELL,"passed invalid cell coordinates to pick_up_capsule()",adjacent_cell);
 
      //Cell in question
-     GridCell& gridCell = rsim.worldGrid[adjacent_cell.x_coord][adjacent_cell.y_coord];
+     const int gridCell = rsim.worldGrid.index(adjacent_cell.x_coord,adjacent_cell.y_coord);
 
      //Cell must be adjacent
      if(!isAdjacent(adjacent_cell))
-          throw RoboSimExecutionException("attempted to pick up capsule in nonadjacent cell",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+          return refuseAt(OUT_OF_RANGE,"attempted to pick up capsule in nonadjacent cell",gridCell);
 
      //Is the cell empty?
-     if(gridCell.contents!=EMPTY)
-          throw RoboSimExecutionException("attempted to place capsule in nonempty cell",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+     if(rsim.worldGrid.contents(gridCell)!=EMPTY)
+          return refuseAt(INVALID_TARGET,"attempted to place capsule in nonempty cell",gridCell);
 
      //Do we have such a capsule?
-     auto it = find(actingRobot.status.capsules.begin(),actingRobot.status.capsules.end(),power_of_capsule);
-     if(it==actingRobot.status.capsules.end())
-          throw RoboSimExecutionException(string("attempted to drop capsule with power ")+to_string(power_of_capsule)+", having no such capsule",actingRobot.player,*actingRobot.assoc_cell,gridCell);
+     if(!actingRobot.status.capsules.has(power_of_capsule))
+          return refuseAt(CAPSULE_UNAVAILABLE,"attempted to drop capsule with power %d, having no such capsule",gridCell).withDetail(power_of_capsule);
 
      //Okay.  We're good.  Drop the capsule
-     gridCell.contents = CAPSULE;
-     gridCell.capsule_power = power_of_capsule;
+     rsim.worldGrid.setContents(gridCell,CAPSULE);
+     rsim.worldGrid.setCapsulePower(gridCell,power_of_capsule);
 
      //Delete it from our inventory
-     actingRobot.status.capsules.erase(it);
+     actingRobot.status.capsules.remove(power_of_capsule);
+     return ActionResult();
 }
 
-void RoboSim::RoboAPIImplementor::finalizeBuilding(vector<uint8_t> creation_message)
+ActionResult RoboSim::RoboAPIImplementor::finalizeBuilding(vector<uint8_t> creation_message)
 {
      //Nothing to finalize if not building anything
      if(actingRobot.whatBuilding==NOTHING)
-          return;
+          return ActionResult();
+
+     WorldGrid& worldGrid = rsim.worldGrid;
+     const int invested_cell = actingRobot.invested_assoc_cell;
 
      //What do we have to finalize?
      int capsule_power = actingRobot.investedPower/10;
@@ -510,29 +1062,29 @@ void RoboSim::RoboAPIImplementor::finalizeBuilding(vector<uint8_t> creation_mess
      case WALL:
           if(actingRobot.investedPower >= 50)
           {
-               actingRobot.invested_assoc_cell->contents = WALL;
-               actingRobot.invested_assoc_cell->wallforthealth = WALL_HEALTH;
+               worldGrid.setContents(invested_cell,WALL);
+               worldGrid.setWallHealth(invested_cell,WALL_HEALTH);
           }
           else
-               actingRobot.invested_assoc_cell->contents = EMPTY;
+               worldGrid.setContents(invested_cell,EMPTY);
           break;
 
      case FORT:
           if(actingRobot.investedPower >= 75)
           {
-               actingRobot.invested_assoc_cell->contents = FORT;
-               actingRobot.invested_assoc_cell->wallforthealth = WALL_HEALTH;
+               worldGrid.setContents(invested_cell,FORT);
+               worldGrid.setWallHealth(invested_cell,WALL_HEALTH);
           }
           else
-               actingRobot.invested_assoc_cell->contents = EMPTY;
+               worldGrid.setContents(invested_cell,EMPTY);
           break;
 
      case CAPSULE:
           if(capsule_power!=0)
           {
                if(actingRobot.status.capsules.size()+1>actingRobot.specs.attack+actingRobot.specs.defense)
-                    throw RoboSimExecutionException("attempted to finish building capsule when already at max capsule capacity",actingRobot.player,*actingRobot.assoc_cell);
-               actingRobot.status.capsules.push_back(capsule_power);
+                    return refuse(CAPSULE_UNAVAILABLE,"attempted to finish building capsule when already at max capsule capacity");
+               actingRobot.status.capsules.add(capsule_power);
           }
           break;
 
@@ -542,7 +1094,7 @@ void RoboSim::RoboAPIImplementor::finalizeBuilding(vector<uint8_t> creation_mess
           {
                //Check creation message correct size
                if(creation_message.size()!=0 && creation_message.size()!=64)
-                    throw RoboSimExecutionException("passed incorrect sized creation message to setBuildTarget()",actingRobot.player,*actingRobot.assoc_cell,*actingRobot.invested_assoc_cell);
+                    return refuseAt(INVALID_ARGUMENT,"passed incorrect sized creation message to setBuildTarget()",invested_cell);
 
                //Set default creation message if we don't have one
                if(!creation_message.size())
@@ -552,73 +1104,483 @@ void RoboSim::RoboAPIImplementor::finalizeBuilding(vector<uint8_t> creation_mess
                     creation_message[0] = rsim.turnOrder.size() / 256;
                }
 
-               //Create the robot
-               actingRobot.invested_assoc_cell->contents = SELF;
+               //Create the robot, and have it pick its specs, before it's put
+               //in the world, so a failure leaves nothing to undo but the build
                Robot* robot;
                try
                {
-                    robot = RBP_CALL_CONSTRUCTOR(actingRobot.player);
+                    robot = rsim.robot_factory(actingRobot.player);
                }
                catch(...)
                {
-                    throw RoboSimExecutionException("something went wrong calling student's constructor", actingRobot.player,*actingRobot.assoc_cell, *actingRobot.invested_assoc_cell);
+                    abandonBuild();
+                    return refuseAt(ROBOT_CREATION_FAILED,"something went wrong calling student's constructor",invested_cell);
                }
-               rsim.turnOrder.emplace_back();
-               RobotData& data = *(rsim.turnOrder.rbegin());
-               data.robot = robot;
-               data.assoc_cell = actingRobot.invested_assoc_cell;
-               actingRobot.invested_assoc_cell->occupant_data = &data;
+               RobotData unplaced;
+               attachRobot(unplaced,robot);
+               const Robot_Specs specs = rsim.createRobot(unplaced, skill_points, creation_message);
+               if(!specsValid(specs,skill_points))
+               {
+                    delete robot;
+                    abandonBuild();
+                    return ActionResult(ROBOT_CREATION_FAILED,"attempted to create invalid robot!",actingRobot.player);
+               }
+
+               worldGrid.setContents(invested_cell,SELF);
+               RobotData& data = rsim.turnOrder.add();
+               attachRobot(data,robot);
+               data.assoc_cell = invested_cell;
+               worldGrid.setOccupant(invested_cell,&data);
+               rsim.allies.add(actingRobot.player,invested_cell);
                data.player = actingRobot.player;
-               data.specs = checkSpecsValid(data.robot->createRobot(NULL, skill_points, creation_message), actingRobot.player, skill_points);
+               data.specs = specs;
                data.status.charge = data.status.health = data.specs.power*10;
+               data.status.defense_boost = 0;
+               data.whatBuilding = NOTHING;
+               data.investedPower = 0;
+               data.invested_assoc_cell = -1;
           }
           else
-               actingRobot.invested_assoc_cell->contents = EMPTY;
+               worldGrid.setContents(invested_cell,EMPTY);
           break;                              
      }
+
+     //Finished
+     actingRobot.whatBuilding = NOTHING;
+     actingRobot.investedPower = 0;
+     actingRobot.invested_assoc_cell = -1;
+     return ActionResult();
+}
+
+void RoboSim::RoboAPIImplementor::abandonBuild()
+{
+     rsim.worldGrid.setContents(actingRobot.invested_assoc_cell,EMPTY);
+     actingRobot.whatBuilding = NOTHING;
+     actingRobot.investedPower = 0;
+     actingRobot.invested_assoc_cell = -1;
 }
 
-void RoboSim::RoboAPIImplementor::setBuildTarget(BuildStatus status, GridCell* location, vector<uint8_t> message)
+ActionResult RoboSim::RoboAPIImplementor::try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message)
 {
      //If we're in the middle of building something, finalize it.
      if(actingRobot.whatBuilding!=NOTHING)
-          finalizeBuilding(message);
+     {
+          const ActionResult finalized = finalizeBuilding(message);
+          if(!finalized)
+               return finalized;
+     }
 
      //Error checking, *sigh*...
 
      //Does cell exist in grid?
-     if(location!=NULL && (location->x_coord > rsim.worldGrid.size() || location->y_coord > rsim.worldGrid[0].size() || location->x_coord < 0 || location->y_coord < 0))
-          throw RoboSimExecutionException("passed invalid cell coordinates to setBuildTarget()",actingRobot.player,*actingRobot.assoc_cell,*location);
+     if(location!=NULL && !rsim.worldGrid.inBounds(location->x_coord,location->y_coord))
+          return refuse(INVALID_CELL,"passed invalid cell coordinates to setBuildTarget()",*location);
 
      //Cell in question
-     GridCell* gridCell = (location!=NULL ? &rsim.worldGrid[location->x_coord][location->y_coord] : NULL);
+     const int gridCell = (location!=NULL ? rsim.worldGrid.index(location->x_coord,location->y_coord) : -1);
+
+     //CAN pass us null, so special-case it
+     if(location==NULL)
+     {
+          //We must be building capsule, then.
+          if(status!=NOTHING && int(status)!=CAPSULE)
+               return refuse(INVALID_ARGUMENT,"passed null to setBuildTarget() location with non-null and non-capsule build target");
+     }
+     else
+     {
+          //If location NOT null, must not be building capsule
+          if(status == NOTHING || int(status) == CAPSULE)
+               return refuse(INVALID_ARGUMENT,"attempted to target capsule or null building on non-null adjacent cell",*location);
+
+          //Cell must be adjacent
+          if(!isAdjacent(*location))
+               return refuseAt(OUT_OF_RANGE,"attempted to set build target to nonadjacent cell",gridCell);
+
+          //Is the cell empty?
+          if(rsim.worldGrid.contents(gridCell)!=EMPTY)
+               return refuseAt(INVALID_TARGET,"attempted to set build target to nonempty cell",gridCell);
+
+          //Okay, block off cell since we're building there now.
+          rsim.worldGrid.setContents(gridCell,BLOCKED);
+     }
 
      //Update status
      actingRobot.whatBuilding = status;
      actingRobot.investedPower = 0;                    
      actingRobot.invested_assoc_cell = gridCell;
+     return ActionResult();
+}
+
+void RoboSim::setSimultaneousMoves(bool enabled, int threads)
+{
+     simultaneous = enabled;
+     intent_pool.reset(enabled && threads!=1 ? new ThreadPool(threads) : NULL);
+}
+
+void RoboSim::executeSimultaneousStep()
+{
+     //Every robot starts its turn at once
+     const int turns = turnOrder.turns();
+     if(int(turn_intents.size()) < turns)
+          turn_intents.resize(turns);
+     for(int pos=0; pos<turns; pos++)
+     {
+          RobotData* const robot = turnOrder.inTurn(pos);
+          if(robot!=NULL)
+               startTurn(*robot);
+          turn_intents[pos].begin(robot);
+     }
+
+     //Nothing changes the world until every robot has decided
+     if(intent_pool)
+     {
+          for(int pos=0; pos<turns; pos++)
+               if(turn_intents[pos].robot!=NULL)
+               {
+                    TurnIntents* const turn = &turn_intents[pos];
+                    intent_pool->submit([this,turn] { decideIntents(*turn); });
+               }
+          intent_pool->wait();
+     }
+     else
+          for(int pos=0; pos<turns; pos++)
+               if(turn_intents[pos].robot!=NULL)
+                    decideIntents(turn_intents[pos]);
+
+     for(int pos=0; pos<turns; pos++)
+          if(turn_intents[pos].robot!=NULL)
+               radio.releaseAll(turn_intents[pos].robot->buffered_radio);
+
+     //Robot code that threw ends the time step, with the exception the
+     //first robot in turn order threw
+     for(int pos=0; pos<turns; pos++)
+          if(turn_intents[pos].failure)
+          {
+               const std::exception_ptr failure = turn_intents[pos].failure;
+               turn_intents[pos].failure = nullptr;
+               std::rethrow_exception(failure);
+          }
+
+     resolveIntents(turns);
+}
+
+void RoboSim::decideIntents(TurnIntents& turn)
+{
+     RobotData& data = *turn.robot;
+     IntentRecorder student_api(*this,turn);
+     try
+     {
+          actRobot(data,student_api,turn.status);
+     }
+     catch(...)
+     {
+          //Tasks on the pool mustn't throw; rethrown once everyone's done
+          turn.failure = std::current_exception();
+     }
+}
+
+void RoboSim::cancelContested(int turns)
+{
+     claims.clear();
+     for(int pos=0; pos<turns; pos++)
+     {
+          const vector<Intent>& actions = turn_intents[pos].actions;
+          for(int i=0; i<int(actions.size()); i++)
+               switch(actions[i].kind)
+               {
+               case Intent::MOVE:
+               case Intent::PICK_UP_CAPSULE:
+               case Intent::DROP_CAPSULE:
+               case Intent::SET_BUILD_TARGET:
+                    if(actions[i].cell!=-1)
+                         claims.push_back(Claim{actions[i].kind,actions[i].cell,pos,i});
+                    break;
+               default:
+                    break;
+               }
+     }
+
+     std::sort(claims.begin(),claims.end());
+     int last;
+     for(int first=0; first<int(claims.size()); first=last)
+     {
+          for(last=first+1; last<int(claims.size()) && claims[last].kind==claims[first].kind && claims[last].cell==claims[first].cell; last++);
+
+          //Claims on a cell are sorted by robot, so it's contested if the
+          //first and last claimants differ
+          if(claims[first].pos!=claims[last-1].pos)
+               for(int i=first; i<last; i++)
+                    turn_intents[claims[i].pos].actions[claims[i].action].cancelled = true;
+     }
+}
+
+void RoboSim::resolveIntents(int turns)
+{
+     cancelContested(turns);
+
+     //Moves come first.  A robot blocked by one that hasn't moved yet
+     //tries again once the others have had a go, until nobody gets any
+     //further.
+     for(bool moved=true; moved; )
+     {
+          moved = false;
+          for(int pos=0; pos<turns; pos++)
+          {
+               TurnIntents& turn = turn_intents[pos];
+               if(turn.robot==NULL)
+                    continue;
+
+               RoboAPIImplementor api(*this,*turn.robot);
+               for(; turn.next_move<int(turn.actions.size()); turn.next_move++)
+               {
+                    const Intent& intent = turn.actions[turn.next_move];
+                    if(intent.kind!=Intent::MOVE)
+                         continue;
+
+                    //A robot that lost a contested cell stays where it is
+                    if(intent.cancelled)
+                    {
+                         turn.next_move = turn.actions.size();
+                         break;
+                    }
+
+                    if(!applyIntent(api,turn,intent))
+                         break;
+                    moved = true;
+               }
+          }
+     }
+
+     //Then defense and repairs, attacks, and everything else
+     for(int phase=1; phase<=3; phase++)
+          for(int pos=0; pos<turns; pos++)
+          {
+               //Robots destroyed by an attack still make their own
+               TurnIntents& turn = turn_intents[pos];
+               if(turn.robot==NULL || (phase==3 && turnOrder.inTurn(pos)==NULL))
+                    continue;
+
+               RoboAPIImplementor api(*this,*turn.robot);
+               for(const Intent& intent : turn.actions)
+                    if(intent.phase()==phase && !intent.cancelled)
+                         applyIntent(api,turn,intent);
+          }
+}
+
+ActionResult RoboSim::applyIntent(RoboAPIImplementor& api, TurnIntents& turn, const Intent& intent)
+{
+     GridCell target;
+     if(intent.cell!=-1)
+     {
+          target.x_coord = worldGrid.xOf(intent.cell);
+          target.y_coord = worldGrid.yOf(intent.cell);
+     }
+
+     AttackResult result;
+     switch(intent.kind)
+     {
+     case Intent::MOVE:
+          return api.try_move(intent.power,static_cast<Direction>(intent.detail));
+     case Intent::DEFEND:
+          return api.try_defend(intent.power);
+     case Intent::REPAIR:
+          return api.try_repair(intent.power);
+     case Intent::MELEE_ATTACK:
+          return api.try_meleeAttack(intent.power,target,result);
+     case Intent::RANGED_ATTACK:
+          return api.try_rangedAttack(intent.power,target,result);
+     case Intent::CAPSULE_ATTACK:
+          return api.try_capsuleAttack(intent.power,target,result);
+     case Intent::PICK_UP_CAPSULE:
+          return api.try_pick_up_capsule(target);
+     case Intent::DROP_CAPSULE:
+          return api.try_drop_capsule(target,intent.power);
+     case Intent::SET_BUILD_TARGET:
+          return api.try_setBuildTarget(static_cast<BuildStatus>(intent.detail),intent.cell!=-1 ? &target : NULL,turn.messages[intent.message]);
+     case Intent::BUILD:
+          return api.try_build(intent.power);
+     case Intent::CHARGE:
+          return api.try_charge(intent.power,target);
+     case Intent::SEND_MESSAGE:
+          return api.try_sendMessage(turn.messages[intent.message],intent.power);
+     case Intent::SCAN_ENEMY:
+          //The robot already has its answer; all that's left is to pay
+          if(turn.robot->status.power > 0)
+          {
+               turn.robot->status.power--;
+               turn.robot->status.charge--;
+          }
+          return ActionResult();
+     }
+     return ActionResult();
+}
+
+ActionResult RoboSim::IntentRecorder::try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result)
+{
+     const RobotData& projected = turn.projected;
+     if(power > projected.status.power || power > projected.specs.attack || power < 1)
+          return self.refuse(INVALID_POWER,"attempted melee attack with illegal power level");
+
+     if(!self.isAdjacent(adjacent_cell))
+          return self.refuse(OUT_OF_RANGE,"attempted to melee attack nonadjacent cell");
+
+     const int cell = indexOf(adjacent_cell);
+     if(cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to meleeAttack()",adjacent_cell);
+
+     //Whether it hits isn't known until the time step is resolved
+     spend(power);
+     result = MISSED;
+     return record(Intent::MELEE_ATTACK,power,cell);
+}
+
+ActionResult RoboSim::IntentRecorder::try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result)
+{
+     const RobotData& projected = turn.projected;
+     if(power > projected.status.power || power > projected.specs.attack || power < 1)
+          return self.refuse(INVALID_POWER,"attempted ranged attack with illegal power level");
+
+     const int cell = indexOf(nonadjacent_cell);
+     if(cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to rangedAttack()",nonadjacent_cell);
+
+     if(self.isAdjacent(nonadjacent_cell))
+          return self.refuse(OUT_OF_RANGE,"attempted to range attack adjacent cell");
+
+     //Range and clear shot depend on where everyone is once moves are done
+     spend(power);
+     result = MISSED;
+     return record(Intent::RANGED_ATTACK,power,cell);
+}
+
+ActionResult RoboSim::IntentRecorder::try_capsuleAttack(int power_of_capsule, GridCell& target, AttackResult& result)
+{
+     RobotData& projected = turn.projected;
+     const int cell = indexOf(target);
+     if(cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to capsuleAttack()",target);
+
+     if(!projected.status.capsules.has(power_of_capsule))
+          return self.refuse(CAPSULE_UNAVAILABLE,"passed invalid power to capsuleAttack(): doesn't have capsule of power %d").withDetail(power_of_capsule);
+
+     if(projected.specs.attack + projected.specs.defense < power_of_capsule)
+          return self.refuse(INVALID_POWER,"attempted to use capsule of greater power than attack+defense");
+
+     projected.status.capsules.remove(power_of_capsule);
+     result = MISSED;
+     return record(Intent::CAPSULE_ATTACK,power_of_capsule,cell);
+}
+
+ActionResult RoboSim::IntentRecorder::try_move(int steps, Direction way)
+{
+     if(steps<1)
+          return ActionResult();
+
+     //Moves start from wherever the robot's earlier moves took it
+     RobotData& projected = turn.projected;
+     int x_coord = rsim.worldGrid.xOf(projected.assoc_cell);
+     int y_coord = rsim.worldGrid.yOf(projected.assoc_cell);
+     switch(way)
+     {
+     case UP:
+          y_coord-=steps;
+          break;
+     case DOWN:
+          y_coord+=steps;
+          break;
+     case LEFT:
+          x_coord-=steps;
+          break;
+     case RIGHT:
+          x_coord+=steps;
+          break;
+     }
+
+     if(!rsim.worldGrid.inBounds(x_coord,y_coord))
+          return self.refuse(INVALID_CELL,"attempted to move out of bounds");
+
+     const int destination = rsim.worldGrid.index(x_coord,y_coord);
+     if(steps > projected.status.power)
+          return self.refuseAt(INVALID_POWER,"attempted to move too far (not enough power)",destination);
+
+     //Whether the way is clear depends on where everyone else goes
+     spend(steps);
+     projected.assoc_cell = destination;
+     return record(Intent::MOVE,steps,destination,way);
+}
+
+ActionResult RoboSim::IntentRecorder::try_pick_up_capsule(GridCell& adjacent_cell)
+{
+     const int cell = indexOf(adjacent_cell);
+     if(cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to pick_up_capsule()",adjacent_cell);
+
+     if(!self.isAdjacent(adjacent_cell))
+          return self.refuseAt(OUT_OF_RANGE,"attempted to pick up capsule in nonadjacent cell",cell);
+
+     if(turn.projected.status.power==0)
+          return self.refuseAt(INVALID_POWER,"attempted to pick up capsule with no power",cell);
+
+     turn.projected.status.power--;
+     return record(Intent::PICK_UP_CAPSULE,1,cell);
+}
+
+ActionResult RoboSim::IntentRecorder::try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule)
+{
+     const int cell = indexOf(adjacent_cell);
+     if(cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to pick_up_capsule()",adjacent_cell);
+
+     if(!self.isAdjacent(adjacent_cell))
+          return self.refuseAt(OUT_OF_RANGE,"attempted to pick up capsule in nonadjacent cell",cell);
+
+     if(!turn.projected.status.capsules.remove(power_of_capsule))
+          return self.refuseAt(CAPSULE_UNAVAILABLE,"attempted to drop capsule with power %d, having no such capsule",cell).withDetail(power_of_capsule);
+
+     return record(Intent::DROP_CAPSULE,power_of_capsule,cell);
+}
+
+ActionResult RoboSim::IntentRecorder::try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message)
+{
+     const int cell = (location!=NULL ? indexOf(*location) : -1);
+     if(location!=NULL && cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to setBuildTarget()",*location);
 
-     //CAN pass us null, so special-case it
      if(location==NULL)
      {
-          //We must be building capsule, then.
-          if(actingRobot.whatBuilding!=NOTHING && actingRobot.whatBuilding!=CAPSULE)
-               throw RoboSimExecutionException("passed null to setBuildTarget() location with non-null and non-capsule build target",actingRobot.player,*actingRobot.assoc_cell);
-          return;
+          if(status!=NOTHING && int(status)!=CAPSULE)
+               return self.refuse(INVALID_ARGUMENT,"passed null to setBuildTarget() location with non-null and non-capsule build target");
      }
+     else
+     {
+          if(status == NOTHING || int(status) == CAPSULE)
+               return self.refuse(INVALID_ARGUMENT,"attempted to target capsule or null building on non-null adjacent cell",*location);
 
-     //If location NOT null, must not be building capsule
-     if(status == NOTHING || status == CAPSULE)
-          throw RoboSimExecutionException("attempted to target capsule or null building on non-null adjacent cell",actingRobot.player,*actingRobot.assoc_cell,*location);
+          if(!self.isAdjacent(*location))
+               return self.refuseAt(OUT_OF_RANGE,"attempted to set build target to nonadjacent cell",cell);
+     }
 
-     //Cell must be adjacent
-     if(!isAdjacent(*location))
-          throw RoboSimExecutionException("attempted to set build target to nonadjacent cell",actingRobot.player,*actingRobot.assoc_cell,*gridCell);
+     //Whether the cell is free to build on depends on the other robots
+     RobotData& projected = turn.projected;
+     projected.whatBuilding = status;
+     projected.investedPower = 0;
+     projected.invested_assoc_cell = cell;
+     return record(Intent::SET_BUILD_TARGET,0,cell,status,keepMessage(message));
+}
 
-     //Is the cell empty?
-     if(gridCell->contents!=EMPTY)
-          throw RoboSimExecutionException("attempted to set build target to nonempty cell",actingRobot.player,*actingRobot.assoc_cell,*gridCell);
+ActionResult RoboSim::IntentRecorder::try_charge(int power, GridCell& ally)
+{
+     if(power > turn.projected.status.power || power < 1)
+          return self.refuse(INVALID_POWER,"attempted charge with illegal power level");
+
+     if(!self.isAdjacent(ally))
+          return self.refuse(OUT_OF_RANGE,"attempted to charge nonadjacent cell");
+
+     const int cell = indexOf(ally);
+     if(cell==-1)
+          return self.refuse(INVALID_CELL,"passed invalid cell coordinates to charge()",ally);
 
-     //Okay, block off cell since we're building there now.
-     gridCell->contents = BLOCKED;
+     //The ally may have moved away by the time this is carried out
+     spend(power);
+     return record(Intent::CHARGE,power,cell);
 }
@@ -2,6 +2,15 @@
 
 #include "robot_api.hpp"
 #include "Robot.hpp"
+#include "WorldGrid.hpp"
+#include "GridView.hpp"
+#include "WorldSnapshot.hpp"
+#include "Random.hpp"
+#include "Scenario.hpp"
+#include "TeamIndex.hpp"
+#include "RadioPool.hpp"
+#include "ThreadPool.hpp"
+#include "WorldPublisher.hpp"
 
 using namespace robot_api;
 
@@ -11,8 +20,14 @@ using namespace robot_api;
 
 #include <cmath>
 #include <cstdlib>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <ostream>
 #include <vector>
 #include <list>
+#include <memory>
+#include <mutex>
 
 using std::abs;
 using std::min;
@@ -21,6 +36,26 @@ using std::vector;
 class RoboSim
 {
 public:
+     /**Creates a new robot for the given player (numbered from 1).  The
+      * simulator takes ownership of the robot.*/
+     typedef std::function<Robot*(int player)> RobotFactory;
+
+     /**Supplies a forked simulator with a new robot to stand in for one
+      * of the original's robots.  The fork takes ownership of it.*/
+     typedef std::function<Robot*(Robot* original, int player)> RobotClonePolicy;
+
+     /**Returned by executeSingleTimeStep() when no robot is left, which can
+      * happen in simultaneous mode: the last robots of every team can
+      * destroy each other in the same time step.  A draw.*/
+     static const int NO_SURVIVORS = 0;
+
+     /**Effectiveness of the simulator's path query cache*/
+     struct PathCacheStats
+     {
+          unsigned long long hits;
+          unsigned long long misses;
+     };
+
      
      /**FSPPredicate derivative making use of SimGridCell-specific information*/
      class SimGridAllyDeterminant
@@ -40,13 +75,321 @@ private:
      static const int WALL_DEFENSE = 10;
 
      //RoboSim execution data (world grid, turn order, GUI reference, etc.)
-     vector<vector<GridCell> > worldGrid;
-     vector<RobotData> turnOrder;
+     WorldGrid worldGrid;
+     RobotTable turnOrder;
      int turnOrder_pos;
 
+     //Where robots come from, and how many teams there are
+     int num_players;
+     RobotFactory robot_factory;
+
+     //Each simulator has its own random numbers, so simulators can run
+     //side by side on different threads.  Placement and combat draw from
+     //separate streams split off the same seed.
+     std::uint64_t seed;
+     Xoshiro256 placement_rng;
+     Xoshiro256 combat_rng;
+
+     //Unpacked copy of worldGrid handed out by getWorldGrid()
+     vector<vector<GridCell> > worldGridAdapter;
+
+     //ALT landmarks for the simulator's own path searches (see setPathLandmarks())
+     int landmark_count;
+     mutable std::shared_ptr<const LandmarkTable> landmarks;
+     mutable unsigned landmarks_version;
+
+     /**
+      * Cache of the simulator's own path queries (clear-shot and range
+      * checks).  Entries are tagged with the world version
+      * they were computed in, so any change to the world invalidates all of
+      * them without anything having to be cleared.  Direct-mapped and of
+      * fixed size, so it never allocates after construction.
+      */
+     class PathQueryCache
+     {
+     private:
+          static const int SLOT_BITS = 12;
+
+          struct Slot
+          {
+               unsigned long long key;
+               unsigned long long version;
+               int result;
+          };
+
+          vector<Slot> slots;
+
+          Slot& slotFor(unsigned long long key)
+               {
+                    return slots[(key*0x9E3779B97F4A7C15ULL) >> (64-SLOT_BITS)];
+               }
+
+     public:
+          PathCacheStats stats;
+
+          PathQueryCache() : slots(1<<SLOT_BITS)
+               {
+                    for(Slot& x : slots)
+                         x.version = 0;
+                    stats.hits = stats.misses = 0;
+               }
+
+          /**@return key for a query from origin to target*/
+          static unsigned long long key(int origin, int target)
+               {
+                    return (static_cast<unsigned long long>(static_cast<unsigned>(origin)) << 32) | static_cast<unsigned>(target);
+               }
+
+          /**
+           * @param result filled in with the cached answer, if there is one
+           * @return whether the answer was cached for this world version
+           */
+          bool lookup(unsigned long long key, unsigned long long version, int& result)
+               {
+                    Slot& slot = slotFor(key);
+                    if(slot.version==version && slot.key==key)
+                    {
+                         stats.hits++;
+                         result = slot.result;
+                         return true;
+                    }
+                    stats.misses++;
+                    return false;
+               }
+
+          void store(unsigned long long key, unsigned long long version, int result)
+               {
+                    Slot& slot = slotFor(key);
+                    slot.key = key;
+                    slot.version = version;
+                    slot.result = result;
+               }
+     };
+
+     mutable PathQueryCache pathCache;
+
+     //Where each team's robots are, for findNearestAlly().  Built on first
+     //use, then kept up to date as robots move, are built and are destroyed.
+     mutable TeamIndex allies;
+
+     //Shared sanitized copies of the world, indexed by player (see getWorldSnapshot())
+     struct SnapshotEntry
+     {
+          std::shared_ptr<vector<GridCell> > cells;
+          unsigned long long version;
+     };
+     mutable vector<SnapshotEntry> snapshots;
+
+     //Robots deciding a simultaneous time step share the snapshots
+     mutable std::mutex snapshot_lock;
+
+     //Tells this simulator's world apart from others published into the
+     //same SharedWorld
+     unsigned long long world_id;
+
+     //Radio messages in flight
+     RadioPool radio;
+
+     /**Copies a robot's inbox into the form Robot::act() takes.  The copy
+      * is fresh, to be moved into act(), so each message is copied once.*/
+     vector<vector<uint8_t> > deliverRadio(const RobotData& robot) const
+          {
+               vector<vector<uint8_t> > inbox;
+               inbox.reserve(robot.buffered_radio.size());
+               for(int message : robot.buffered_radio)
+               {
+                    const uint8_t* bytes = radio[message].bytes;
+                    inbox.emplace_back(bytes,bytes+RadioMessage::SIZE);
+               }
+               return inbox;
+          }
+
+     /**An action a robot took during a simultaneous time step, carried
+      * out once every robot has decided (see setSimultaneousMoves())*/
+     struct Intent
+     {
+          enum Kind { MOVE, DEFEND, REPAIR, MELEE_ATTACK, RANGED_ATTACK, CAPSULE_ATTACK, PICK_UP_CAPSULE,
+                      DROP_CAPSULE, SET_BUILD_TARGET, BUILD, CHARGE, SEND_MESSAGE, SCAN_ENEMY };
+
+          Kind kind;
+
+          //Power spent (steps for MOVE, capsule power for CAPSULE_ATTACK
+          //and DROP_CAPSULE)
+          int power;
+
+          //Index of cell acted on (destination for MOVE), or -1 for none
+          int cell;
+
+          //Direction of MOVE, or what SET_BUILD_TARGET builds
+          int detail;
+
+          //Position in TurnIntents::messages of the message sent or the
+          //creation message, or -1 for none
+          int message;
+
+          //Set when another robot contested the cell
+          bool cancelled;
+
+          /**@return phase of resolution the intent is carried out in: 0
+           * for moves, 1 for defense and repairs, 2 for attacks, 3 for
+           * everything else*/
+          int phase() const
+               {
+                    switch(kind)
+                    {
+                    case MOVE:
+                         return 0;
+                    case DEFEND:
+                    case REPAIR:
+                         return 1;
+                    case MELEE_ATTACK:
+                    case RANGED_ATTACK:
+                    case CAPSULE_ATTACK:
+                         return 2;
+                    default:
+                         return 3;
+                    }
+               }
+     };
+
+     /**What one robot decided during a simultaneous time step.  Kept from
+      * turn to turn so its storage is reused.*/
+     struct TurnIntents
+     {
+          //Robot deciding (NULL if it was destroyed before the time step)
+          RobotData* robot;
+
+          //Status handed to act()
+          Robot_Status status;
+
+          //Robot's own state as its intents so far leave it, including
+          //where its moves take it
+          RobotData projected;
+
+          vector<Intent> actions;
+          vector<vector<uint8_t> > messages;
+          int messages_used;
+
+          //Next action to look at when resolving moves
+          int next_move;
+
+          //Exception robot code let escape from act(), if any
+          std::exception_ptr failure;
+
+          /**Readies the intents for a new time step*/
+          void begin(RobotData* robot_)
+               {
+                    robot = robot_;
+                    actions.clear();
+                    messages_used = 0;
+                    next_move = 0;
+                    failure = nullptr;
+                    if(robot==NULL)
+                         return;
+
+                    status = robot->status;
+                    projected.specs = robot->specs;
+                    projected.status = robot->status;
+                    projected.player = robot->player;
+                    projected.assoc_cell = robot->assoc_cell;
+                    projected.whatBuilding = robot->whatBuilding;
+                    projected.investedPower = robot->investedPower;
+                    projected.invested_assoc_cell = robot->invested_assoc_cell;
+               }
+     };
+
+     //Simultaneous-move mode (see setSimultaneousMoves()): whether it's on,
+     //the threads robots decide on (none to decide on the calling thread),
+     //and what each robot decided, by place in the turn order
+     bool simultaneous;
+     std::unique_ptr<ThreadPool> intent_pool;
+     vector<TurnIntents> turn_intents;
+
+     //A cell an intent lays claim to, for finding contested cells
+     struct Claim
+     {
+          int kind;
+          int cell;
+          int pos;
+          int action;
+
+          bool operator<(const Claim& other) const
+               {
+                    if(kind!=other.kind)
+                         return kind < other.kind;
+                    if(cell!=other.cell)
+                         return cell < other.cell;
+                    return pos < other.pos;
+               }
+     };
+     vector<Claim> claims;
+
+     /**Hands a robot to its data, noting which interface it implements,
+      * and which of player_config.hpp's types it is, if any*/
+     static void attachRobot(RobotData& data, Robot* robot);
+
+     /**Calls act() on a robot of a type known at compile time*/
+     struct ActCall;
+
+     /**Runs a robot's turn: calls act() through whichever interface it
+      * implements, directly if it's of one of player_config.hpp's types
+      * @param status robot's status at the start of the turn (copied
+      *               before act() sees it)*/
+     void actRobot(RobotData& data, WorldAPI& api, const Robot_Status& status);
+
+     /**Calls createRobot() through whichever interface the robot implements*/
+     static Robot_Specs createRobot(RobotData& data, int skill_points, const vector<uint8_t>& message)
+          {
+               if(data.robot_v2)
+                    return data.robot_v2->createRobot(NULL,skill_points,MessageView(message));
+               return data.robot->createRobot(NULL,skill_points,message);
+          }
+
+     /**Readies a robot's status for its turn*/
+     static void startTurn(RobotData& data)
+          {
+               //Charge robot an amount of charge equal to charge skill
+               data.status.charge = min(data.status.charge + data.specs.charge, data.specs.charge*10);
+
+               /*We can spend up to status.power power this turn, but
+                *no more than our current charge level*/
+               data.status.power = min(data.specs.power, data.status.charge);
+
+               //Defense boost reset to zero at beginning of turn
+               data.status.defense_boost = 0;
+          }
+
 public:
-     /**This is so SimulatorGUI can get a copy of world*/
-     vector<vector<GridCell> >& getWorldGrid() { return worldGrid; }
+     /**This is so SimulatorGUI can get a copy of world.
+      * The returned grid is an unpacked copy refreshed on each call;
+      * changes made to it are not reflected in the simulation.*/
+     vector<vector<GridCell> >& getWorldGrid()
+          {
+               worldGrid.exportCells(worldGridAdapter);
+               return worldGridAdapter;
+          }
+
+     /**Packed world grid, for code that doesn't need GridCell objects*/
+     const WorldGrid& getPackedWorldGrid() const { return worldGrid; }
+
+     /**@return hit and miss counts of the cache in front of the
+      * simulator's own path searches*/
+     PathCacheStats getPathCacheStats() const { return pathCache.stats; }
+
+     /**@return seed the simulator was created with*/
+     std::uint64_t getSeed() const { return seed; }
+
+     /**Enables ALT landmark heuristics for the simulator's own path
+      * searches (clear-shot and range checks), which pays off on large
+      * maps.  The table takes 4*count bytes per cell; it is built on first
+      * use and rebuilt lazily after walls or forts are built or destroyed.
+      * @param count number of landmarks to use (0, the default, disables)
+      */
+     void setPathLandmarks(int count)
+          {
+               landmark_count = count;
+               landmarks.reset();
+          }
 
      /**SimulatorGUI needs to see who owns the robots in the cells
       * This is a hack to allow this by downcasting the passed GridCell
@@ -56,19 +399,92 @@ public:
                return cell.occupant_data->player;
           }
 
+     /**@return player of the robot in the packed grid's cell idx (which
+      *         must hold one)*/
+     int getOccupantPlayer(int idx) const
+          {
+               return worldGrid.occupant(idx)->player;
+          }
+
 private:
-     /**Helper method to retrieve a sanitized subgrid of the world grid
+     /**Helper method to retrieve a sanitized view of part of the world grid
       * @param x_left left x coordinate (inclusive)
       * @param y_up smaller y coordinate (inclusive)
       * @param x_right right x coordinate (inclusive)
       * @param y_down larger y coordinate (inclusive)
+      * @param self robot to show as SELF
+      * @return view of the world grid (NOT copied; sanitized on access)
+      */
+     GridView getSanitizedView(int x_left, int y_up, int x_right, int y_down, const RobotData& self) const
+          {
+               return GridView(worldGrid,&self,self.player,x_left,y_up,x_right-x_left+1,y_down-y_up+1);
+          }
+
+     /**@return view of what a robot can see around itself (defense
+      *         cells in each direction)*/
+     GridView getVisibleNeighborhood(const RobotData& self) const
+          {
+               const int range = self.specs.defense;
+               const int xloc = worldGrid.xOf(self.assoc_cell);
+               const int yloc = worldGrid.yOf(self.assoc_cell);
+               const int x_left = (xloc - range < 0) ? 0 : (xloc - range);
+               const int x_right = (xloc + range > worldGrid.length()-1) ? (worldGrid.length()-1) : (xloc + range);
+               const int y_up = (yloc - range < 0) ? 0 : (yloc - range);
+               const int y_down = (yloc + range > worldGrid.width() - 1) ? (worldGrid.width()-1) : (yloc + range);
+               return getSanitizedView(x_left,y_up,x_right,y_down,self);
+          }
+
+     /**Helper method to retrieve a single sanitized cell of the world grid
+      * @param idx index of cell in world grid
       * @param player player number
-      * @return subgrid of the world grid (NOT copied or sanitized)
+      * @return sanitized copy of cell
+      */
+     GridCell getSanitizedCell(int idx, int player) const;
+
+     /**Helper method to retrieve a sanitized copy of the whole world,
+      * shared with every other robot of the same player until the world
+      * changes
+      * @param self robot to show as SELF
+      * @return snapshot of the world
+      */
+     WorldSnapshot getWorldSnapshot(const RobotData& self) const;
+
+     /**Brings a shared copy of the world up to date with the world as a
+      * robot sees it, rewriting only chunks that changed since it was
+      * last brought up to date from this simulator for the same player
+      * @param shared copy to update
+      * @param self robot to show as SELF
       */
-     vector<vector<GridCell> > getSanitizedSubGrid(int x_left, int y_up, int x_right, int y_down, int player) const;
+     void publishWorld(SharedWorld& shared, const RobotData& self) const;
+
+     /**Length of the shortest path between two cells through empty cells,
+      * found with A*
+      * @param origin index of starting cell
+      * @param target index of ending cell
+      * @return number of steps in path, or 0 if there is no path
+      */
+     int shortestPathLength(int origin, int target) const;
+
+     /**Finds the nearest ally of the robot in a cell, as the crow flies
+      * @param origin index of cell containing robot
+      * @return index of cell containing nearest ally, or -1 if none
+      */
+     int findNearestAlly(int origin) const;
+
+     static bool specsValid(const Robot_Specs& proposed, int skill_points)
+          {
+               return proposed.attack + proposed.defense + proposed.power + proposed.charge == skill_points;
+          }
 
      static Robot_Specs checkSpecsValid(Robot_Specs proposed, int player, int skill_points);
 
+     /**Puts a newly created robot of player into the cell with index idx
+      * (which must be empty or a fort) and asks it for its specs*/
+     void spawnRobot(RobotData& data, int player, int idx, int skill_points);
+
+     //Used by fork()
+     RoboSim(const RoboSim& original, const RobotClonePolicy& policy);
+
 public:
      /**
       * Constructor for RoboSim:
@@ -78,8 +494,133 @@ public:
       * @param length length of arena
       * @param width width of arena
       * @param obstacles number of obstacles on battlefield
+      * @param seed seed for the simulator's random numbers; the same seed
+      *             always plays out the same match
+      */
+     RoboSim(int initial_robots_per_combatant, int skill_points, int length, int width, int obstacles, std::uint64_t seed = 1);
+
+     /**
+      * Constructor for RoboSim with an explicit roster:
+      * @param initial_robots_per_combatant how many robots each team starts
+      *                                     out with
+      * @param skill_points skill points per combatant
+      * @param length length of arena
+      * @param width width of arena
+      * @param obstacles number of obstacles on battlefield
+      * @param players number of teams
+      * @param factory creates the robots of each team
+      * @param seed seed for the simulator's random numbers
+      */
+     RoboSim(int initial_robots_per_combatant, int skill_points, int length, int width, int obstacles, int players, RobotFactory factory, std::uint64_t seed);
+
+     /**
+      * Constructor for RoboSim starting from a given position:
+      * @param scenario terrain and starting cells of each team's robots
+      * @param skill_points skill points per combatant
+      * @param factory creates the robots of each team
+      * @param seed seed for the simulator's random numbers
+      */
+     RoboSim(const Scenario& scenario, int skill_points, RobotFactory factory, std::uint64_t seed);
+
+     //The simulator owns its robots, so it can't be copied
+     RoboSim(const RoboSim&) = delete;
+     RoboSim& operator=(const RoboSim&) = delete;
+
+     ~RoboSim();
+
+     /**
+      * Restores a simulator from a checkpoint:
+      * @param checkpoint stream positioned at a checkpoint written by
+      *                   saveCheckpoint()
+      * @param factory creates the robots of each team; each robot is then
+      *                given the state it saved, if any
+      */
+     RoboSim(std::istream& checkpoint, RobotFactory factory);
+
+     /**Restores a simulator from a checkpoint, using the robots in
+      * player_config.hpp*/
+     explicit RoboSim(std::istream& checkpoint);
+
+     /**
+      * Writes the complete state of the simulation (world, robots, radio
+      * in flight, random number generators, and whatever state robots
+      * choose to save) as a binary checkpoint.  Should be called between
+      * time steps.  The checkpoint is native-endian.
+      * @param out stream to write to
+      */
+     void saveCheckpoint(std::ostream& out) const;
+
+     /**
+      * Creates an independent copy of the simulation, for lookahead.  The
+      * world is shared copy-on-write, so forking costs little more than
+      * the robot table; each simulator then pays for what it changes.
+      * Forks continue from the same random state, so a fork whose robots
+      * decide the same things plays out the same.  Should be called
+      * between time steps.
+      * @param policy supplies the fork's robots
+      */
+     std::unique_ptr<RoboSim> fork(const RobotClonePolicy& policy) const;
+
+     /**Forks with copyRobotState(), using this simulator's factory*/
+     std::unique_ptr<RoboSim> fork() const;
+
+     /**@return clone policy making new robots with factory and handing them
+      * the originals' state through Robot::saveState()/loadState()*/
+     static RobotClonePolicy copyRobotState(RobotFactory factory);
+
+     /**@return clone policy replacing each robot with a new one from
+      * factory (e.g. to see what would happen if a simpler bot took
+      * over)*/
+     static RobotClonePolicy substituteRobots(RobotFactory factory);
+
+     /**
+      * Switches between sequential time steps (the default), in which
+      * robots act one after another and each sees what the ones before it
+      * did, and simultaneous ones.  In a simultaneous time step every
+      * robot decides at once, in parallel, against the world as it was
+      * when the time step began.  Nothing a robot does changes the world
+      * straight away: its actions are checked as far as they depend on
+      * the robot alone (power, skills, capsules held, where its own moves
+      * take it) and recorded as intents, and refused actions are reported
+      * to it as usual.  Once every robot has decided, the intents are
+      * carried out, each checked against the world as it is by then, in
+      * this order:
+      * <ol>
+      * <li>Contested cells: if intents of two or more robots move into the
+      *     same cell, build on it, pick up its capsule or drop a capsule
+      *     into it, none of those intents is carried out (and a robot that
+      *     loses a move stays where it is for the rest of the time step).
+      * <li>Moves.  A robot whose way is blocked by one that hasn't moved
+      *     yet waits for it, so robots can follow each other whatever their
+      *     order; robots trying to swap places stay put.
+      * <li>Defense and repairs, so they count against every attack.
+      * <li>Attacks, in turn order.  Attacks are aimed at cells, so a robot
+      *     that moved out of the cell escapes the attack (which then costs
+      *     nothing) and one that moved in takes it.  Robots destroyed in
+      *     this phase still make their own attacks.
+      * <li>Everything else, in turn order and in the order each robot
+      *     took its actions, for robots that survived: capsules, building,
+      *     charging, radio and scans.
+      * </ol>
+      * Intents refused when they're carried out are dropped silently.
+      * Attacks are reported to the robot making them as misses, since the
+      * outcome isn't known until later; scans report what was in the cell
+      * when the time step began.  Robots built during the time step, and
+      * radio messages sent, first act and arrive in the next one.  Results
+      * don't depend on the number of threads.  If robot code throws, the
+      * time step ends with the first exception in turn order and no
+      * intents are carried out.<br>
+      * Forks play simultaneous time steps on the calling thread, as they
+      * are usually played by robot code already running on a worker.  The
+      * mode isn't saved in checkpoints.
+      * @param enabled whether time steps are simultaneous
+      * @param threads threads robots decide on (0 for one per core, 1 to
+      *                decide on the calling thread)
       */
-     RoboSim(int initial_robots_per_combatant, int skill_points, int length, int width, int obstacles);
+     void setSimultaneousMoves(bool enabled, int threads = 0);
+
+     /**@return whether time steps are simultaneous*/
+     bool isSimultaneous() const { return simultaneous; }
 
      /**
       * The implementing class for the WorldAPI reference.
@@ -90,12 +631,20 @@ public:
       * code anyway, but still).
       */
 private:
-     class RoboAPIImplementor : public WorldAPI
+     class IntentRecorder;
+
+     class RoboAPIImplementor : public WorldAPI, public WorldPublisher
      {
      private:
+          //Shares the error checking
+          friend class IntentRecorder;
+
           RoboSim& rsim;
           RobotData& actingRobot;
 
+          //Storage for the cell returned by getBuildTarget()
+          GridCell build_target;
+
      public:
           /**
            * Constructor
@@ -111,12 +660,39 @@ private:
      private:
           bool isAdjacent(GridCell adjacent_cell)
                {
-                    return (abs(actingRobot.assoc_cell->x_coord-adjacent_cell.x_coord)==1 &&
-                              actingRobot.assoc_cell->y_coord == adjacent_cell.y_coord ||
-                            abs(actingRobot.assoc_cell->y_coord-adjacent_cell.y_coord)==1 &&
-                              actingRobot.assoc_cell->x_coord == adjacent_cell.x_coord);
+                    const int x_coord = rsim.worldGrid.xOf(actingRobot.assoc_cell);
+                    const int y_coord = rsim.worldGrid.yOf(actingRobot.assoc_cell);
+                    return (abs(x_coord-adjacent_cell.x_coord)==1 &&
+                              y_coord == adjacent_cell.y_coord ||
+                            abs(y_coord-adjacent_cell.y_coord)==1 &&
+                              x_coord == adjacent_cell.x_coord);
+               }
+
+          /**@return copy of the cell the acting robot is in, for error messages*/
+          GridCell actorCell() const
+               {
+                    return rsim.worldGrid.cell(actingRobot.assoc_cell);
+               }
+
+          /**@return refusal of the acting robot's action*/
+          ActionResult refuse(ActionStatus status, const char* reason) const
+               {
+                    return ActionResult(status,reason,actingRobot.player,rsim.worldGrid.xOf(actingRobot.assoc_cell),rsim.worldGrid.yOf(actingRobot.assoc_cell));
+               }
+
+          /**@return refusal of the acting robot's action on the cell at
+           *         [x][y]*/
+          ActionResult refuse(ActionStatus status, const char* reason, int x, int y) const
+               {
+                    return ActionResult(status,reason,actingRobot.player,rsim.worldGrid.xOf(actingRobot.assoc_cell),rsim.worldGrid.yOf(actingRobot.assoc_cell),x,y);
                }
 
+          ActionResult refuse(ActionStatus status, const char* reason, const GridCell& cell) const { return refuse(status,reason,cell.x_coord,cell.y_coord); }
+
+          /**@return refusal of the acting robot's action on the cell with
+           *         index idx*/
+          ActionResult refuseAt(ActionStatus status, const char* reason, int idx) const { return refuse(status,reason,rsim.worldGrid.xOf(idx),rsim.worldGrid.yOf(idx)); }
+
           /**
            * Did the attacker hit the defender?
            * @param attack attack skill of attacker (including bonuses/penalties)
@@ -125,37 +701,38 @@ private:
            */
           bool calculateHit(int attack, int defense)
                {
-                    int luckOfAttacker = rand()%10;
+                    int luckOfAttacker = rsim.combat_rng.below(10);
                     return luckOfAttacker+attack-defense>=5;
                }
 
           /**
            * Process attack, assigning damage and deleting destroyed objects if necessary.
            * @param attack attack skill of attacker (including bonuses/penalties)
-           * @param cell_to_attack cell attacker is attacking containing enemy or obstacle
+           * @param cell_to_attack index of cell attacker is attacking containing enemy or obstacle
            * @param damage damage if attack hits
            */
-          AttackResult processAttack(int attack, GridCell& cell_to_attack, int power);
+          AttackResult processAttack(int attack, int cell_to_attack, int power);
 
      public:
-          AttackResult meleeAttack(int power, GridCell& adjacent_cell);
-          AttackResult rangedAttack(int power, GridCell& nonadjacent_cell);
-          AttackResult capsuleAttack(int power_of_capsule, GridCell& cell);
+          ActionResult try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result);
+          ActionResult try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result);
+          ActionResult try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result);
           
-          void defend(int power)
+          ActionResult try_defend(int power)
                {
                     //Error checking
                     if(power < 0 || power > actingRobot.specs.defense || power > actingRobot.specs.power || power > actingRobot.status.charge)
-                         throw RoboSimExecutionException("attempted to defend with negative power",actingRobot.player, *actingRobot.assoc_cell);
+                         return refuse(INVALID_POWER,"attempted to defend with negative power");
 
                     //This one's easy
                     actingRobot.status.charge-=power;
                     actingRobot.status.defense_boost+=power;
+                    return ActionResult();
                }
 
-          void move(int steps, Direction way);
-          void pick_up_capsule(GridCell& adjacent_cell);
-          void drop_capsule(GridCell& adjacent_cell, int power_of_capsule);
+          ActionResult try_move(int steps, Direction way);
+          ActionResult try_pick_up_capsule(GridCell& adjacent_cell);
+          ActionResult try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule);
 
           BuildStatus getBuildStatus()
                {
@@ -164,7 +741,10 @@ private:
 
           GridCell* getBuildTarget()
                {
-                    return actingRobot.invested_assoc_cell;
+                    if(actingRobot.invested_assoc_cell==-1)
+                         return NULL;
+                    build_target = rsim.getSanitizedCell(actingRobot.invested_assoc_cell,actingRobot.player);
+                    return &build_target;
                }
 
           int getInvestedBuildPower()
@@ -174,30 +754,34 @@ private:
 
      private:
 
-          void finalizeBuilding(vector<uint8_t> creation_message);
+          ActionResult finalizeBuilding(vector<uint8_t> creation_message);
+
+          /**Gives up on the build under way, freeing its cell*/
+          void abandonBuild();
 
      public:
 
-          void setBuildTarget(BuildStatus status, GridCell* location)
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location)
                {
-                    setBuildTarget(status,location,vector<uint8_t>());
+                    return try_setBuildTarget(status,location,vector<uint8_t>());
                }
 
-          void setBuildTarget(BuildStatus status, GridCell* location, vector<uint8_t> message);
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message);
 
-          void build(int power)
+          ActionResult try_build(int power)
                {
                     if(power > actingRobot.status.power || power < 0)
-                         throw RoboSimExecutionException("attempted to apply invalid power to build task",actingRobot.player,*actingRobot.assoc_cell);
+                         return refuse(INVALID_POWER,"attempted to apply invalid power to build task");
                     actingRobot.status.charge-=power;
                     actingRobot.status.power-=power;
                     actingRobot.investedPower+=power;
+                    return ActionResult();
                }
 
-          void repair(int power)
+          ActionResult try_repair(int power)
                {
                     if(power > actingRobot.status.power || power < 0)
-                         throw RoboSimExecutionException("attempted to apply invalid power to repair task",actingRobot.player,*actingRobot.assoc_cell);
+                         return refuse(INVALID_POWER,"attempted to apply invalid power to repair task");
                     actingRobot.status.charge-=power;
                     actingRobot.status.power-=power;
                     actingRobot.status.health+=power/2;
@@ -205,159 +789,324 @@ private:
                     //Can't have more health than charge skill*10
                     if(actingRobot.status.health > actingRobot.specs.charge*10)
                          actingRobot.status.health = actingRobot.specs.charge*10;
+                    return ActionResult();
                }
 
-          void charge(int power, GridCell& ally)
+          ActionResult try_charge(int power, GridCell& ally)
                {
                     //Check that we're using a valid amount of power
                     if(power > actingRobot.status.power || power < 1)
-                         throw RoboSimExecutionException("attempted charge with illegal power level",actingRobot.player,*actingRobot.assoc_cell);
+                         return refuse(INVALID_POWER,"attempted charge with illegal power level");
 
                     //Are cells adjacent?
                     if(!isAdjacent(ally))
-                         throw RoboSimExecutionException("attempted to charge nonadjacent cell",actingRobot.player,*actingRobot.assoc_cell);
+                         return refuse(OUT_OF_RANGE,"attempted to charge nonadjacent cell");
 
                     //Does cell exist in grid?
                     //(could put this in isAdjacent() method but want to give students more useful error messages)
-                    if(ally.x_coord > rsim.worldGrid.size() || ally.y_coord > rsim.worldGrid[0].size() || ally.x_coord < 0 || ally.y_coord < 0)
-                         throw RoboSimExecutionException("passed invalid cell coordinates to charge()",actingRobot.player,*actingRobot.assoc_cell,ally);
+                    if(!rsim.worldGrid.inBounds(ally.x_coord,ally.y_coord))
+                         return refuse(INVALID_CELL,"passed invalid cell coordinates to charge()",ally);
 
                     //Safe to use this now, checked for oob condition from student
-                    GridCell& allied_cell = rsim.worldGrid[ally.x_coord][ally.y_coord];
+                    const int allied_cell = rsim.worldGrid.index(ally.x_coord,ally.y_coord);
 
                     //Is there an ally in that cell?
-                    if(allied_cell.contents!=SELF || allied_cell.occupant_data->player!=actingRobot.player)
-                         throw RoboSimExecutionException("attempted to charge non-ally, or cell with no robot in it",actingRobot.player,*actingRobot.assoc_cell,allied_cell);
+                    if(rsim.worldGrid.contents(allied_cell)!=SELF || rsim.worldGrid.occupant(allied_cell)->player!=actingRobot.player)
+                         return refuseAt(INVALID_TARGET,"attempted to charge non-ally, or cell with no robot in it",allied_cell);
 
                     //Perform the charge
                     actingRobot.status.power-=power;
                     actingRobot.status.charge-=power;
-                    allied_cell.occupant_data->status.charge+=power;
+                    rsim.worldGrid.occupant(allied_cell)->status.charge+=power;
+                    return ActionResult();
                }
 
-          void sendMessage(vector<uint8_t> message, int power)
+          ActionResult try_sendMessage(const vector<uint8_t>& message, int power)
                {
                     if(power < 1 || power > 2)
-                         throw RoboSimExecutionException("attempted to send message with invalid power", actingRobot.player,*actingRobot.assoc_cell);
+                         return refuse(INVALID_POWER,"attempted to send message with invalid power");
 
-                    if(message.size()!=64)
-                         throw RoboSimExecutionException("attempted to send message byte array of incorrect length", actingRobot.player,*actingRobot.assoc_cell);
+                    if(message.size()!=RadioMessage::SIZE)
+                         return refuse(INVALID_ARGUMENT,"attempted to send message byte array of incorrect length");
 
-                    GridCell* target = NULL;
                     if(power==1)
                     {
-                         target = RobotUtility::findNearestAlly(*actingRobot.assoc_cell,rsim.worldGrid);
-                         if(target!=NULL)
+                         const int target = rsim.findNearestAlly(actingRobot.assoc_cell);
+                         if(target!=-1)
                          {
                               /*There's a way to "cheat" here and set up a power-free comm channel
                                *between two allied robots.  If you can find it ... let me know, and
                                *you'll get extra credit :).  Additional credit for a bugfix.*/
-                              target->occupant_data->buffered_radio.push_back(message);
+                              rsim.worldGrid.occupant(target)->buffered_radio.push_back(rsim.radio.store(message.data(),1));
                          }
-                         return;
+                         return ActionResult();
                     }
                     else //power==2
+                    {
+                         //Every ally's inbox shares one copy of the message
+                         int recipients = 0;
+                         for(const RobotData& x : rsim.turnOrder)
+                              if(&x!=&actingRobot && x.player==actingRobot.player)
+                                   recipients++;
+                         if(recipients==0)
+                              return ActionResult();
+
+                         const int stored = rsim.radio.store(message.data(),recipients);
                          for(RobotData& x : rsim.turnOrder)
                               if(&x!=&actingRobot && x.player==actingRobot.player)
-                                   x.buffered_radio.push_back(message);
+                                   x.buffered_radio.push_back(stored);
+                         return ActionResult();
+                    }
                }
 
           //It's a wonderful day in the neighborhood...
           vector<vector<GridCell> > getVisibleNeighborhood()
                {
-                    //YAY!  No parameters means NO ERROR CHECKING!  YAY!
-                    const int range = actingRobot.specs.defense;
-                    const int xloc = actingRobot.assoc_cell->x_coord;
-                    const int yloc = actingRobot.assoc_cell->y_coord;
-                    const int x_left = (xloc - range < 0) ? 0 : (xloc - range);
-                    const int x_right = (xloc + range > rsim.worldGrid.size()-1) ? (rsim.worldGrid.size()-1) : (xloc + range);
-                    const int y_up = (yloc - range < 0) ? 0 : (yloc - range);
-                    const int y_down = (yloc + range > rsim.worldGrid[0].size() - 1) ? (rsim.worldGrid[0].size()-1) : (yloc + range);
-                    vector<vector<GridCell> > to_return = rsim.getSanitizedSubGrid(x_left,y_up,x_right,y_down,actingRobot.player);
-
-                    //Set associated cell to SELF instead of ALLY
-                    to_return[xloc - x_left][yloc - y_up].contents=SELF;
+                    vector<vector<GridCell> > to_return;
+                    getVisibleNeighborhoodView().copyTo(to_return);
                     return to_return;
                }
 
+          GridView getVisibleNeighborhoodView()
+               {
+                    //YAY!  No parameters means NO ERROR CHECKING!  YAY!
+                    return rsim.getVisibleNeighborhood(actingRobot);
+               }
+
           vector<vector<GridCell> > getWorld(int power)
+               {
+                    vector<vector<GridCell> > to_return;
+                    getWorldSnapshot(power).copyTo(to_return);
+                    return to_return;
+               }
+
+          WorldSnapshot getWorldSnapshot(int power)
                {
                     if(power!=3)
-                         throw RoboSimExecutionException("tried to get world with invalid power (not equal to 3)",actingRobot.player,*actingRobot.assoc_cell);
+                         throw RoboSimExecutionException("tried to get world with invalid power (not equal to 3)",actingRobot.player,actorCell());
 
-                    vector<vector<GridCell> > to_return = rsim.getSanitizedSubGrid(0,0,rsim.worldGrid.size()-1,rsim.worldGrid[0].size()-1,actingRobot.player);
+                    return rsim.getWorldSnapshot(actingRobot);
+               }
 
-                    //Set self to self instead of ally
-                    to_return[actingRobot.assoc_cell->x_coord][actingRobot.assoc_cell->y_coord].contents=SELF;
-                    return to_return;
+          GridView getWorldView(int power)
+               {
+                    if(power!=3)
+                         throw RoboSimExecutionException("tried to get world with invalid power (not equal to 3)",actingRobot.player,actorCell());
+
+                    return rsim.getSanitizedView(0,0,rsim.worldGrid.length()-1,rsim.worldGrid.width()-1,actingRobot);
                }
 
-          void scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)
+          void publishWorld(SharedWorld& shared) { rsim.publishWorld(shared,actingRobot); }
+
+          ActionResult try_scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)
                {
-                    if(toScan.x_coord < 0 || toScan.x_coord >= rsim.worldGrid.size() || toScan.y_coord < 0 || toScan.y_coord >= rsim.worldGrid[0].size() || actingRobot.status.power==0)
-                         throw RoboSimExecutionException("Invalid parameters passed to scanEnemy()",actingRobot.player,*actingRobot.assoc_cell);
+                    if(!rsim.worldGrid.inBounds(toScan.x_coord,toScan.y_coord))
+                         return refuse(INVALID_CELL,"Invalid parameters passed to scanEnemy()");
+                    if(actingRobot.status.power==0)
+                         return refuse(INVALID_POWER,"Invalid parameters passed to scanEnemy()");
 
-                    GridCell& cell = rsim.worldGrid[toScan.x_coord][toScan.y_coord];
+                    const int cell = rsim.worldGrid.index(toScan.x_coord,toScan.y_coord);
 
                     //Are we within range?
-                    if(abs(actingRobot.assoc_cell->x_coord - cell.x_coord) > actingRobot.specs.defense || abs(actingRobot.assoc_cell->y_coord - cell.y_coord) > actingRobot.specs.defense)
-                         throw RoboSimExecutionException("attempted to scan farther than range", actingRobot.player, *actingRobot.assoc_cell);
+                    if(abs(rsim.worldGrid.xOf(actingRobot.assoc_cell) - toScan.x_coord) > actingRobot.specs.defense || abs(rsim.worldGrid.yOf(actingRobot.assoc_cell) - toScan.y_coord) > actingRobot.specs.defense)
+                         return refuse(OUT_OF_RANGE,"attempted to scan farther than range");
 
                     //Is there a robot in this cell?
-                    if(cell.contents != SELF)
-                         throw RoboSimExecutionException("attempted to scan invalid cell (no robot in cell)", actingRobot.player, *actingRobot.assoc_cell, cell);
+                    if(rsim.worldGrid.contents(cell) != SELF)
+                         return refuseAt(INVALID_TARGET,"attempted to scan invalid cell (no robot in cell)",cell);
 
                     //Register cost
                     actingRobot.status.power--;
                     actingRobot.status.charge--;
 
                     //Okay, we're good.  Fill in the data.
-                    enemySpecs.attack = cell.occupant_data->specs.attack;
-                    enemySpecs.defense = cell.occupant_data->specs.defense;
-                    enemySpecs.power = cell.occupant_data->specs.power;
-                    enemySpecs.charge = cell.occupant_data->specs.charge;
-                    enemyStatus.power = cell.occupant_data->status.power;
-                    enemyStatus.charge = cell.occupant_data->status.charge;
-                    enemyStatus.health = cell.occupant_data->status.health;
-                    enemyStatus.defense_boost = cell.occupant_data->status.defense_boost;
-                    enemyStatus.capsules = cell.occupant_data->status.capsules;
+                    const RobotData& occupant = *rsim.worldGrid.occupant(cell);
+                    enemySpecs.attack = occupant.specs.attack;
+                    enemySpecs.defense = occupant.specs.defense;
+                    enemySpecs.power = occupant.specs.power;
+                    enemySpecs.charge = occupant.specs.charge;
+                    enemyStatus.power = occupant.status.power;
+                    enemyStatus.charge = occupant.status.charge;
+                    enemyStatus.health = occupant.status.health;
+                    enemyStatus.defense_boost = occupant.status.defense_boost;
+                    enemyStatus.capsules = occupant.status.capsules;
+                    return ActionResult();
+               }
+     };
+
+     /**
+      * The WorldAPI robots get during a simultaneous time step (see
+      * setSimultaneousMoves()).  Robots decide on several threads at once,
+      * so it never changes the simulator: it reads the world, and records
+      * the robot's actions in its TurnIntents after checking what can be
+      * checked without looking at other robots.
+      */
+     class IntentRecorder : public WorldAPI, public WorldPublisher
+     {
+     private:
+          RoboSim& rsim;
+          TurnIntents& turn;
+
+          //Answers questions about the world, for the robot where it
+          //stood when the time step began
+          RoboAPIImplementor world;
+
+          //Checks actions (and carries out those involving only the
+          //robot itself) against the robot's projected state
+          RoboAPIImplementor self;
+
+          /**Records an intent
+           * @return acceptance of the action*/
+          ActionResult record(Intent::Kind kind, int power, int cell, int detail = 0, int message = -1)
+               {
+                    const Intent intent = { kind, power, cell, detail, message, false };
+                    turn.actions.push_back(intent);
+                    return ActionResult();
+               }
+
+          /**@return position in turn.messages of a copy of message*/
+          int keepMessage(const vector<uint8_t>& message)
+               {
+                    if(turn.messages_used==int(turn.messages.size()))
+                         turn.messages.emplace_back();
+                    turn.messages[turn.messages_used].assign(message.begin(),message.end());
+                    return turn.messages_used++;
+               }
+
+          /**Spends power on an action*/
+          void spend(int power)
+               {
+                    turn.projected.status.power-=power;
+                    turn.projected.status.charge-=power;
+               }
+
+          /**@return index of cell, or -1 if it's out of bounds*/
+          int indexOf(const GridCell& cell) const
+               {
+                    return rsim.worldGrid.inBounds(cell.x_coord,cell.y_coord) ? rsim.worldGrid.index(cell.x_coord,cell.y_coord) : -1;
+               }
+
+     public:
+          IntentRecorder(RoboSim& rsim_, TurnIntents& turn_) : rsim(rsim_), turn(turn_), world(rsim_,*turn_.robot), self(rsim_,turn_.projected) { }
+
+          ActionResult try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result);
+          ActionResult try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result);
+          ActionResult try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result);
+
+          ActionResult try_defend(int power)
+               {
+                    const ActionResult checked = self.try_defend(power);
+                    return checked ? record(Intent::DEFEND,power,-1) : checked;
+               }
+
+          ActionResult try_move(int steps, Direction way);
+          ActionResult try_pick_up_capsule(GridCell& adjacent_cell);
+          ActionResult try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule);
+
+          BuildStatus getBuildStatus() { return self.getBuildStatus(); }
+          GridCell* getBuildTarget() { return self.getBuildTarget(); }
+          int getInvestedBuildPower() { return self.getInvestedBuildPower(); }
+
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location)
+               {
+                    return try_setBuildTarget(status,location,vector<uint8_t>());
+               }
+
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message);
+
+          ActionResult try_build(int power)
+               {
+                    const ActionResult checked = self.try_build(power);
+                    return checked ? record(Intent::BUILD,power,-1) : checked;
+               }
+
+          ActionResult try_repair(int power)
+               {
+                    const ActionResult checked = self.try_repair(power);
+                    return checked ? record(Intent::REPAIR,power,-1) : checked;
+               }
+
+          ActionResult try_charge(int power, GridCell& ally);
+
+          ActionResult try_sendMessage(const vector<uint8_t>& message, int power)
+               {
+                    if(power < 1 || power > 2)
+                         return self.refuse(INVALID_POWER,"attempted to send message with invalid power");
+
+                    if(message.size()!=RadioMessage::SIZE)
+                         return self.refuse(INVALID_ARGUMENT,"attempted to send message byte array of incorrect length");
+
+                    return record(Intent::SEND_MESSAGE,power,-1,0,keepMessage(message));
+               }
+
+          vector<vector<GridCell> > getVisibleNeighborhood() { return world.getVisibleNeighborhood(); }
+          GridView getVisibleNeighborhoodView() { return world.getVisibleNeighborhoodView(); }
+          vector<vector<GridCell> > getWorld(int power) { return world.getWorld(power); }
+          WorldSnapshot getWorldSnapshot(int power) { return world.getWorldSnapshot(power); }
+          GridView getWorldView(int power) { return world.getWorldView(power); }
+          void publishWorld(SharedWorld& shared) { world.publishWorld(shared); }
+
+          ActionResult try_scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)
+               {
+                    const ActionResult checked = self.try_scanEnemy(enemySpecs,enemyStatus,toScan);
+                    return checked ? record(Intent::SCAN_ENEMY,1,indexOf(toScan)) : checked;
                }
      };
 
+     /**Plays a simultaneous time step (see setSimultaneousMoves())*/
+     void executeSimultaneousStep();
+
+     /**Has a robot decide on its intents for a simultaneous time step*/
+     void decideIntents(TurnIntents& turn);
+
+     /**Marks intents of different robots claiming the same cell as
+      * cancelled*/
+     void cancelContested(int turns);
+
+     /**Carries out the intents of a simultaneous time step*/
+     void resolveIntents(int turns);
+
+     /**Carries out an intent on behalf of a robot
+      * @return result of the action*/
+     ActionResult applyIntent(RoboAPIImplementor& api, TurnIntents& turn, const Intent& intent);
+
 public:
      /**
       * Executes one timestep of the simulation.
-      * @return the winner, if any, or -1
+      * @return the winner, if any; NO_SURVIVORS if every robot is gone;
+      *         or -1 if the match goes on
       */
      int executeSingleTimeStep()
           {
-               for(turnOrder_pos=0; turnOrder_pos<turnOrder.size(); turnOrder_pos++)
-               {
-                    //References to robot's data
-                    RobotData& data = turnOrder[turnOrder_pos];
-                    RoboAPIImplementor student_api(*this,data);
-
-                    //Charge robot an amount of charge equal to charge skill
-                    data.status.charge = min(data.status.charge + data.specs.charge, data.specs.charge*10);
+               if(simultaneous)
+                    executeSimultaneousStep();
+               else
+                    for(turnOrder_pos=0; turnOrder_pos<turnOrder.turns(); turnOrder_pos++)
+                    {
+                         //Robots destroyed earlier in the time step don't get a turn
+                         RobotData* const acting = turnOrder.inTurn(turnOrder_pos);
+                         if(acting==NULL)
+                              continue;
 
-                    /*We can spend up to status.power power this turn, but
-                     *no more than our current charge level*/
-                    data.status.power = min(data.specs.power, data.status.charge);
+                         //References to robot's data
+                         RobotData& data = *acting;
+                         RoboAPIImplementor student_api(*this,data);
+                         startTurn(data);
 
-                    //Defense boost reset to zero at beginning of turn
-                    data.status.defense_boost = 0;
+                         //Run student code, giving it a copy of its status
+                         actRobot(data,student_api,data.status);
+                         radio.releaseAll(data.buffered_radio);
+                    }
 
-                    //Clone status for student
-                    Robot_Status clonedStatus = data.status;
+               //Between time steps, every robot left has had its turn
+               turnOrder.removeDead();
+               turnOrder_pos = turnOrder.turns();
+               if(turnOrder.size()==0)
+                    return NO_SURVIVORS;
 
-                    //Run student code
-                    data.robot->act(student_api,clonedStatus,data.buffered_radio);
-                    data.buffered_radio.clear();
-               }
-               
-               int player = turnOrder[0].player;
-               for(int i=1; i<turnOrder.size(); i++)
-                    if(turnOrder[i].player!=player)
+               const int player = turnOrder.begin()->player;
+               for(const RobotData& x : turnOrder)
+                    if(x.player!=player)
                          return -1;
                return player;
           }
@@ -2,14 +2,18 @@
 
 #include "robot_api.hpp"
 #include "WorldAPI.hpp"
+#include "RadioPool.hpp"
 
 #include <cstdint>
 #include <functional>
+#include <initializer_list>
 #include <list>
 #include <vector>
 
 using robot_api::Robot_Specs;
 using robot_api::Robot_Status;
+using robot_api::MessageView;
+using robot_api::RadioInbox;
 
 /**
  * Robot Interface:
@@ -19,6 +23,8 @@ using robot_api::Robot_Status;
 class Robot
 {
 public:
+     virtual ~Robot() { }
+
      /**
       * Entry point for your robot on its creation
       * @param api a pointer to a WorldAPI object you can use to
@@ -50,4 +56,93 @@ public:
       *                       nonzero power if you are being jammed.
       */
      virtual void act(WorldAPI& api, Robot_Status status, std::vector<std::vector<std::uint8_t> > received_radio) = 0;
+
+     /**
+      * Optional: saves your robot's own state when the simulator takes a
+      * checkpoint.
+      * @param state buffer to append your robot's state to, in any format
+      * @return whether you saved anything.  Robots that don't save
+      *         anything come back from a checkpoint freshly constructed,
+      *         without createRobot() being called again.
+      */
+     virtual bool saveState(std::vector<std::uint8_t>&) { return false; }
+
+     /**
+      * Optional: restores your robot's state when the simulator is
+      * restored from a checkpoint.  Called instead of createRobot().
+      * @param state what saveState() wrote
+      */
+     virtual void loadState(const std::vector<std::uint8_t>&) { }
+
+protected:
+     /**
+      * For saveState(): appends specs to state, field by field, in a
+      * format that doesn't depend on how the compiler lays out Robot_Specs.
+      */
+     static void saveSpecs(const Robot_Specs& specs, std::vector<std::uint8_t>& state)
+          {
+               for(std::int32_t field : { specs.attack, specs.defense, specs.power, specs.charge })
+                    for(int shift=0; shift<32; shift+=8)
+                         state.push_back(static_cast<std::uint32_t>(field) >> shift);
+          }
+
+     /**
+      * For loadState(): reads specs as saveSpecs() wrote them at the start
+      * of state, leaving specs alone if state is too short.
+      * @return whether specs were read
+      */
+     static bool loadSpecs(const std::vector<std::uint8_t>& state, Robot_Specs& specs)
+          {
+               if(state.size() < 16)
+                    return false;
+               int* const fields[] = { &specs.attack, &specs.defense, &specs.power, &specs.charge };
+               for(int i=0; i<4; i++)
+               {
+                    std::uint32_t field = 0;
+                    for(int shift=0; shift<32; shift+=8)
+                         field |= static_cast<std::uint32_t>(state[4*i+shift/8]) << shift;
+                    *fields[i] = static_cast<std::int32_t>(field);
+               }
+               return true;
+          }
+};
+
+/**
+ * Robot Interface, version 2:
+ * Like Robot, but act() and createRobot() get their arguments without
+ * copies: the status by reference and messages as views, which are only
+ * valid during the call.  Keep copies of anything you need later.<br>
+ * A RobotV2 is still a Robot, so it can be used anywhere a Robot can; the
+ * simulator notices which interface a robot implements when it's created
+ * and calls the version 2 methods directly.  Called through the original
+ * interface, the version 1 methods below pass their arguments on.
+ */
+class RobotV2 : public Robot
+{
+public:
+     /**
+      * Entry point for your robot on its creation; see Robot::createRobot().
+      * @param message view of the 64-byte message from the robot who
+      *                created you
+      */
+     virtual Robot_Specs createRobot(WorldAPI* api, int skill_points, MessageView message) = 0;
+
+     /**
+      * Each turn, this method is called to allow your robot to act; see
+      * Robot::act().
+      * @param status your status at the start of the turn
+      * @param received_radio the radio signals you have received this
+      *                       round, each exactly 64 bytes long
+      */
+     virtual void act(WorldAPI& api, const Robot_Status& status, const RadioInbox& received_radio) = 0;
+
+     Robot_Specs createRobot(WorldAPI* api, int skill_points, std::vector<std::uint8_t> message) final
+          {
+               return createRobot(api,skill_points,MessageView(message));
+          }
+
+     void act(WorldAPI& api, Robot_Status status, std::vector<std::vector<std::uint8_t> > received_radio) final
+          {
+               act(api,status,RadioInbox(received_radio));
+          }
 };
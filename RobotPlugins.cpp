@@ -0,0 +1,67 @@
+#include "RobotPlugins.hpp"
+
+#include <fstream>
+#include <string>
+
+#include <dlfcn.h>
+
+using std::string;
+
+using robot_api::RoboSimExecutionException;
+
+RobotPlugins::~RobotPlugins()
+{
+     for(Plugin& x : plugins)
+          dlclose(x.handle);
+}
+
+int RobotPlugins::load(const string& path)
+{
+     const int player = plugins.size()+1;
+
+     //RTLD_LOCAL keeps one plugin's symbols from standing in for another's
+     void* const handle = dlopen(path.c_str(),RTLD_NOW|RTLD_LOCAL);
+     if(!handle)
+          throw RoboSimExecutionException(string("could not load robot plugin: ")+dlerror(),player);
+
+     typedef const RobotPluginInfo* (*EntryPoint)();
+     const EntryPoint entry = reinterpret_cast<EntryPoint>(dlsym(handle,RBP_PLUGIN_ENTRY_POINT));
+     const RobotPluginInfo* const info = entry ? entry() : NULL;
+     if(!info || !info->create)
+     {
+          dlclose(handle);
+          throw RoboSimExecutionException(path+" is not a robot plugin (no "+RBP_PLUGIN_ENTRY_POINT+"; see RBP_EXPORT_ROBOT)",player);
+     }
+     if(info->abi_version!=RBP_PLUGIN_ABI_VERSION)
+     {
+          //info goes away with the plugin
+          const int abi_version = info->abi_version;
+          dlclose(handle);
+          throw RoboSimExecutionException(path+" was built for robot plugin ABI version "+std::to_string(abi_version)+
+                                          ", not "+std::to_string(RBP_PLUGIN_ABI_VERSION)+"; rebuild it",player);
+     }
+
+     plugins.push_back(Plugin{ path, handle, info });
+     return player;
+}
+
+void RobotPlugins::loadRoster(const string& path)
+{
+     std::ifstream in(path);
+     if(!in)
+          throw RoboSimExecutionException("could not read robot plugin roster "+path);
+
+     const string::size_type slash = path.rfind('/');
+     const string dir = slash==string::npos ? string() : path.substr(0,slash+1);
+
+     string line;
+     while(std::getline(in,line))
+     {
+          const string::size_type begin = line.find_first_not_of(" \t\r");
+          if(begin==string::npos || line[begin]=='#')
+               continue;
+          const string::size_type end = line.find_last_not_of(" \t\r");
+          const string plugin = line.substr(begin,end-begin+1);
+          load(plugin[0]=='/' ? plugin : dir+plugin);
+     }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Robot.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Version of the interface between the simulator and robot plugins: the
+ * layout of RobotPluginInfo, and of Robot, RobotV2, WorldAPI and the
+ * types in robot_api.hpp they use.  Bump it whenever any of those change,
+ * so plugins built against the old ones are refused rather than run.
+ */
+#define RBP_PLUGIN_ABI_VERSION 1
+
+/**What a robot plugin tells the simulator about itself*/
+struct RobotPluginInfo
+{
+     /**RBP_PLUGIN_ABI_VERSION the plugin was built with*/
+     int abi_version;
+
+     /**name of the plugin's robot class, for error messages*/
+     const char* name;
+
+     /**makes a robot, which the simulator deletes when it's done*/
+     Robot* (*create)();
+};
+
+/**Name of the function a robot plugin exports, returning its
+ * RobotPluginInfo*/
+#define RBP_PLUGIN_ENTRY_POINT "rbp_robot_plugin"
+
+#ifdef _WIN32
+#define RBP_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define RBP_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+/**
+ * Makes the shared object it's used in a robot plugin for robots of type
+ * Type, which must be default-constructible.  Use it once, at namespace
+ * scope, e.g. in YourRobotName.cpp:
+ *
+ *     #include "YourRobotName.hpp"
+ *     #include "RobotPlugins.hpp"
+ *     RBP_EXPORT_ROBOT(YourRobotName)
+ *
+ * and build it with e.g. "g++ -std=c++11 -O2 -shared -fPIC
+ * YourRobotName.cpp -o YourRobotName.so".  The plugin uses the
+ * simulator's own copy of robot_api.cpp, so programs that load plugins
+ * must be linked with -rdynamic.
+ */
+#define RBP_EXPORT_ROBOT(Type) \
+     extern "C" RBP_PLUGIN_EXPORT const RobotPluginInfo* rbp_robot_plugin() \
+     { \
+          static const RobotPluginInfo info = { RBP_PLUGIN_ABI_VERSION, #Type, []() -> Robot* { return new Type(); } }; \
+          return &info; \
+     }
+
+/**
+ * RobotPlugins: a roster of robot types loaded at run time from plugins
+ * (shared objects made with RBP_EXPORT_ROBOT), rather than compiled in
+ * through player_config.hpp.  Player n plays the robots of the nth plugin
+ * loaded, and there can be as many players as plugins.<br>
+ * Robots' code lives in their plugin, so a RobotPlugins must outlive
+ * every robot made through it.  POSIX only.
+ */
+class RobotPlugins
+{
+public:
+     RobotPlugins() { }
+
+     /**Unloads the plugins*/
+     ~RobotPlugins();
+
+     RobotPlugins(const RobotPlugins&) = delete;
+     RobotPlugins& operator=(const RobotPlugins&) = delete;
+
+     /**Loads a plugin as the next player
+      * @return the player it was loaded as
+      * @throws RoboSimExecutionException if it can't be loaded, isn't a
+      *         robot plugin or was built for another ABI version*/
+     int load(const std::string& path);
+
+     /**Loads a plugin as the next player for each line of a roster file
+      * that isn't blank or a comment (starting with '#').  A relative
+      * path is taken relative to the roster file.
+      * @throws RoboSimExecutionException if the file can't be read, or
+      *         one of its plugins can't be loaded*/
+     void loadRoster(const std::string& path);
+
+     /**@return number of players loaded*/
+     int players() const { return plugins.size(); }
+
+     /**@return path the given player's plugin was loaded from*/
+     const std::string& path(int player) const { return plugins[player-1].path; }
+
+     /**@return new robot for the given player, which the caller owns*/
+     Robot* construct(int player) const { return plugins[player-1].info->create(); }
+
+     /**@return factory making robots of the players loaded, to give
+      *         RoboSim*/
+     std::function<Robot*(int player)> factory() const { return [this](int player) { return construct(player); }; }
+
+private:
+     struct Plugin
+     {
+          std::string path;
+          void* handle;
+          const RobotPluginInfo* info;
+     };
+
+     std::vector<Plugin> plugins;
+};
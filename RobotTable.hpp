@@ -0,0 +1,156 @@
+#pragma once
+
+#include "robot_api.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <vector>
+
+namespace robot_api
+{
+     /**
+      * RobotTable: the simulator's robots, in turn order.<br>
+      * A slot map: each robot lives in a slot that never moves, so
+      * pointers to robots stay valid while robots are added, and the world
+      * grid can find a robot from its slot number in O(1).  Slots of
+      * destroyed robots are reused once they're removed.<br>
+      * Removal is deferred: kill() takes a robot out of play at once, but
+      * its slot is only freed (and the turn order compacted) by
+      * removeDead(), which the simulator calls at the end of each time
+      * step.  Until then, data of dead robots stays where it was, so a
+      * robot destroyed during some other robot's turn can't pull the data
+      * out from under it.
+      */
+     class RobotTable
+     {
+     private:
+          struct Slot
+          {
+               RobotData data;
+               bool live;
+          };
+
+          //Deque, so adding slots doesn't move the existing ones
+          std::deque<Slot> slots;
+          vector<std::uint32_t> free_slots;
+
+          //Slots in turn order, including dead robots awaiting removal
+          vector<std::uint32_t> order;
+          int dead;
+
+     public:
+          /**Iterates over live robots in turn order*/
+          template<class Table, class Data>
+          class Iterator
+          {
+          private:
+               friend class RobotTable;
+
+               Table* table;
+               int pos;
+
+               Iterator(Table* table_, int pos_) : table(table_), pos(pos_) { skipDead(); }
+
+               void skipDead()
+                    {
+                         while(pos < int(table->order.size()) && !table->slots[table->order[pos]].live)
+                              pos++;
+                    }
+
+          public:
+               typedef std::forward_iterator_tag iterator_category;
+               typedef Data value_type;
+               typedef std::ptrdiff_t difference_type;
+               typedef Data* pointer;
+               typedef Data& reference;
+
+               Data& operator*() const { return table->slots[table->order[pos]].data; }
+               Data* operator->() const { return &**this; }
+               Iterator& operator++() { pos++; skipDead(); return *this; }
+               bool operator==(const Iterator& other) const { return pos==other.pos; }
+               bool operator!=(const Iterator& other) const { return pos!=other.pos; }
+          };
+
+          typedef Iterator<RobotTable,RobotData> iterator;
+          typedef Iterator<const RobotTable,const RobotData> const_iterator;
+
+          RobotTable() : dead(0) { }
+
+          iterator begin() { return iterator(this,0); }
+          iterator end() { return iterator(this,order.size()); }
+          const_iterator begin() const { return const_iterator(this,0); }
+          const_iterator end() const { return const_iterator(this,order.size()); }
+
+          /**@return number of live robots*/
+          int size() const { return order.size() - dead; }
+
+          /**@return number of places in the turn order, including those of
+           *         dead robots awaiting removal*/
+          int turns() const { return order.size(); }
+
+          /**@return robot at a place in the turn order, or NULL if it's
+           *         been destroyed*/
+          RobotData* inTurn(int pos)
+               {
+                    Slot& slot = slots[order[pos]];
+                    return slot.live ? &slot.data : NULL;
+               }
+
+          /**@return robot in a slot (live or awaiting removal)*/
+          RobotData& inSlot(int slot) { return slots[slot].data; }
+          const RobotData& inSlot(int slot) const { return slots[slot].data; }
+
+          /**Adds a robot at the end of the turn order
+           * @return the new robot's data, with only its slot filled in*/
+          RobotData& add()
+               {
+                    std::uint32_t slot;
+                    if(free_slots.empty())
+                    {
+                         slot = slots.size();
+                         slots.emplace_back();
+                    }
+                    else
+                    {
+                         slot = free_slots.back();
+                         free_slots.pop_back();
+                    }
+                    slots[slot].live = true;
+                    order.push_back(slot);
+
+                    RobotData& data = slots[slot].data;
+                    data.slot = slot;
+                    return data;
+               }
+
+          /**Takes a robot out of play; its data stays valid until
+           * removeDead()*/
+          void kill(RobotData& robot)
+               {
+                    slots[robot.slot].live = false;
+                    dead++;
+               }
+
+          /**Frees the slots of robots killed since the last call and closes
+           * the gaps they left in the turn order*/
+          void removeDead()
+               {
+                    if(!dead)
+                         return;
+
+                    int kept = 0;
+                    for(std::uint32_t slot : order)
+                         if(slots[slot].live)
+                              order[kept++] = slot;
+                         else
+                         {
+                              slots[slot].data = RobotData();
+                              free_slots.push_back(slot);
+                         }
+                    order.resize(kept);
+                    dead = 0;
+               }
+     };
+}
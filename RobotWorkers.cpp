@@ -0,0 +1,1027 @@
+#include "RobotWorkers.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+using std::string;
+using std::uint32_t;
+
+namespace robot_api
+{
+     //Here rather than in the header, so only this file needs POSIX
+     SharedWorld::SharedWorld(int length, int width) : source(0), source_version(0), source_player(0)
+     {
+          bytes = sizeof(Header) + sizeof(WorldGrid::PackedCell)*length*width;
+          void* const memory = mmap(NULL,bytes,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+          if(memory==MAP_FAILED)
+               throw RoboSimExecutionException("could not map memory to share with a robot worker");
+
+          header = static_cast<Header*>(memory);
+          header->generation = 0;
+          header->self_index = -1;
+          header->length = length;
+          header->width = width;
+          header->neighborhood = Window{ 0, 0, 0, 0 };
+          cells = reinterpret_cast<WorldGrid::PackedCell*>(header+1);
+     }
+
+     SharedWorld::~SharedWorld()
+     {
+          munmap(header,bytes);
+     }
+}
+
+namespace
+{
+     typedef std::chrono::steady_clock Clock;
+
+     //How often a simulator waiting on a worker checks that it's alive
+     const int POLL_SLICE_MS = 100;
+
+     //Largest message either end will accept
+     const uint32_t MAX_MESSAGE = 1 << 28;
+
+     //Messages between the simulator and a worker
+     enum MessageType
+     {
+          //To the worker
+          CREATE, ACT, DESTROY, SAVE, LOAD, REPLY,
+
+          //To the simulator
+          SPECS, CALL, DONE, FAILED, STATE
+     };
+
+     //WorldAPI calls a worker passes on to the simulator
+     enum CallType
+     {
+          MELEE_ATTACK, RANGED_ATTACK, CAPSULE_ATTACK, DEFEND, MOVE, PICK_UP_CAPSULE, DROP_CAPSULE,
+          GET_BUILD_STATUS, GET_BUILD_TARGET, GET_INVESTED_BUILD_POWER, SET_BUILD_TARGET,
+          SET_BUILD_TARGET_WITH_MESSAGE, BUILD, REPAIR, CHARGE, SEND_MESSAGE, SCAN_ENEMY
+     };
+
+     //Thrown on reading past the end of a message
+     struct MalformedMessage { };
+
+     /**
+      * Body of a message, after room for its header.<br>
+      * Both ends are the same program (workers are forked, not exec'd),
+      * so plain data is copied as it lies in memory; even the reason of an
+      * ActionResult, a pointer to a string constant, means the same thing
+      * at both ends.
+      */
+     class Packet
+     {
+     private:
+          static const int HEADER = 2*sizeof(uint32_t);
+
+          vector<uint8_t> data;
+          std::size_t pos;
+
+          const uint8_t* take(std::size_t length)
+               {
+                    if(length > data.size()-pos)
+                         throw MalformedMessage();
+                    const uint8_t* to_return = data.data()+pos;
+                    pos += length;
+                    return to_return;
+               }
+
+          static bool readAll(int fd, void* buffer, std::size_t length)
+               {
+                    uint8_t* to = static_cast<uint8_t*>(buffer);
+                    while(length > 0)
+                    {
+                         const ssize_t got = recv(fd,to,length,0);
+                         if(got < 0 && errno==EINTR)
+                              continue;
+                         if(got <= 0)
+                              return false;
+                         to += got;
+                         length -= got;
+                    }
+                    return true;
+               }
+
+     public:
+          Packet() { clear(); }
+
+          /**Empties the packet, to write a new message*/
+          void clear()
+               {
+                    data.resize(HEADER);
+                    pos = HEADER;
+               }
+
+          template<class T>
+          Packet& put(const T& x)
+               {
+                    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&x);
+                    data.insert(data.end(),bytes,bytes+sizeof(T));
+                    return *this;
+               }
+
+          Packet& putBytes(const uint8_t* bytes, std::size_t length)
+               {
+                    put<uint32_t>(length);
+                    data.insert(data.end(),bytes,bytes+length);
+                    return *this;
+               }
+
+          Packet& putBytes(const vector<uint8_t>& bytes) { return putBytes(bytes.data(),bytes.size()); }
+          Packet& putString(const string& text) { return putBytes(reinterpret_cast<const uint8_t*>(text.data()),text.size()); }
+
+          Packet& putStatus(const Robot_Status& status)
+               {
+                    put(status.power).put(status.charge).put(status.health).put(status.defense_boost);
+                    put<uint32_t>(status.capsules.size());
+                    for(int power : status.capsules)
+                         put(power);
+                    return *this;
+               }
+
+          template<class T>
+          T get()
+               {
+                    T to_return;
+                    std::memcpy(&to_return,take(sizeof(T)),sizeof(T));
+                    return to_return;
+               }
+
+          void getBytes(vector<uint8_t>& out)
+               {
+                    const uint32_t length = get<uint32_t>();
+                    const uint8_t* bytes = take(length);
+                    out.assign(bytes,bytes+length);
+               }
+
+          vector<uint8_t> getBytes()
+               {
+                    vector<uint8_t> to_return;
+                    getBytes(to_return);
+                    return to_return;
+               }
+
+          string getString()
+               {
+                    const vector<uint8_t> bytes = getBytes();
+                    return string(bytes.begin(),bytes.end());
+               }
+
+          Robot_Status getStatus()
+               {
+                    Robot_Status to_return;
+                    to_return.power = get<int>();
+                    to_return.charge = get<int>();
+                    to_return.health = get<int>();
+                    to_return.defense_boost = get<int>();
+                    const uint32_t capsules = get<uint32_t>();
+                    for(uint32_t i=0; i<capsules; i++)
+                         to_return.capsules.add(get<int>());
+                    return to_return;
+               }
+
+          /**Sends the packet as a message of the given type
+           * @return whether it could be sent*/
+          bool send(int fd, uint32_t type)
+               {
+                    const uint32_t header[2] = { type, static_cast<uint32_t>(data.size()-HEADER) };
+                    std::memcpy(data.data(),header,HEADER);
+                    std::size_t sent = 0;
+                    while(sent < data.size())
+                    {
+                         const ssize_t wrote = ::send(fd,data.data()+sent,data.size()-sent,MSG_NOSIGNAL);
+                         if(wrote < 0 && errno==EINTR)
+                              continue;
+                         if(wrote <= 0)
+                              return false;
+                         sent += wrote;
+                    }
+                    return true;
+               }
+
+          /**Receives a message into the packet, blocking until it's all there
+           * @param type set to the type of message
+           * @return whether one could be received*/
+          bool receive(int fd, uint32_t& type)
+               {
+                    uint32_t header[2];
+                    if(!readAll(fd,header,HEADER) || header[1] > MAX_MESSAGE)
+                         return false;
+                    type = header[0];
+                    data.resize(HEADER+header[1]);
+                    pos = HEADER;
+                    return readAll(fd,data.data()+HEADER,header[1]);
+               }
+     };
+
+     /**
+      * The worker's end: runs one player's robots for the simulator,
+      * passing their actions back to it.
+      */
+     class WorkerProcess
+     {
+     private:
+          int fd;
+          const SharedWorld& world;
+          const RoboSim::RobotFactory& factory;
+          int player_;
+
+          std::unordered_map<uint32_t,std::unique_ptr<Robot> > robots;
+          Packet in;
+          Packet out;
+
+          //Inbox of the robot acting (kept so its storage is reused)
+          vector<vector<uint8_t> > inbox;
+
+          //Cells handed out by snapshot(), and the generation of the
+          //shared world they were copied at
+          std::shared_ptr<vector<GridCell> > snapshot_cells;
+          unsigned long long snapshot_generation;
+
+          /**@return robot with the given ID, made if it doesn't exist yet
+           *         (as for robots restored from a checkpoint)*/
+          Robot& robot(uint32_t id)
+               {
+                    std::unique_ptr<Robot>& to_return = robots[id];
+                    if(!to_return)
+                         to_return.reset(factory(player_));
+                    return *to_return;
+               }
+
+          /**Carries out a message from the simulator*/
+          void handle(uint32_t type);
+
+     public:
+          WorkerProcess(int fd_, const SharedWorld& world_, const RoboSim::RobotFactory& factory_, int player_in)
+               : fd(fd_), world(world_), factory(factory_), player_(player_in), snapshot_generation(0) { }
+
+          int player() const { return player_; }
+          const SharedWorld& sharedWorld() const { return world; }
+
+          /**Serves the simulator until it goes away*/
+          void run()
+               {
+                    uint32_t type;
+                    while(in.receive(fd,type))
+                         handle(type);
+               }
+
+          /**@return packet to write the arguments of a call into*/
+          Packet& startCall(CallType code)
+               {
+                    out.clear();
+                    out.put<uint32_t>(code);
+                    return out;
+               }
+
+          /**Passes the call started with startCall() to the simulator,
+           * carrying out anything else it asks for in the meantime (like
+           * creating a robot the call built)
+           * @return the reply*/
+          Packet& call()
+               {
+                    if(!out.send(fd,CALL))
+                         _exit(0);
+                    uint32_t type;
+                    for(;;)
+                    {
+                         if(!in.receive(fd,type))
+                              _exit(0);
+                         if(type==REPLY)
+                              return in;
+                         handle(type);
+                    }
+               }
+
+          /**@return snapshot of the shared world, shared with every other
+           *         robot asking before it changes*/
+          WorldSnapshot snapshot()
+               {
+                    if(!snapshot_cells || snapshot_generation!=world.generation())
+                    {
+                         //If no robot is holding on to the stale copy, refill it in place
+                         if(!snapshot_cells || snapshot_cells.use_count()!=1)
+                              snapshot_cells = std::make_shared<vector<GridCell> >(world.size());
+
+                         vector<GridCell>& cells = *snapshot_cells;
+                         for(int i=0; i<world.size(); i++)
+                              cells[i] = world.cell(i);
+                         if(world.selfIndex()!=-1)
+                              cells[world.selfIndex()].contents = ALLY;
+                         snapshot_generation = world.generation();
+                    }
+                    return WorldSnapshot(snapshot_cells,world.length(),world.width(),world.selfIndex());
+               }
+     };
+
+     /**
+      * The WorldAPI robots get in a worker.  Actions are passed on to the
+      * simulator; views and snapshots of the world are read straight out
+      * of the shared world.
+      */
+     class WorkerWorldAPI : public WorldAPI
+     {
+     private:
+          WorkerProcess& process;
+          const SharedWorld& world;
+
+          //Storage for the cell returned by getBuildTarget()
+          GridCell build_target;
+
+          ActionResult attack(CallType code, int power, const GridCell& cell, AttackResult& result)
+               {
+                    process.startCall(code).put(power).put(cell);
+                    Packet& reply = process.call();
+                    const ActionResult to_return = reply.get<ActionResult>();
+                    if(to_return)
+                         result = reply.get<AttackResult>();
+                    return to_return;
+               }
+
+          ActionResult spend(CallType code, int power)
+               {
+                    process.startCall(code).put(power);
+                    return process.call().get<ActionResult>();
+               }
+
+          void checkWorldPower(int power) const
+               {
+                    if(power!=3)
+                         throw RoboSimExecutionException("tried to get world with invalid power (not equal to 3)",process.player(),world.cell(world.selfIndex()));
+               }
+
+     public:
+          explicit WorkerWorldAPI(WorkerProcess& process_) : process(process_), world(process_.sharedWorld()) { }
+
+          ActionResult try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result) { return attack(MELEE_ATTACK,power,adjacent_cell,result); }
+          ActionResult try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result) { return attack(RANGED_ATTACK,power,nonadjacent_cell,result); }
+          ActionResult try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result) { return attack(CAPSULE_ATTACK,power_of_capsule,cell,result); }
+          ActionResult try_defend(int power) { return spend(DEFEND,power); }
+
+          ActionResult try_move(int steps, Direction way)
+               {
+                    process.startCall(MOVE).put(steps).put(way);
+                    return process.call().get<ActionResult>();
+               }
+
+          ActionResult try_pick_up_capsule(GridCell& adjacent_cell)
+               {
+                    process.startCall(PICK_UP_CAPSULE).put(adjacent_cell);
+                    return process.call().get<ActionResult>();
+               }
+
+          ActionResult try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule)
+               {
+                    process.startCall(DROP_CAPSULE).put(adjacent_cell).put(power_of_capsule);
+                    return process.call().get<ActionResult>();
+               }
+
+          BuildStatus getBuildStatus()
+               {
+                    process.startCall(GET_BUILD_STATUS);
+                    return process.call().get<BuildStatus>();
+               }
+
+          GridCell* getBuildTarget()
+               {
+                    process.startCall(GET_BUILD_TARGET);
+                    Packet& reply = process.call();
+                    if(!reply.get<uint8_t>())
+                         return NULL;
+                    build_target = reply.get<GridCell>();
+                    return &build_target;
+               }
+
+          int getInvestedBuildPower()
+               {
+                    process.startCall(GET_INVESTED_BUILD_POWER);
+                    return process.call().get<int>();
+               }
+
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location)
+               {
+                    Packet& args = process.startCall(SET_BUILD_TARGET).put(status).put<uint8_t>(location!=NULL);
+                    if(location)
+                         args.put(*location);
+                    return process.call().get<ActionResult>();
+               }
+
+          ActionResult try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message)
+               {
+                    Packet& args = process.startCall(SET_BUILD_TARGET_WITH_MESSAGE).put(status).put<uint8_t>(location!=NULL);
+                    if(location)
+                         args.put(*location);
+                    args.putBytes(message);
+                    return process.call().get<ActionResult>();
+               }
+
+          ActionResult try_build(int power) { return spend(BUILD,power); }
+          ActionResult try_repair(int power) { return spend(REPAIR,power); }
+
+          ActionResult try_charge(int power, GridCell& ally)
+               {
+                    process.startCall(CHARGE).put(power).put(ally);
+                    return process.call().get<ActionResult>();
+               }
+
+          ActionResult try_sendMessage(const vector<uint8_t>& message, int power)
+               {
+                    process.startCall(SEND_MESSAGE).putBytes(message).put(power);
+                    return process.call().get<ActionResult>();
+               }
+
+          vector<vector<GridCell> > getVisibleNeighborhood()
+               {
+                    vector<vector<GridCell> > to_return;
+                    getVisibleNeighborhoodView().copyTo(to_return);
+                    return to_return;
+               }
+
+          GridView getVisibleNeighborhoodView()
+               {
+                    const SharedWorld::Window window = world.neighborhood();
+                    return GridView(world,window.x_left,window.y_up,window.length,window.width);
+               }
+
+          vector<vector<GridCell> > getWorld(int power)
+               {
+                    vector<vector<GridCell> > to_return;
+                    getWorldSnapshot(power).copyTo(to_return);
+                    return to_return;
+               }
+
+          WorldSnapshot getWorldSnapshot(int power)
+               {
+                    checkWorldPower(power);
+                    return process.snapshot();
+               }
+
+          GridView getWorldView(int power)
+               {
+                    checkWorldPower(power);
+                    return GridView(world,0,0,world.length(),world.width());
+               }
+
+          ActionResult try_scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)
+               {
+                    process.startCall(SCAN_ENEMY).put(toScan);
+                    Packet& reply = process.call();
+                    const ActionResult to_return = reply.get<ActionResult>();
+                    if(to_return)
+                    {
+                         enemySpecs = reply.get<Robot_Specs>();
+                         enemyStatus = reply.getStatus();
+                    }
+                    return to_return;
+               }
+     };
+
+     void WorkerProcess::handle(uint32_t type)
+     {
+          try
+          {
+               const uint32_t id = in.get<uint32_t>();
+               switch(type)
+               {
+               case CREATE:
+                    {
+                         const int skill_points = in.get<int>();
+                         const vector<uint8_t> message = in.getBytes();
+                         Robot& created = robot(id);
+                         RobotV2* const created_v2 = dynamic_cast<RobotV2*>(&created);
+                         const Robot_Specs specs = created_v2 ? created_v2->createRobot(NULL,skill_points,MessageView(message)) : created.createRobot(NULL,skill_points,message);
+                         out.clear();
+                         out.put(specs).send(fd,SPECS);
+                         break;
+                    }
+               case ACT:
+                    {
+                         const Robot_Status status = in.getStatus();
+                         inbox.resize(in.get<uint32_t>());
+                         for(vector<uint8_t>& x : inbox)
+                              in.getBytes(x);
+
+                         Robot& acting = robot(id);
+                         WorkerWorldAPI api(*this);
+                         if(RobotV2* const acting_v2 = dynamic_cast<RobotV2*>(&acting))
+                              acting_v2->act(api,status,RadioInbox(inbox));
+                         else
+                              acting.act(api,status,inbox);
+                         out.clear();
+                         out.send(fd,DONE);
+                         break;
+                    }
+               case DESTROY:
+                    robots.erase(id);
+                    break;
+               case SAVE:
+                    {
+                         vector<uint8_t> state;
+                         const bool saved = robot(id).saveState(state);
+                         out.clear();
+                         out.put<uint8_t>(saved).putBytes(state).send(fd,STATE);
+                         break;
+                    }
+               case LOAD:
+                    {
+                         const vector<uint8_t> state = in.getBytes();
+                         robot(id).loadState(state);
+                         out.clear();
+                         out.send(fd,DONE);
+                         break;
+                    }
+               }
+          }
+          //Pass failures back, telling rule violations apart from robot
+          //code blowing up
+          catch(const RoboSimExecutionException& e)
+          {
+               out.clear();
+               out.put<uint8_t>(true).putString(e.msg).send(fd,FAILED);
+          }
+          catch(const std::exception& e)
+          {
+               out.clear();
+               out.put<uint8_t>(false).putString(e.what()).send(fd,FAILED);
+          }
+          catch(...)
+          {
+               out.clear();
+               out.put<uint8_t>(false).putString("robot code threw an unknown exception").send(fd,FAILED);
+          }
+     }
+}
+
+/**The simulator's end of a worker process*/
+struct RobotWorkers::Worker
+{
+     int player;
+     int timeout_ms;
+     pid_t pid;
+     int fd;
+
+     //Why the worker was killed, or NULL while it's running
+     const char* failure;
+
+     //Held while talking to the worker.  Recursive, since carrying out a
+     //robot's action can make another robot of the same player.
+     std::recursive_mutex lock;
+     uint32_t next_id;
+
+     SharedWorld world;
+     Packet in;
+     Packet out;
+
+     Worker(int player_, int length, int width, int timeout_ms_)
+          : player(player_), timeout_ms(timeout_ms_), pid(-1), fd(-1), failure(NULL), next_id(0), world(length,width) { }
+
+     ~Worker() { stop(); }
+
+     /**Forks the worker process, which makes robots with factory*/
+     void start(const RoboSim::RobotFactory& factory);
+
+     /**Kills the worker process, if it's running*/
+     void stop()
+          {
+               if(pid > 0)
+               {
+                    kill(pid,SIGKILL);
+                    int status;
+                    while(waitpid(pid,&status,0) < 0 && errno==EINTR);
+                    pid = -1;
+               }
+               if(fd >= 0)
+               {
+                    close(fd);
+                    fd = -1;
+               }
+          }
+
+     /**Kills the worker and blames its player*/
+     [[noreturn]] void fail(const char* why)
+          {
+               if(failure==NULL)
+                    failure = why;
+               stop();
+               throw RoboSimExecutionException(failure,player);
+          }
+
+     /**Throws if the worker has been killed*/
+     void check() const
+          {
+               if(failure)
+                    throw RoboSimExecutionException(failure,player);
+          }
+
+     /**Sends out as a message of the given type*/
+     void send(uint32_t type)
+          {
+               if(!out.send(fd,type))
+                    fail("robot worker process died");
+          }
+
+     /**Sends out without throwing
+      * @return whether it could be sent*/
+     bool post(uint32_t type)
+          {
+               if(failure==NULL && out.send(fd,type))
+                    return true;
+               if(failure==NULL)
+                    failure = "robot worker process died";
+               stop();
+               return false;
+          }
+
+     /**Waits for a message from the worker into in
+      * @return its type*/
+     uint32_t receive(Clock::time_point deadline)
+          {
+               for(;;)
+               {
+                    int wait = POLL_SLICE_MS;
+                    if(timeout_ms > 0)
+                    {
+                         const long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline-Clock::now()).count();
+                         if(left <= 0)
+                              fail("robot worker process took too long");
+                         wait = std::min<long long>(wait,left);
+                    }
+
+                    pollfd ready = { fd, POLLIN, 0 };
+                    const int events = poll(&ready,1,wait);
+                    if(events > 0)
+                    {
+                         uint32_t type;
+                         if(!in.receive(fd,type))
+                              fail("robot worker process died");
+                         return type;
+                    }
+                    if(events < 0 && errno!=EINTR)
+                         fail("robot worker process died");
+
+                    //Other processes may hold our socket's far end too (any
+                    //process forked meanwhile), so it may never close
+                    int status;
+                    if(waitpid(pid,&status,WNOHANG)==pid)
+                    {
+                         pid = -1;
+                         fail("robot worker process died");
+                    }
+               }
+          }
+
+     /**
+      * Waits for the worker to finish what it was asked, carrying out the
+      * robot's calls on api in the meantime.
+      * @param expected type of message that means it's done
+      * @return the message, in in
+      */
+     Packet& await(uint32_t expected, WorldAPI* api)
+          {
+               const Clock::time_point deadline = Clock::now()+std::chrono::milliseconds(timeout_ms);
+               try
+               {
+                    for(;;)
+                    {
+                         const uint32_t type = receive(deadline);
+                         if(type==expected)
+                              return in;
+                         else if(type==CALL && api)
+                              serve(*api);
+                         else if(type==FAILED)
+                              rethrow();
+                         else
+                              fail("robot worker process sent an unexpected message");
+                    }
+               }
+               catch(const MalformedMessage&)
+               {
+                    fail("robot worker process sent a malformed message");
+               }
+          }
+
+     /**Carries out a call on api and replies with its result*/
+     void serve(WorldAPI& api);
+
+     /**Throws what the robot's code threw in the worker, as passed back
+      * in a FAILED message.  Whatever the worker says, the blame for a
+      * rule violation is ours: a robot mustn't be able to pin it on its
+      * opponent.*/
+     [[noreturn]] void rethrow()
+          {
+               const bool broke_rules = in.get<uint8_t>();
+               const string msg = in.getString();
+               if(!broke_rules)
+                    throw std::runtime_error(msg);
+
+               RoboSimExecutionException to_throw(msg);
+               to_throw.player = player;
+               throw to_throw;
+          }
+};
+
+void RobotWorkers::Worker::start(const RoboSim::RobotFactory& factory)
+{
+     int ends[2];
+     if(socketpair(AF_UNIX,SOCK_STREAM,0,ends)!=0)
+          throw RoboSimExecutionException("could not start robot worker process",player);
+
+     const pid_t parent = getpid();
+     pid = fork();
+     if(pid < 0)
+     {
+          close(ends[0]);
+          close(ends[1]);
+          throw RoboSimExecutionException("could not start robot worker process",player);
+     }
+
+     if(pid==0)
+     {
+          //In the worker: serve until the simulator goes away, then leave
+          //without running any of its exit handlers or destructors
+          close(ends[0]);
+#ifdef __linux__
+          prctl(PR_SET_PDEATHSIG,SIGKILL);
+          if(getppid()!=parent)
+               _exit(0);
+#endif
+          WorkerProcess(ends[1],world,factory,player).run();
+          _exit(0);
+     }
+
+     close(ends[1]);
+     fd = ends[0];
+}
+
+void RobotWorkers::Worker::serve(WorldAPI& api)
+{
+     //Read the arguments before making the call: it can make a robot,
+     //which talks to the worker through in and out
+     try
+     {
+          const uint32_t code = in.get<uint32_t>();
+          switch(code)
+          {
+          case MELEE_ATTACK:
+          case RANGED_ATTACK:
+          case CAPSULE_ATTACK:
+               {
+                    const int power = in.get<int>();
+                    GridCell cell = in.get<GridCell>();
+                    AttackResult attack = MISSED;
+                    const ActionResult result = code==MELEE_ATTACK ? api.try_meleeAttack(power,cell,attack) :
+                                                code==RANGED_ATTACK ? api.try_rangedAttack(power,cell,attack) :
+                                                                      api.try_capsuleAttack(power,cell,attack);
+                    out.clear();
+                    out.put(result);
+                    if(result)
+                         out.put(attack);
+                    break;
+               }
+          case DEFEND:
+          case BUILD:
+          case REPAIR:
+               {
+                    const int power = in.get<int>();
+                    const ActionResult result = code==DEFEND ? api.try_defend(power) : code==BUILD ? api.try_build(power) : api.try_repair(power);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case MOVE:
+               {
+                    const int steps = in.get<int>();
+                    const Direction way = in.get<Direction>();
+                    const ActionResult result = api.try_move(steps,way);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case PICK_UP_CAPSULE:
+               {
+                    GridCell cell = in.get<GridCell>();
+                    const ActionResult result = api.try_pick_up_capsule(cell);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case DROP_CAPSULE:
+               {
+                    GridCell cell = in.get<GridCell>();
+                    const int power = in.get<int>();
+                    const ActionResult result = api.try_drop_capsule(cell,power);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case GET_BUILD_STATUS:
+               {
+                    const BuildStatus status = api.getBuildStatus();
+                    out.clear();
+                    out.put(status);
+                    break;
+               }
+          case GET_BUILD_TARGET:
+               {
+                    const GridCell* const target = api.getBuildTarget();
+                    out.clear();
+                    out.put<uint8_t>(target!=NULL);
+                    if(target)
+                         out.put(*target);
+                    break;
+               }
+          case GET_INVESTED_BUILD_POWER:
+               {
+                    const int power = api.getInvestedBuildPower();
+                    out.clear();
+                    out.put(power);
+                    break;
+               }
+          case SET_BUILD_TARGET:
+          case SET_BUILD_TARGET_WITH_MESSAGE:
+               {
+                    const BuildStatus status = in.get<BuildStatus>();
+                    const bool located = in.get<uint8_t>();
+                    GridCell location = located ? in.get<GridCell>() : GridCell();
+                    vector<uint8_t> message;
+                    if(code==SET_BUILD_TARGET_WITH_MESSAGE)
+                         in.getBytes(message);
+                    const ActionResult result = code==SET_BUILD_TARGET ? api.try_setBuildTarget(status,located ? &location : NULL) :
+                                                                         api.try_setBuildTarget(status,located ? &location : NULL,message);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case CHARGE:
+               {
+                    const int power = in.get<int>();
+                    GridCell ally = in.get<GridCell>();
+                    const ActionResult result = api.try_charge(power,ally);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case SEND_MESSAGE:
+               {
+                    const vector<uint8_t> message = in.getBytes();
+                    const int power = in.get<int>();
+                    const ActionResult result = api.try_sendMessage(message,power);
+                    out.clear();
+                    out.put(result);
+                    break;
+               }
+          case SCAN_ENEMY:
+               {
+                    const GridCell cell = in.get<GridCell>();
+                    Robot_Specs specs;
+                    Robot_Status status;
+                    const ActionResult result = api.try_scanEnemy(specs,status,cell);
+                    out.clear();
+                    out.put(result);
+                    if(result)
+                         out.put(specs).putStatus(status);
+                    break;
+               }
+          default:
+               fail("robot worker process made an unknown call");
+          }
+
+          //The action may have changed the world the robot sees
+          publishWorld(api,world);
+     }
+     catch(const MalformedMessage&)
+     {
+          fail("robot worker process sent a malformed message");
+     }
+     catch(...)
+     {
+          //The worker is stuck waiting for a reply it won't get
+          if(failure==NULL)
+               failure = "robot worker process was abandoned mid-call";
+          stop();
+          throw;
+     }
+     send(REPLY);
+}
+
+/**Stands in for a robot running in a worker process*/
+class RobotWorkers::WorkerRobot : public RobotV2
+{
+private:
+     Worker& worker;
+     const uint32_t id;
+
+public:
+     WorkerRobot(Worker& worker_, uint32_t id_) : worker(worker_), id(id_) { }
+
+     ~WorkerRobot()
+          {
+               std::lock_guard<std::recursive_mutex> guard(worker.lock);
+               worker.out.clear();
+               worker.out.put(id);
+               worker.post(DESTROY);
+          }
+
+     Robot_Specs createRobot(WorldAPI* api, int skill_points, MessageView message)
+          {
+               std::lock_guard<std::recursive_mutex> guard(worker.lock);
+               worker.check();
+               worker.out.clear();
+               worker.out.put(id).put(skill_points).putBytes(message.data(),message.size());
+               worker.send(CREATE);
+               try
+               {
+                    return worker.await(SPECS,api).get<Robot_Specs>();
+               }
+               catch(const MalformedMessage&)
+               {
+                    worker.fail("robot worker process sent a malformed message");
+               }
+          }
+
+     void act(WorldAPI& api, const Robot_Status& status, const RadioInbox& received_radio)
+          {
+               std::lock_guard<std::recursive_mutex> guard(worker.lock);
+               worker.check();
+               publishWorld(api,worker.world);
+               worker.out.clear();
+               worker.out.put(id).putStatus(status).put<uint32_t>(received_radio.size());
+               for(int i=0; i<received_radio.size(); i++)
+                    worker.out.putBytes(received_radio[i].data(),received_radio[i].size());
+               worker.send(ACT);
+               worker.await(DONE,&api);
+          }
+
+     bool saveState(vector<uint8_t>& state)
+          {
+               std::lock_guard<std::recursive_mutex> guard(worker.lock);
+               worker.check();
+               worker.out.clear();
+               worker.out.put(id);
+               worker.send(SAVE);
+               try
+               {
+                    Packet& reply = worker.await(STATE,NULL);
+                    const bool saved = reply.get<uint8_t>();
+                    const vector<uint8_t> bytes = reply.getBytes();
+                    state.insert(state.end(),bytes.begin(),bytes.end());
+                    return saved;
+               }
+               catch(const MalformedMessage&)
+               {
+                    worker.fail("robot worker process sent a malformed message");
+               }
+          }
+
+     void loadState(const vector<uint8_t>& state)
+          {
+               std::lock_guard<std::recursive_mutex> guard(worker.lock);
+               worker.check();
+               worker.out.clear();
+               worker.out.put(id).putBytes(state);
+               worker.send(LOAD);
+               worker.await(DONE,NULL);
+          }
+};
+
+RobotWorkers::RobotWorkers(RoboSim::RobotFactory factory, int length_, int width_, int timeout_ms_)
+     : robot_factory(factory), length(length_), width(width_), timeout_ms(timeout_ms_) { }
+
+//Out of line, where Worker is complete; its destructor kills the process
+RobotWorkers::~RobotWorkers() { }
+
+Robot* RobotWorkers::robotFor(int player)
+{
+     Worker* worker;
+     {
+          std::lock_guard<std::mutex> guard(workers_lock);
+          if(int(workers.size()) <= player)
+               workers.resize(player+1);
+          if(!workers[player])
+          {
+               std::unique_ptr<Worker> started(new Worker(player,length,width,timeout_ms));
+               started->start(robot_factory);
+               workers[player] = std::move(started);
+          }
+          worker = workers[player].get();
+     }
+
+     std::lock_guard<std::recursive_mutex> guard(worker->lock);
+     return new WorkerRobot(*worker,worker->next_id++);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "RoboSim.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * RobotWorkers: runs robots in worker processes, one per player, so that
+ * a robot that crashes, hangs or scribbles over memory takes down only
+ * its own team's worker, never the simulator.<br>
+ * The simulator is given a stand-in for each robot (see robotFor()); the
+ * real robot is made by the factory inside the worker.  The stand-in
+ * passes createRobot(), act(), saveState() and loadState() to the worker
+ * over a Unix socket, and the robot's WorldAPI actions come back the same
+ * way, to be carried out by the simulator as usual.  Before each act()
+ * and after each action, the world is published into memory shared with
+ * the worker (see SharedWorld), rewriting only the chunks that changed,
+ * so the robot's views and snapshots of the world are read locally
+ * rather than asked for (which also means WorldAPI decorators such as
+ * match_log::RecordingWorldAPI never see them).<br>
+ * A worker that dies, sends garbage or (with a timeout set) takes too
+ * long is killed, and the stand-in throws a RoboSimExecutionException
+ * blaming its player, as if the robot had broken the rules.  A
+ * RoboSimExecutionException robot code throws is passed back with its
+ * message, but always blaming the worker's own player; anything else comes back as a std::runtime_error with the same
+ * message.<br>
+ * Workers are forked (not exec'd) the first time a player's robot is
+ * needed, so they run the same robot code the simulator was built with.
+ * POSIX only.  A RobotWorkers must outlive the simulators using its
+ * robots, and serves only simulators whose world has the size it was
+ * given.
+ */
+class RobotWorkers
+{
+public:
+     /**
+      * @param factory makes robots, in the workers
+      * @param length extent in x of the world the robots will be in
+      * @param width extent in y of the world the robots will be in
+      * @param timeout_ms longest a worker may take over one call before
+      *                   it's killed, or 0 for no limit
+      */
+     RobotWorkers(RoboSim::RobotFactory factory, int length, int width, int timeout_ms = 0);
+
+     /**Kills the workers*/
+     ~RobotWorkers();
+
+     RobotWorkers(const RobotWorkers&) = delete;
+     RobotWorkers& operator=(const RobotWorkers&) = delete;
+
+     /**@return stand-in for a new robot of the given player, which the
+      *         caller owns; starts the player's worker if need be
+      * @throws RoboSimExecutionException if the worker can't be started*/
+     Robot* robotFor(int player);
+
+     /**@return factory making stand-ins, to give RoboSim*/
+     RoboSim::RobotFactory factory() { return [this](int player) { return robotFor(player); }; }
+
+private:
+     struct Worker;
+     class WorkerRobot;
+
+     RoboSim::RobotFactory robot_factory;
+     int length;
+     int width;
+     int timeout_ms;
+
+     //Indexed by player; null until the player's first robot is made
+     std::vector<std::unique_ptr<Worker> > workers;
+     std::mutex workers_lock;
+};
@@ -0,0 +1,225 @@
+#include "Scenario.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace robot_api;
+using std::vector;
+
+namespace
+{
+     //Cells of the scenario no robot has been placed on yet
+     class SpawnPicker
+     {
+     private:
+          Scenario& scenario;
+          vector<bool> taken;
+
+     public:
+          explicit SpawnPicker(Scenario& scenario_) : scenario(scenario_), taken(scenario_.terrain.size()) { }
+
+          bool available(int idx) const
+               {
+                    return !taken[idx] && (scenario.terrain[idx]==EMPTY || scenario.terrain[idx]==FORT);
+               }
+
+          void place(int player, int idx)
+               {
+                    taken[idx] = true;
+                    scenario.spawns[player-1].push_back(idx);
+               }
+
+          //Places count robots of player on random free cells
+          void scatter(Xoshiro256& random, int player, int count)
+               {
+                    vector<int> free_cells;
+                    for(int i=0; i<int(scenario.terrain.size()); i++)
+                         if(available(i))
+                              free_cells.push_back(i);
+                    if(int(free_cells.size()) < count)
+                         throw std::invalid_argument("scenario has no room for its robots");
+
+                    //Partial Fisher-Yates shuffle
+                    for(int i=0; i<count; i++)
+                    {
+                         std::swap(free_cells[i],free_cells[i+random.below(free_cells.size()-i)]);
+                         place(player,free_cells[i]);
+                    }
+               }
+     };
+
+     void carveMaze(Scenario& scenario, Xoshiro256& random)
+     {
+          const int length = scenario.length;
+          const int width = scenario.width;
+          for(GridObject& x : scenario.terrain)
+               x = WALL;
+
+          //Rooms are the cells with even coordinates; passages join
+          //neighboring rooms.  Depth-first search with an explicit stack.
+          vector<int> stack(1,0);
+          scenario.terrain[0] = EMPTY;
+          while(!stack.empty())
+          {
+               const int x = stack.back() / width;
+               const int y = stack.back() % width;
+
+               int options[4];
+               int count = 0;
+               static const int dx[4] = { 0, 0, -2, 2 };
+               static const int dy[4] = { -2, 2, 0, 0 };
+               for(int i=0; i<4; i++)
+               {
+                    const int nx = x+dx[i];
+                    const int ny = y+dy[i];
+                    if(nx>=0 && nx<length && ny>=0 && ny<width && scenario.terrain[nx*width+ny]==WALL)
+                         options[count++] = i;
+               }
+
+               if(!count)
+               {
+                    stack.pop_back();
+                    continue;
+               }
+
+               const int way = options[random.below(count)];
+               const int nx = x+dx[way];
+               const int ny = y+dy[way];
+               scenario.terrain[(x+dx[way]/2)*width+(y+dy[way]/2)] = EMPTY;
+               scenario.terrain[nx*width+ny] = EMPTY;
+               stack.push_back(nx*width+ny);
+          }
+     }
+
+     void scatterObstacles(Scenario& scenario, Xoshiro256& random, int density)
+     {
+          if(density < 0 || density > 100)
+               throw std::invalid_argument("obstacle density must be a percentage, from 0 to 100");
+
+          const long long obstacles = static_cast<long long>(scenario.terrain.size())*density/100;
+          vector<int> cells(scenario.terrain.size());
+          for(int i=0; i<int(cells.size()); i++)
+               cells[i] = i;
+          for(long long i=0; i<obstacles; i++)
+          {
+               std::swap(cells[i],cells[i+random.below(cells.size()-i)]);
+               scenario.terrain[cells[i]] = WALL;
+          }
+     }
+
+     void buildCorridors(Scenario& scenario)
+     {
+          //Every third row is a wall with a gap at alternating ends
+          const int length = scenario.length;
+          const int width = scenario.width;
+          for(int y=2; y<width; y+=3)
+          {
+               const int gap = (y/3)%2 ? 0 : length-1;
+               for(int x=0; x<length; x++)
+                    if(x!=gap)
+                         scenario.terrain[x*width+y] = WALL;
+          }
+     }
+
+     //Builds clusters of 3x3 forts and starts each team inside its own
+     void buildFortresses(Scenario& scenario, Xoshiro256& random, SpawnPicker& picker, int robots_per_player)
+     {
+          const int length = scenario.length;
+          const int width = scenario.width;
+          if(length < 3 || width < 3)
+               return;
+
+          for(int player=1; player<=scenario.players; player++)
+          {
+               int remaining = robots_per_player;
+               for(int attempt=0; remaining > 0 && attempt<100; attempt++)
+               {
+                    const int left = random.below(length-2);
+                    const int top = random.below(width-2);
+
+                    //Keep a cell of open ground around each cluster
+                    bool clear = true;
+                    for(int x=std::max(left-1,0); x<=std::min(left+3,length-1) && clear; x++)
+                         for(int y=std::max(top-1,0); y<=std::min(top+3,width-1) && clear; y++)
+                              clear = scenario.terrain[x*width+y]==EMPTY;
+                    if(!clear)
+                         continue;
+
+                    const Direction orientation = static_cast<Direction>(random.below(4));
+                    for(int x=left; x<left+3; x++)
+                         for(int y=top; y<top+3; y++)
+                         {
+                              scenario.terrain[x*width+y] = FORT;
+                              scenario.fort_orientation[x*width+y] = orientation;
+                              if(remaining > 0)
+                              {
+                                   picker.place(player,x*width+y);
+                                   remaining--;
+                              }
+                         }
+               }
+
+               //Out of room for clusters: the rest start in the open
+               if(remaining > 0)
+                    picker.scatter(random,player,remaining);
+          }
+     }
+}
+
+Scenario::Scenario(int length_, int width_, int players_) :
+     length(length_), width(width_), players(players_),
+     terrain(static_cast<std::size_t>(length_)*width_,EMPTY),
+     fort_orientation(terrain.size(),UP),
+     spawns(players_)
+{
+}
+
+Scenario Scenario::generate(Layout layout, int length, int width, int players, int robots_per_player, std::uint64_t seed, int density)
+{
+     Scenario to_return(length,width,players);
+     Xoshiro256 random(seed);
+     SpawnPicker picker(to_return);
+
+     switch(layout)
+     {
+     case MAZE:
+          carveMaze(to_return,random);
+          break;
+     case DENSE:
+          scatterObstacles(to_return,random,density);
+          break;
+     case CORRIDORS:
+          buildCorridors(to_return);
+          break;
+     case FORTRESSES:
+          buildFortresses(to_return,random,picker,robots_per_player);
+          return to_return;
+     }
+
+     for(int player=1; player<=players; player++)
+          picker.scatter(random,player,robots_per_player);
+     return to_return;
+}
+
+namespace
+{
+     const char* const LAYOUT_NAMES[] = { "maze", "dense", "corridors", "forts" };
+}
+
+const char* Scenario::layoutName(Layout layout)
+{
+     return LAYOUT_NAMES[layout];
+}
+
+bool Scenario::layoutFromName(const std::string& name, Layout& layout)
+{
+     for(int i=0; i<int(sizeof(LAYOUT_NAMES)/sizeof(LAYOUT_NAMES[0])); i++)
+          if(name==LAYOUT_NAMES[i])
+          {
+               layout = static_cast<Layout>(i);
+               return true;
+          }
+     return false;
+}
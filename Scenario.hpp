@@ -0,0 +1,80 @@
+#pragma once
+
+#include "robot_api.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Scenario: a hand-made or generated starting position for the simulator,
+ * for workloads the uniform random placement of the regular RoboSim
+ * constructor never produces.<br>
+ * Terrain is indexed like WorldGrid (the cell at [x][y] is x*width+y).
+ * Only EMPTY, WALL and FORT terrain is allowed; robots may start on EMPTY
+ * or FORT cells.
+ */
+struct Scenario
+{
+     /**Generated layouts*/
+     enum Layout
+     {
+          /**Perfect maze: one-cell passages, every pair of cells joined
+           * by exactly one path*/
+          MAZE,
+
+          /**Uniform random obstacles covering a large share of the map*/
+          DENSE,
+
+          /**Serpentine corridors spanning the length of the map, so
+           * crossing it means walking all of them*/
+          CORRIDORS,
+
+          /**Each team starts in clusters of forts*/
+          FORTRESSES
+     };
+
+     /**Share of the map DENSE covers with obstacles by default (percent)*/
+     static const int DEFAULT_DENSITY = 45;
+
+     int length;
+     int width;
+     int players;
+
+     /**Contents of each cell before robots are placed*/
+     std::vector<robot_api::GridObject> terrain;
+
+     /**Orientation of each cell's fort (ignored where there's none)*/
+     std::vector<robot_api::Direction> fort_orientation;
+
+     /**Starting cells of each team's robots; spawns[p-1] belongs to
+      * player p, and robots take their turns in this order*/
+     std::vector<std::vector<int> > spawns;
+
+     /**Creates an empty scenario of the given size, with no robots*/
+     Scenario(int length_, int width_, int players_);
+
+     /**
+      * Generates a scenario.  The same arguments always generate the same
+      * scenario.
+      * @param layout kind of map
+      * @param length length of arena
+      * @param width width of arena
+      * @param players number of teams
+      * @param robots_per_player robots each team starts with
+      * @param seed seed for the generator
+      * @param density percentage of the map covered with obstacles
+      *                (DENSE only)
+      * @throws std::invalid_argument if the robots don't fit, or density
+      *         is outside [0,100]
+      */
+     static Scenario generate(Layout layout, int length, int width, int players, int robots_per_player, std::uint64_t seed, int density = DEFAULT_DENSITY);
+
+     /**@return name of a layout, as used on command lines*/
+     static const char* layoutName(Layout layout);
+
+     /**@param name layout name returned by layoutName()
+      * @param layout set to the named layout
+      * @return whether the name was recognized*/
+     static bool layoutFromName(const std::string& name, Layout& layout);
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "robot_api.hpp"
+#include "WorldGrid.hpp"
+
+#include <cstddef>
+
+namespace robot_api
+{
+     /**
+      * SharedWorld: the world as one player sees it, in memory shared with
+      * a robot worker process (see RobotWorkers).<br>
+      * Cells are packed as in WorldGrid, with every robot shown as ALLY or
+      * ENEMY; the cell of the robot acting is recorded on the side and
+      * shown as SELF.  The memory is mapped before the worker is forked,
+      * so the worker reads the cells where the simulator wrote them.  The
+      * simulator rewrites only the chunks of the world that changed since
+      * it last published it (see RoboSim::publishWorld()).
+      */
+     class SharedWorld
+     {
+     public:
+          /**Part of the world: columns x_left...x_left+length-1, rows
+           * y_up...y_up+width-1*/
+          struct Window
+          {
+               int x_left;
+               int y_up;
+               int length;
+               int width;
+          };
+
+     private:
+          //Start of the shared memory; the cells follow it
+          struct Header
+          {
+               //Bumped whenever the cells change
+               unsigned long long generation;
+               int self_index;
+               int length;
+               int width;
+
+               //What the robot acting can see around itself
+               Window neighborhood;
+          };
+
+          Header* header;
+          WorldGrid::PackedCell* cells;
+          std::size_t bytes;
+
+          //What the cells were last published from (publishing side only)
+          unsigned long long source;
+          unsigned long long source_version;
+          int source_player;
+
+     public:
+          /**Maps shared memory for a world of the given size
+           * @throws RoboSimExecutionException if it can't be mapped*/
+          SharedWorld(int length, int width);
+          ~SharedWorld();
+
+          SharedWorld(const SharedWorld&) = delete;
+          SharedWorld& operator=(const SharedWorld&) = delete;
+
+          int length() const { return header->length; }
+          int width() const { return header->width; }
+          int size() const { return header->length*header->width; }
+
+          /**@return counter that changes whenever the cells change (not when
+           *         only the SELF cell moves)*/
+          unsigned long long generation() const { return header->generation; }
+
+          /**@return index of the cell shown as SELF, or -1*/
+          int selfIndex() const { return header->self_index; }
+
+          /**@return window getVisibleNeighborhoodView() shows the robot
+           *         acting*/
+          Window neighborhood() const { return header->neighborhood; }
+
+          GridObject contents(int idx) const { return idx==header->self_index ? SELF : cells[idx].contents(); }
+          Direction fortOrientation(int idx) const { return cells[idx].fortOrientation(); }
+          int capsulePower(int idx) const { return cells[idx].capsule_power; }
+
+          /**@return sanitized copy of cell idx, with world coordinates*/
+          GridCell cell(int idx) const
+               {
+                    GridCell to_return;
+                    to_return.x_coord = idx / header->width;
+                    to_return.y_coord = idx % header->width;
+                    to_return.contents = contents(idx);
+                    to_return.fort_orientation = fortOrientation(idx);
+                    to_return.capsule_power = capsulePower(idx);
+                    to_return.has_private_members = false;
+                    to_return.occupant_data = NULL;
+                    to_return.wallforthealth = 0;
+                    return to_return;
+               }
+
+          /**
+           * @param world identifies the world being published (0 for none)
+           * @param player player it's seen by
+           * @return whether the cells were last published from that world
+           *         for that player, so only changed chunks need rewriting
+           */
+          bool publishedFrom(unsigned long long world, int player) const { return world!=0 && source==world && source_player==player; }
+
+          /**@return version of the world the cells were last published at*/
+          unsigned long long publishedVersion() const { return source_version; }
+
+          /**Overwrites cell idx; its contents must not be SELF*/
+          void store(int idx, const WorldGrid::PackedCell& cell) { cells[idx] = cell; }
+
+          /**Records what the cells now hold, after storing them*/
+          void published(unsigned long long world, unsigned long long version, int player)
+               {
+                    source = world;
+                    source_version = version;
+                    source_player = player;
+                    header->generation++;
+               }
+
+          /**Shows cell idx (or none, if -1) as SELF, the robot in it seeing
+           * the given window around itself*/
+          void setSelf(int idx, const Window& neighborhood)
+               {
+                    header->self_index = idx;
+                    header->neighborhood = neighborhood;
+               }
+     };
+}
@@ -1,70 +1,216 @@
 #include "SimulatorGUI.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <thread>
+#include <utility>
 
-/*"sleep" is defined in POSIX header <unistd.h> but as usual
- * Windows is a special snowflake and does not include the
- * POSIX standard headers everyone else supports.
+/*Whether we're writing to a terminal is found out with POSIX isatty(),
+ * but as usual Windows is a special snowflake: it calls it _isatty(),
+ * and its console only understands ANSI escape codes once asked to.
 */
 
 #ifdef _WIN32
 
 //Windows
+#include <io.h>
 #include <windows.h>
-void sleep(unsigned int seconds) { Sleep(seconds*1000); }
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+static bool ansiTerminal()
+{
+     HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+     DWORD mode;
+     return _isatty(_fileno(stdout)) && GetConsoleMode(console,&mode) && SetConsoleMode(console,mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+}
 
 #else
 
 //All other OSes
 #include <unistd.h>
+static bool ansiTerminal() { return isatty(STDOUT_FILENO); }
 
 #endif
 
+using std::atof;
 using std::atoi;
 using std::cout;
 using std::endl;
-using std::srand;
+using std::strtoull;
 using std::time;
 
 using robot_api::RoboSimExecutionException;
 
-int SimulatorGUI::do_timestep()
+void TerminalRenderer::moveTo(int x, int y)
+{
+     //Line 1 is the title; the grid's rows follow
+     char code[32];
+     const int length = std::snprintf(code,sizeof(code),"\x1b[%d;%dH",x+2,y+1);
+     out.append(code,length);
+}
+
+void TerminalRenderer::draw(const Frame& frame)
 {
-     const auto& world = current_sim.getWorldGrid();
-     for(const auto& row : world)
+     out.clear();
+     if(!ansi)
      {
-          for(const auto& cell : row)
-               switch(cell.contents)
+          for(int x=0; x<frame.length; x++)
+          {
+               out.append(frame.cells.data()+x*frame.width,frame.width);
+               out += '\n';
+          }
+          out += '\n';
+     }
+     else
+     {
+          //Everything is drawn the first time, or if the world changed size
+          const bool full = shown.cells.empty() || shown.length!=frame.length || shown.width!=frame.width;
+          if(full)
+               out += "\x1b[H\x1b[2J";
+          out += "\x1b[1;1H";
+          out += title;
+          out += "  Turn: ";
+          out += std::to_string(frame.turn);
+          out += "\x1b[K";
+
+          //Rewriting a few unchanged cells is cheaper than moving the
+          //cursor past them
+          const int MAX_GAP = 8;
+          for(int x=0; x<frame.length; x++)
+          {
+               const char* now = &frame.cells[x*frame.width];
+               const char* was = full ? NULL : &shown.cells[x*frame.width];
+               int y = 0;
+               while(y < frame.width)
                {
-               case robot_api::BLOCKED: cout << 'X';
-                         break;
-               case robot_api::SELF: cout << current_sim.getOccupantPlayer(cell);
-                    break;
-               case robot_api::WALL: cout << '+';
-                    break;
-               case robot_api::FORT:
-                    switch(cell.fort_orientation)
+                    if(was && now[y]==was[y])
                     {
-                    case robot_api::UP: cout << '^';
-                         break;
-                    case robot_api::DOWN: cout << 'v';
-                         break;
-                    case robot_api::LEFT: cout << '<';
-                         break;
-                    case robot_api::RIGHT: cout << '>';
-                         break;
+                         y++;
+                         continue;
                     }
+
+                    //Run of changes, up to the last one before a long gap
+                    int last = y;
+                    for(int next=y+1; next<frame.width && next-last<=MAX_GAP; next++)
+                         if(!was || now[next]!=was[next])
+                              last = next;
+                    moveTo(x,y);
+                    out.append(now+y,last-y+1);
+                    y = last+1;
+               }
+          }
+          moveTo(frame.length,0);
+          shown = frame;
+     }
+     cout.write(out.data(),out.size());
+     cout.flush();
+}
+
+void SimulatorGUI::capture(Frame& out) const
+{
+     const WorldGrid& world = current_sim.getPackedWorldGrid();
+     out.length = world.length();
+     out.width = world.width();
+     out.turn = turn;
+     out.cells.resize(world.size());
+     for(int i=0; i<world.size(); i++)
+     {
+          char glyph = '?';
+          switch(world.contents(i))
+          {
+          case robot_api::BLOCKED: glyph = 'X';
+               break;
+          case robot_api::SELF:
+               {
+                    //Players past 9 get letters, so every cell is one character
+                    const int player = current_sim.getOccupantPlayer(i);
+                    glyph = player < 10 ? '0'+player : (player < 36 ? 'A'+player-10 : '#');
+               }
+               break;
+          case robot_api::WALL: glyph = '+';
+               break;
+          case robot_api::FORT:
+               switch(world.fortOrientation(i))
+               {
+               case robot_api::UP: glyph = '^';
+                    break;
+               case robot_api::DOWN: glyph = 'v';
                     break;
-               case robot_api::CAPSULE: cout << 'o';
+               case robot_api::LEFT: glyph = '<';
                     break;
-               case robot_api::EMPTY: cout << '*';
+               case robot_api::RIGHT: glyph = '>';
                     break;
                }
-          cout << endl;
+               break;
+          case robot_api::CAPSULE: glyph = 'o';
+               break;
+          case robot_api::EMPTY: glyph = '*';
+               break;
+          }
+          out.cells[i] = glyph;
      }
-     cout << endl;
+}
 
+void SimulatorGUI::publish()
+{
+     capture(frame);
+     {
+          std::lock_guard<std::mutex> guard(exchange);
+          std::swap(frame,published);
+          fresh = true;
+     }
+     frame_ready.notify_one();
+}
+
+void SimulatorGUI::render()
+{
+     typedef std::chrono::steady_clock Clock;
+     const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frame_time));
+     Clock::time_point next_frame = Clock::now();
+     std::unique_lock<std::mutex> lock(exchange);
+     while(true)
+     {
+          frame_ready.wait(lock,[this] { return fresh || finished; });
+          if(!fresh)
+               break;
+          std::swap(published,drawn);
+          fresh = false;
+          lock.unlock();
+
+          {
+               std::lock_guard<std::mutex> guard(console);
+               renderer.draw(drawn);
+          }
+
+          //Frames are frame_time apart, however long each takes to draw;
+          //a late frame isn't made up for by rushing the next.  The end
+          //of the match cuts the wait short, so the last frame isn't late.
+          next_frame += interval;
+          const Clock::time_point now = Clock::now();
+          if(next_frame < now)
+               next_frame = now;
+          lock.lock();
+          frame_ready.wait_until(lock,next_frame,[this] { return finished; });
+     }
+}
+
+void SimulatorGUI::stopRendering()
+{
+     {
+          std::lock_guard<std::mutex> guard(exchange);
+          finished = true;
+     }
+     frame_ready.notify_one();
+     if(render_thread.joinable())
+          render_thread.join();
+}
+
+int SimulatorGUI::do_timestep()
+{
      int ret;
      try
      {
@@ -72,16 +218,39 @@ int SimulatorGUI::do_timestep()
      }
      catch(RoboSimExecutionException e)
      {
+          std::lock_guard<std::mutex> guard(console);
           cout << "An error occurred during execution: " << e.msg << endl;
           ret=-1;
      }
+     turn++;
+     publish();
 
      return ret;
 }
 
+int SimulatorGUI::run()
+{
+     publish();
+     render_thread = std::thread(&SimulatorGUI::render,this);
+     int winner;
+     try
+     {
+          while((winner=do_timestep())==-1);
+     }
+     catch(...)
+     {
+          //Whatever's gone wrong gets reported after the last frame
+          stopRendering();
+          throw;
+     }
+     stopRendering();
+     return winner;
+}
+
 int main(int argc, const char** argv)
 {
-     int x=20, y=20, skill_points=20, bots_per_player=5, obstacles=30, naptime=3;
+     int x=20, y=20, skill_points=20, bots_per_player=5, obstacles=30;
+     double naptime=3;
      if(argc>=6)
      {
           x=atoi(argv[1]);
@@ -90,26 +259,33 @@ int main(int argc, const char** argv)
           bots_per_player=atoi(argv[4]);
           obstacles=atoi(argv[5]);
      }
-     if(argc==7)
-          naptime=atoi(argv[6]);
+     if(argc>=7)
+          naptime=atof(argv[6]);
      if(argc==2)
-          naptime=atoi(argv[1]);
+          naptime=atof(argv[1]);
 
-     //RNG should be seeded before simulation
-     //srand(time(NULL));
+     //Each match is seeded; print the seed so the match can be replayed
+     std::uint64_t seed = time(NULL);
+     if(argc==8)
+          seed=strtoull(argv[7],NULL,10);
+     cout << "Seed: " << seed << endl;
 
-     SimulatorGUI gui{x,y,skill_points,bots_per_player,obstacles};
+     //Frames are drawn at most every naptime seconds (fractions allowed);
+     //the match itself runs as fast as it can
+     SimulatorGUI gui{x,y,skill_points,bots_per_player,obstacles,seed,ansiTerminal(),naptime};
      int winner = -1;
      try
      {
-          while((winner=gui.do_timestep())==-1)
-               sleep(naptime);
+          winner = gui.run();
      }
      catch(RoboSimExecutionException e)
      {
           cout << "Failed with Robot Exception: " << e.msg << endl;
      }
 
-     cout << "Winner: " << winner << endl;
+     if(winner==RoboSim::NO_SURVIVORS)
+          cout << "No survivors" << endl;
+     else
+          cout << "Winner: " << winner << endl;
      return 0;
 }
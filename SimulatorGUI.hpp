@@ -2,9 +2,66 @@
 
 #include "RoboSim.hpp"
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**One picture of the world: a character per cell, [x][y] at
+ * x*width+y, with rows of constant x drawn as lines of text*/
+struct Frame
+{
+     int length = 0;
+     int width = 0;
+
+     /**time step the picture was taken before*/
+     int turn = 0;
+
+     std::vector<char> cells;
+};
+
+/**
+ * TerminalRenderer: draws Frames.<br>
+ * On a terminal, it keeps the last frame it drew and rewrites only the
+ * cells that changed since, moving the cursor to each run of them with
+ * ANSI escape codes, under a title line.  Anywhere else (a pipe or a
+ * file), it prints every frame in full, one row per line, followed by a
+ * blank line.  Either way each frame goes out in a single write.
+ */
+class TerminalRenderer
+{
+private:
+     bool ansi;
+     std::string title;
+
+     //What's on the screen (empty until the first frame is drawn)
+     Frame shown;
+
+     //Output of the frame being drawn (kept so its storage is reused)
+     std::string out;
+
+     /**Appends an escape code moving the cursor to a cell of the
+      * grid*/
+     void moveTo(int x, int y);
+
+public:
+     /**
+      * @param ansi_ whether to draw with ANSI escape codes
+      * @param title_ shown above the grid (ANSI only)
+      */
+     TerminalRenderer(bool ansi_, const std::string& title_) : ansi(ansi_), title(title_) { }
+
+     /**Draws a frame, leaving the cursor on the line below it*/
+     void draw(const Frame& frame);
+};
+
 /**
  * SimulatorGUI: Main GUI class.<br><br>
- * ASCII art for now.
+ * ASCII art for now.  The simulation runs flat out on the calling thread,
+ * publishing a picture of the world after each time step; a render thread
+ * draws the latest one at most once a frame time, and pictures published
+ * in between are never drawn.
  */
 class SimulatorGUI
 {
@@ -18,9 +75,55 @@ private:
 
      //Program State
      RoboSim current_sim;
-     
+     int turn;
+     double frame_time;
+
+     //Frames are double buffered: the simulation captures into frame,
+     //then swaps it with published; the render thread swaps published
+     //with drawn and draws that.  Neither waits for the other's work.
+     Frame frame;
+     Frame published;
+     Frame drawn;
+     bool fresh;
+     bool finished;
+     std::mutex exchange;
+     std::condition_variable frame_ready;
+
+     TerminalRenderer renderer;
+     std::thread render_thread;
+
+     //Held while writing to cout, so messages and frames don't interleave
+     std::mutex console;
+
+     /**Takes a picture of the world*/
+     void capture(Frame& out) const;
+
+     /**Hands a picture of the world to the render thread*/
+     void publish();
+
+     /**Render thread: draws the latest published frame until finished*/
+     void render();
+
+     /**Draws the last frame and waits for the render thread to exit*/
+     void stopRendering();
+
 public:
-     SimulatorGUI(int gridX, int gridY, int skillz, int bots_per_player, int obstacles_) : length(gridX),width(gridY),skill_points(skillz),initial_robots_per_combatant(bots_per_player),obstacles(obstacles_),current_sim(initial_robots_per_combatant,skill_points,length,width,obstacles) { }
-	
+     /**
+      * @param ansi whether to draw with ANSI escape codes
+      * @param frame_time_ least time between drawn frames, in seconds
+      */
+     SimulatorGUI(int gridX, int gridY, int skillz, int bots_per_player, int obstacles_, std::uint64_t seed, bool ansi = false, double frame_time_ = 3) : length(gridX),width(gridY),skill_points(skillz),initial_robots_per_combatant(bots_per_player),obstacles(obstacles_),current_sim(initial_robots_per_combatant,skill_points,length,width,obstacles,seed),turn(0),frame_time(frame_time_),fresh(false),finished(false),renderer(ansi,"Seed: "+std::to_string(seed)) { }
+
+     ~SimulatorGUI() { stopRendering(); }
+
+     SimulatorGUI(const SimulatorGUI&) = delete;
+     SimulatorGUI& operator=(const SimulatorGUI&) = delete;
+
+     /**Executes one time step and publishes the world after it
+      * @return winner, or -1 if the match goes on*/
      int do_timestep();
+
+     /**Plays the match to the end while the render thread draws it
+      * @return winner*/
+     int run();
 };
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+
+namespace robot_api
+{
+     using std::vector;
+
+     /**
+      * TeamIndex: where each team's robots are, bucketed by area, for
+      * nearest-ally queries that don't search the whole world.<br>
+      * The world is cut into square buckets of BUCKET_SIZE cells on a
+      * side; each team has a list of its robots' cells per bucket.  A
+      * query looks at rings of buckets around the origin, nearest first,
+      * and stops once no unexamined bucket can hold anything closer.<br>
+      * Distance is as the crow flies in steps (|dx|+|dy|).  Among allies
+      * at the same distance, the one a breadth-first search from the
+      * origin (expanding left, right, up, down) would reach first wins, so
+      * answers match a full search of the world exactly.
+      */
+     class TeamIndex
+     {
+     public:
+          static const int BUCKET_BITS = 4;
+          static const int BUCKET_SIZE = 1 << BUCKET_BITS;
+
+     private:
+          int width;
+          int buckets_x;
+          int buckets_y;
+
+          //teams[player][bucket] lists cells of the player's robots
+          vector<vector<vector<int> > > teams;
+
+          int bucketOf(int idx) const { return ((idx / width) >> BUCKET_BITS)*buckets_y + ((idx % width) >> BUCKET_BITS); }
+
+          //Best candidate found so far by nearest()
+          struct Search
+          {
+               int origin;
+               int width;
+               int ox;
+               int oy;
+               int best;
+               int best_distance;
+               int best_dx;
+               int best_dy;
+
+               Search(int origin_, int width_) : origin(origin_), width(width_), ox(origin_ / width_), oy(origin_ % width_),
+                                                 best(-1), best_distance(INT_MAX), best_dx(0), best_dy(0) { }
+
+               //Orders allies at the same distance as breadth-first search
+               //reaches them: left of the origin, then right, then straight
+               //up or down; the farther sideways the earlier; then top to
+               //bottom
+               bool reachedFirst(int dx, int dy) const
+                    {
+                         const int side = dx<0 ? 0 : (dx>0 ? 1 : 2);
+                         const int best_side = best_dx<0 ? 0 : (best_dx>0 ? 1 : 2);
+                         if(side!=best_side)
+                              return side < best_side;
+                         if(std::abs(dx)!=std::abs(best_dx))
+                              return std::abs(dx) > std::abs(best_dx);
+                         return dy < best_dy;
+                    }
+
+               void scan(const vector<int>& bucket)
+                    {
+                         for(int idx : bucket)
+                         {
+                              if(idx==origin)
+                                   continue;
+                              const int dx = idx/width - ox;
+                              const int dy = idx%width - oy;
+                              const int distance = std::abs(dx)+std::abs(dy);
+                              if(distance < best_distance || (distance==best_distance && reachedFirst(dx,dy)))
+                              {
+                                   best = idx;
+                                   best_distance = distance;
+                                   best_dx = dx;
+                                   best_dy = dy;
+                              }
+                         }
+                    }
+          };
+
+     public:
+          TeamIndex() : width(0), buckets_x(0), buckets_y(0) { }
+
+          /**@return whether the index has been built since the last clear()*/
+          bool built() const { return width!=0; }
+
+          /**Empties the index; it does nothing until it's built again*/
+          void clear()
+               {
+                    width = buckets_x = buckets_y = 0;
+                    teams.clear();
+               }
+
+          /**Readies an empty index for a world of the given size*/
+          void build(int length, int width_, int players)
+               {
+                    width = width_;
+                    buckets_x = (length + BUCKET_SIZE-1) >> BUCKET_BITS;
+                    buckets_y = (width_ + BUCKET_SIZE-1) >> BUCKET_BITS;
+                    teams.assign(players+1,vector<vector<int> >(buckets_x*buckets_y));
+               }
+
+          void add(int player, int idx)
+               {
+                    if(built())
+                         teams[player][bucketOf(idx)].push_back(idx);
+               }
+
+          void remove(int player, int idx)
+               {
+                    if(!built())
+                         return;
+                    vector<int>& bucket = teams[player][bucketOf(idx)];
+                    for(int i=0; i<int(bucket.size()); i++)
+                         if(bucket[i]==idx)
+                         {
+                              bucket[i] = bucket.back();
+                              bucket.pop_back();
+                              return;
+                         }
+               }
+
+          void move(int player, int from, int to)
+               {
+                    if(!built())
+                         return;
+                    if(bucketOf(from)==bucketOf(to))
+                    {
+                         for(int& x : teams[player][bucketOf(from)])
+                              if(x==from)
+                                   x = to;
+                    }
+                    else
+                    {
+                         remove(player,from);
+                         add(player,to);
+                    }
+               }
+
+          /**
+           * Finds the nearest ally of the robot in a cell.  The index must
+           * be built.
+           * @param player robot's team
+           * @param origin index of robot's cell
+           * @return index of nearest ally's cell, or -1 if it has none
+           */
+          int nearest(int player, int origin) const
+               {
+                    Search search(origin,width);
+                    const vector<vector<int> >& team = teams[player];
+                    const int bx0 = search.ox >> BUCKET_BITS;
+                    const int by0 = search.oy >> BUCKET_BITS;
+                    const int rings = std::max(buckets_x,buckets_y);
+                    for(int r=0; r<rings; r++)
+                    {
+                         //Cells in ring r are at least this far away
+                         if(r > 0 && (r-1)*BUCKET_SIZE+1 > search.best_distance)
+                              break;
+
+                         for(int bx=std::max(bx0-r,0); bx<=std::min(bx0+r,buckets_x-1); bx++)
+                              if(std::abs(bx-bx0)==r)
+                              {
+                                   for(int by=std::max(by0-r,0); by<=std::min(by0+r,buckets_y-1); by++)
+                                        search.scan(team[bx*buckets_y+by]);
+                              }
+                              else
+                              {
+                                   if(by0-r >= 0)
+                                        search.scan(team[bx*buckets_y+by0-r]);
+                                   if(by0+r < buckets_y)
+                                        search.scan(team[bx*buckets_y+by0+r]);
+                              }
+                    }
+                    return search.best;
+               }
+     };
+}
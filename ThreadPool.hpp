@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool: fixed set of worker threads with work stealing.<br>
+ * Each worker has its own task queue.  A worker takes the newest task
+ * from its own queue, and when that runs dry steals the oldest task from
+ * another worker's queue, so long tasks don't hold up a queue full of
+ * short ones.  Tasks must not throw.
+ */
+class ThreadPool
+{
+private:
+     struct WorkQueue
+     {
+          std::mutex lock;
+          std::deque<std::function<void()> > tasks;
+     };
+
+     std::vector<std::unique_ptr<WorkQueue> > queues;
+     std::vector<std::thread> workers;
+
+     //Tasks submitted but not yet taken, and not yet finished
+     std::atomic<int> queued;
+     std::atomic<int> pending;
+
+     //Round-robin position for submit()
+     std::atomic<unsigned> next_queue;
+
+     //Idle workers and wait() sleep on these
+     std::mutex state_lock;
+     std::condition_variable work_available;
+     std::condition_variable all_done;
+     bool stopping;
+
+     bool takeFrom(WorkQueue& queue, bool newest, std::function<void()>& task)
+          {
+               std::lock_guard<std::mutex> guard(queue.lock);
+               if(queue.tasks.empty())
+                    return false;
+               if(newest)
+               {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+               }
+               else
+               {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+               }
+               queued--;
+               return true;
+          }
+
+     bool take(int self, std::function<void()>& task)
+          {
+               if(takeFrom(*queues[self],true,task))
+                    return true;
+               for(int i=1; i<int(queues.size()); i++)
+                    if(takeFrom(*queues[(self+i)%queues.size()],false,task))
+                         return true;
+               return false;
+          }
+
+     void run(int self)
+          {
+               std::function<void()> task;
+               while(true)
+               {
+                    if(take(self,task))
+                    {
+                         task();
+                         task = nullptr;
+                         if(--pending==0)
+                         {
+                              std::lock_guard<std::mutex> guard(state_lock);
+                              all_done.notify_all();
+                         }
+                         continue;
+                    }
+
+                    std::unique_lock<std::mutex> guard(state_lock);
+                    work_available.wait(guard,[this] { return stopping || queued > 0; });
+                    if(stopping && queued==0)
+                         return;
+               }
+          }
+
+public:
+     /**@param threads number of worker threads (0 means one per core)*/
+     explicit ThreadPool(int threads = 0) : queued(0), pending(0), next_queue(0), stopping(false)
+          {
+               if(threads <= 0)
+                    threads = std::thread::hardware_concurrency();
+               if(threads <= 0)
+                    threads = 1;
+
+               for(int i=0; i<threads; i++)
+                    queues.emplace_back(new WorkQueue);
+               for(int i=0; i<threads; i++)
+                    workers.emplace_back(&ThreadPool::run,this,i);
+          }
+
+     ThreadPool(const ThreadPool&) = delete;
+     ThreadPool& operator=(const ThreadPool&) = delete;
+
+     /**Finishes all submitted tasks, then stops the workers*/
+     ~ThreadPool()
+          {
+               wait();
+               {
+                    std::lock_guard<std::mutex> guard(state_lock);
+                    stopping = true;
+               }
+               work_available.notify_all();
+               for(std::thread& x : workers)
+                    x.join();
+          }
+
+     /**@return number of worker threads*/
+     int size() const { return workers.size(); }
+
+     /**Queues a task to be run on some worker*/
+     void submit(std::function<void()> task)
+          {
+               pending++;
+               WorkQueue& queue = *queues[next_queue++ % queues.size()];
+               {
+                    std::lock_guard<std::mutex> guard(queue.lock);
+                    queue.tasks.push_back(std::move(task));
+               }
+
+               //Publish under state_lock so a worker about to sleep can't miss it
+               {
+                    std::lock_guard<std::mutex> guard(state_lock);
+                    queued++;
+               }
+               work_available.notify_one();
+          }
+
+     /**Blocks until every task submitted so far has finished*/
+     void wait()
+          {
+               std::unique_lock<std::mutex> guard(state_lock);
+               all_done.wait(guard,[this] { return pending==0; });
+          }
+};
@@ -0,0 +1,472 @@
+#include "MatchLog.hpp"
+#include "RoboSim.hpp"
+#include "RobotPlugins.hpp"
+#include "RobotWorkers.hpp"
+#include "ThreadPool.hpp"
+#include "player_config.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Tournament: headless tournament runner.<br>
+ * Plays the player types compiled into player_config.hpp against each
+ * other, one RoboSim per match, with matches spread over every core.
+ * With --plugins or --plugin-roster, the player types are robot plugins
+ * loaded at run time instead (see RobotPlugins), in the order given, so
+ * a new matchup needs no rebuild; player types from --plugins come
+ * before those from the roster file.
+ * Prints win rates and Elo ratings when done, and optionally writes the
+ * result of every match to a CSV file.  With --record, every match is
+ * also recorded to DIR/match_<number>.log for the replay tool.  With
+ * --isolate, each team's robots run in a worker process of their own (see
+ * RobotWorkers), so a team whose robot crashes, or takes more than MS
+ * milliseconds over one call, forfeits the match instead of taking the
+ * tournament down (0 for no time limit).
+ *
+ * Usage: tournament [--roster 1,2,...] [--format roundrobin|swiss]
+ *                   [--games N] [--rounds N] [--threads N] [--seed N]
+ *                   [--max-turns N] [--length N] [--width N] [--skill N]
+ *                   [--bots N] [--obstacles N] [--csv FILE]
+ *                   [--record DIR] [--isolate MS]
+ *                   [--plugins A.so,B.so,...] [--plugin-roster FILE]
+ */
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::ostream;
+using std::string;
+using std::vector;
+
+using robot_api::RoboSimExecutionException;
+
+namespace
+{
+     struct Settings
+     {
+          vector<int> roster;
+          bool swiss = false;
+          int games = 10;
+          int rounds = 0;
+          int threads = 0;
+          std::uint64_t seed = 1;
+          int max_turns = 1000;
+          int length = 20;
+          int width = 20;
+          int skill_points = 20;
+          int bots_per_player = 5;
+          int obstacles = 30;
+          string csv;
+          string record;
+          int isolate = -1;
+          vector<string> plugins;
+          string plugin_roster;
+
+          //Player types: 1 to players, made by construct
+          int players = RBP_NUM_PLAYERS;
+          std::function<Robot*(int)> construct = rbp_construct_robot;
+     };
+
+     /**One game between two player types.  side[0] plays as player 1.*/
+     struct Match
+     {
+          int id;
+          int round;
+          int side[2];
+          std::uint64_t seed;
+
+          //Filled in when played
+          int winner; //index into side, -1 for a draw
+          int turns;
+          string note;
+     };
+
+     struct Standing
+     {
+          int player;
+          int games = 0;
+          int wins = 0;
+          int losses = 0;
+          int draws = 0;
+          double score = 0;
+          double elo = 1500;
+          vector<int> opponents;
+     };
+
+     const double ELO_K = 16;
+
+     /**Mixes a match number into the tournament seed so neighbouring
+      * matches don't get correlated random numbers*/
+     std::uint64_t matchSeed(std::uint64_t seed, int id)
+     {
+          return SplitMix64(seed + 0x9E3779B97F4A7C15ULL*id).next();
+     }
+
+     void playMatch(const Settings& settings, Match& match)
+     {
+          const int sides[2] = { match.side[0], match.side[1] };
+          match.winner = -1;
+          match.turns = 0;
+
+          std::unique_ptr<ofstream> log_file;
+          std::unique_ptr<match_log::LogWriter> log;
+          if(!settings.record.empty())
+          {
+               const match_log::MatchSettings log_settings = { settings.bots_per_player, settings.skill_points, settings.length, settings.width, settings.obstacles, 2, match.seed };
+               log_file.reset(new ofstream(settings.record+"/match_"+std::to_string(match.id)+".log",std::ios::binary));
+               log.reset(new match_log::LogWriter(*log_file,log_settings));
+          }
+          match_log::LogWriter* const recorder = log.get();
+
+          //Workers must outlive the simulator, which deletes their robots
+          const std::function<Robot*(int)>& construct = settings.construct;
+          RoboSim::RobotFactory make = [sides,&construct](int player) { return construct(sides[player-1]); };
+          std::unique_ptr<RobotWorkers> workers;
+          if(settings.isolate >= 0)
+          {
+               workers.reset(new RobotWorkers(make,settings.length,settings.width,settings.isolate));
+               make = workers->factory();
+          }
+
+          try
+          {
+               RoboSim sim(settings.bots_per_player,settings.skill_points,settings.length,settings.width,settings.obstacles,2,
+                           [make,recorder](int player) -> Robot*
+                           {
+                                Robot* robot = make(player);
+                                return recorder ? new match_log::RecordingRobot(robot,*recorder) : robot;
+                           },
+                           match.seed);
+               int winner = -1;
+               while(winner==-1 && match.turns < settings.max_turns)
+               {
+                    winner = sim.executeSingleTimeStep();
+                    match.turns++;
+               }
+               if(winner==-1)
+                    match.note = "turn limit";
+               else if(winner==RoboSim::NO_SURVIVORS)
+                    match.note = "no survivors";
+               else
+                    match.winner = winner-1;
+          }
+          catch(RoboSimExecutionException e)
+          {
+               //A robot that breaks the rules forfeits
+               if(e.player==1 || e.player==2)
+                    match.winner = 2-e.player;
+               match.note = e.msg;
+          }
+          catch(...)
+          {
+               match.note = "unexpected exception";
+          }
+     }
+
+     void playAll(const Settings& settings, ThreadPool& pool, vector<Match>& matches, int first)
+     {
+          for(int i=first; i<int(matches.size()); i++)
+          {
+               Match* match = &matches[i];
+               pool.submit([&settings,match] { playMatch(settings,*match); });
+          }
+          pool.wait();
+     }
+
+     /**Updates standings with the results of matches[first...], in match
+      * order so ratings don't depend on which thread finished first*/
+     void tally(vector<Standing>& standings, const vector<Match>& matches, int first)
+     {
+          for(int i=first; i<int(matches.size()); i++)
+          {
+               const Match& match = matches[i];
+               Standing& a = standings[match.side[0]-1];
+               Standing& b = standings[match.side[1]-1];
+               a.games++;
+               b.games++;
+               a.opponents.push_back(b.player);
+               b.opponents.push_back(a.player);
+
+               double a_score;
+               if(match.winner==-1)
+               {
+                    a.draws++;
+                    b.draws++;
+                    a_score = 0.5;
+               }
+               else if(match.winner==0)
+               {
+                    a.wins++;
+                    b.losses++;
+                    a_score = 1;
+               }
+               else
+               {
+                    a.losses++;
+                    b.wins++;
+                    a_score = 0;
+               }
+               a.score += a_score;
+               b.score += 1-a_score;
+
+               const double expected = 1/(1+std::pow(10.0,(b.elo-a.elo)/400));
+               a.elo += ELO_K*(a_score-expected);
+               b.elo -= ELO_K*(a_score-expected);
+          }
+     }
+
+     void addGames(const Settings& settings, vector<Match>& matches, int round, int p1, int p2)
+     {
+          for(int g=0; g<settings.games; g++)
+          {
+               Match match = Match();
+               match.id = matches.size();
+               match.round = round;
+
+               //Alternate who moves first
+               match.side[0] = g%2 ? p2 : p1;
+               match.side[1] = g%2 ? p1 : p2;
+               match.seed = matchSeed(settings.seed,match.id);
+               matches.push_back(match);
+          }
+     }
+
+     /**Pairs players with similar scores who haven't met yet, if possible.
+      * With an odd number of players, the lowest-ranked one sits out.*/
+     void pairSwissRound(const Settings& settings, const vector<Standing>& standings, vector<Match>& matches, int round)
+     {
+          vector<int> order(settings.roster);
+          std::stable_sort(order.begin(),order.end(),[&standings](int a, int b)
+                           {
+                                const Standing& x = standings[a-1];
+                                const Standing& y = standings[b-1];
+                                return x.score!=y.score ? x.score > y.score : x.elo > y.elo;
+                           });
+
+          vector<bool> paired(order.size());
+          for(int i=0; i<int(order.size()); i++)
+          {
+               if(paired[i])
+                    continue;
+
+               int opponent = -1;
+               for(int j=i+1; j<int(order.size()); j++)
+                    if(!paired[j])
+                    {
+                         const vector<int>& met = standings[order[i]-1].opponents;
+                         if(opponent==-1)
+                              opponent = j;
+                         if(std::find(met.begin(),met.end(),order[j])==met.end())
+                         {
+                              opponent = j;
+                              break;
+                         }
+                    }
+               if(opponent==-1)
+                    break;
+
+               paired[i] = paired[opponent] = true;
+               addGames(settings,matches,round,order[i],order[opponent]);
+          }
+     }
+
+     void writeMatches(ostream& out, const vector<Match>& matches)
+     {
+          out << "match,round,player1,player2,seed,winner,turns,note" << endl;
+          for(const Match& x : matches)
+          {
+               string note = x.note;
+               std::replace(note.begin(),note.end(),'"','\'');
+               out << x.id << ',' << x.round << ',' << x.side[0] << ',' << x.side[1] << ',' << x.seed << ','
+                   << (x.winner==-1 ? 0 : x.side[x.winner]) << ',' << x.turns << ",\"" << note << '"' << endl;
+          }
+     }
+
+     void writeStandings(ostream& out, vector<Standing> standings, const Settings& settings)
+     {
+          vector<Standing> entered;
+          for(int player : settings.roster)
+               entered.push_back(standings[player-1]);
+          std::stable_sort(entered.begin(),entered.end(),[](const Standing& a, const Standing& b) { return a.elo > b.elo; });
+
+          out << "player,games,wins,losses,draws,win_rate,elo" << endl;
+          for(const Standing& x : entered)
+               out << x.player << ',' << x.games << ',' << x.wins << ',' << x.losses << ',' << x.draws << ','
+                   << (x.games ? static_cast<double>(x.wins)/x.games : 0) << ',' << static_cast<int>(std::lround(x.elo)) << endl;
+     }
+
+     bool parseRoster(const char* arg, vector<int>& roster)
+     {
+          std::istringstream in(arg);
+          string item;
+          roster.clear();
+          while(std::getline(in,item,','))
+          {
+               const int player = std::atoi(item.c_str());
+               //Whether there's such a player is checked once they're loaded
+               if(player < 1 || std::find(roster.begin(),roster.end(),player)!=roster.end())
+                    return false;
+               roster.push_back(player);
+          }
+          return roster.size() >= 2;
+     }
+
+     bool parseArgs(int argc, const char** argv, Settings& settings)
+     {
+          for(int i=1; i<argc; i++)
+          {
+               if(i+1==argc)
+                    return false;
+               const char* flag = argv[i];
+               const char* value = argv[++i];
+               if(!std::strcmp(flag,"--roster"))
+               {
+                    if(!parseRoster(value,settings.roster))
+                         return false;
+               }
+               else if(!std::strcmp(flag,"--format"))
+               {
+                    if(!std::strcmp(value,"swiss"))
+                         settings.swiss = true;
+                    else if(!std::strcmp(value,"roundrobin"))
+                         settings.swiss = false;
+                    else
+                         return false;
+               }
+               else if(!std::strcmp(flag,"--games"))
+                    settings.games = std::atoi(value);
+               else if(!std::strcmp(flag,"--rounds"))
+                    settings.rounds = std::atoi(value);
+               else if(!std::strcmp(flag,"--threads"))
+                    settings.threads = std::atoi(value);
+               else if(!std::strcmp(flag,"--seed"))
+                    settings.seed = std::strtoull(value,NULL,10);
+               else if(!std::strcmp(flag,"--max-turns"))
+                    settings.max_turns = std::atoi(value);
+               else if(!std::strcmp(flag,"--length"))
+                    settings.length = std::atoi(value);
+               else if(!std::strcmp(flag,"--width"))
+                    settings.width = std::atoi(value);
+               else if(!std::strcmp(flag,"--skill"))
+                    settings.skill_points = std::atoi(value);
+               else if(!std::strcmp(flag,"--bots"))
+                    settings.bots_per_player = std::atoi(value);
+               else if(!std::strcmp(flag,"--obstacles"))
+                    settings.obstacles = std::atoi(value);
+               else if(!std::strcmp(flag,"--csv"))
+                    settings.csv = value;
+               else if(!std::strcmp(flag,"--record"))
+                    settings.record = value;
+               else if(!std::strcmp(flag,"--isolate"))
+               {
+                    settings.isolate = std::atoi(value);
+                    if(settings.isolate < 0)
+                         return false;
+               }
+               else if(!std::strcmp(flag,"--plugins"))
+               {
+                    std::istringstream in(value);
+                    string path;
+                    while(std::getline(in,path,','))
+                         if(!path.empty())
+                              settings.plugins.push_back(path);
+               }
+               else if(!std::strcmp(flag,"--plugin-roster"))
+                    settings.plugin_roster = value;
+               else
+                    return false;
+          }
+
+          return settings.games > 0 && settings.max_turns > 0;
+     }
+
+     /**Loads the player types given as plugins, if any, then fills in
+      * the roster
+      * @return whether there are enough player types for the roster*/
+     bool choosePlayers(Settings& settings, RobotPlugins& plugins)
+     {
+          if(!settings.plugins.empty() || !settings.plugin_roster.empty())
+          {
+               for(const string& path : settings.plugins)
+                    plugins.load(path);
+               if(!settings.plugin_roster.empty())
+                    plugins.loadRoster(settings.plugin_roster);
+               settings.players = plugins.players();
+               settings.construct = plugins.factory();
+          }
+
+          if(settings.roster.empty())
+               for(int i=1; i<=settings.players; i++)
+                    settings.roster.push_back(i);
+          if(settings.rounds <= 0)
+               settings.rounds = settings.roster.size()-1;
+          return settings.roster.size() >= 2 && *std::max_element(settings.roster.begin(),settings.roster.end()) <= settings.players;
+     }
+}
+
+int main(int argc, const char** argv)
+{
+     Settings settings;
+     RobotPlugins plugins;
+     bool valid = parseArgs(argc,argv,settings);
+     try
+     {
+          valid = valid && choosePlayers(settings,plugins);
+     }
+     catch(RoboSimExecutionException e)
+     {
+          cerr << e.msg << endl;
+          return 1;
+     }
+     if(!valid)
+     {
+          cerr << "Usage: " << argv[0] << " [--roster 1,2,...] [--format roundrobin|swiss] [--games N] [--rounds N]\n"
+               << "       [--threads N] [--seed N] [--max-turns N] [--length N] [--width N] [--skill N]\n"
+               << "       [--bots N] [--obstacles N] [--csv FILE] [--record DIR] [--isolate MS]\n"
+               << "       [--plugins A.so,B.so,...] [--plugin-roster FILE]" << endl;
+          return 1;
+     }
+
+     vector<Standing> standings(settings.players);
+     for(int i=0; i<int(standings.size()); i++)
+          standings[i].player = i+1;
+
+     vector<Match> matches;
+     ThreadPool pool(settings.threads);
+     if(!settings.swiss)
+     {
+          for(int i=0; i<int(settings.roster.size()); i++)
+               for(int j=i+1; j<int(settings.roster.size()); j++)
+                    addGames(settings,matches,0,settings.roster[i],settings.roster[j]);
+          playAll(settings,pool,matches,0);
+          tally(standings,matches,0);
+     }
+     else
+          for(int round=0; round<settings.rounds; round++)
+          {
+               const int first = matches.size();
+               pairSwissRound(settings,standings,matches,round);
+               playAll(settings,pool,matches,first);
+               tally(standings,matches,first);
+          }
+
+     if(!settings.csv.empty())
+     {
+          ofstream out(settings.csv);
+          writeMatches(out,matches);
+          if(!out)
+               cerr << "Could not write " << settings.csv << endl;
+     }
+     writeStandings(cout,standings,settings);
+     return 0;
+}
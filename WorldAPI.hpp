@@ -1,4 +1,6 @@
 #include "robot_api.hpp"
+#include "GridView.hpp"
+#include "WorldSnapshot.hpp"
 
 using namespace robot_api;
 
@@ -7,7 +9,12 @@ using namespace robot_api;
  * Provides callbacks into Simulator so your Robot can take actions in the
  * virtual world.<br>
  * The underlying class type is an inner class defined inside the simulator
- * which is opaque to your robot.
+ * which is opaque to your robot.<br>
+ * Each action comes in two forms: one that throws a
+ * RoboSimExecutionException if the simulator refuses the action, and a
+ * try_* form that returns an ActionResult saying whether (and why) it was
+ * refused instead.  The try_* forms are cheaper when refusals are
+ * expected, e.g. when probing whether an attack or move is possible.
  */
 class WorldAPI
 {
@@ -23,7 +30,16 @@ public:
       * @return AttackResult indicating whether attack succeeded and/or
       *         destroyed target of attack.
       */
-     virtual AttackResult meleeAttack(int power, GridCell& adjacent_cell)=0;
+     AttackResult meleeAttack(int power, GridCell& adjacent_cell)
+          {
+               AttackResult to_return;
+               try_meleeAttack(power,adjacent_cell,to_return).raise();
+               return to_return;
+          }
+
+     /**Same as meleeAttack(), but doesn't throw
+      * @param result set to the result of the attack, if it was made*/
+     virtual ActionResult try_meleeAttack(int power, GridCell& adjacent_cell, AttackResult& result)=0;
 
      /**
       * Ranged attack: attack nonadjacent grid cell within certain range
@@ -32,20 +48,41 @@ public:
       * @return AttackResult indicating whether attack succeeded and/or
       *         destroyed target of attack.
       */
-     virtual AttackResult rangedAttack(int power, GridCell& nonadjacent_cell)=0;
+     AttackResult rangedAttack(int power, GridCell& nonadjacent_cell)
+          {
+               AttackResult to_return;
+               try_rangedAttack(power,nonadjacent_cell,to_return).raise();
+               return to_return;
+          }
+
+     /**Same as rangedAttack(), but doesn't throw
+      * @param result set to the result of the attack, if it was made*/
+     virtual ActionResult try_rangedAttack(int power, GridCell& nonadjacent_cell, AttackResult& result)=0;
 
      /**
       * Capsule attack: attack with a capsule
       * @param power_of_capsule power of the capsule to use in the attack
       * @param cell GridCell (may be adjacent or nonadjacent) to attack
       */
-     virtual AttackResult capsuleAttack(int power_of_capsule, GridCell& cell)=0;
+     AttackResult capsuleAttack(int power_of_capsule, GridCell& cell)
+          {
+               AttackResult to_return;
+               try_capsuleAttack(power_of_capsule,cell,to_return).raise();
+               return to_return;
+          }
+
+     /**Same as capsuleAttack(), but doesn't throw
+      * @param result set to the result of the attack, if it was made*/
+     virtual ActionResult try_capsuleAttack(int power_of_capsule, GridCell& cell, AttackResult& result)=0;
 
      /**
       * Defend: increase defense
       * @param power power to use for defense (may not exceed defense skill)
       */
-     virtual void defend(int power)=0;
+     void defend(int power) { try_defend(power).raise(); }
+
+     /**Same as defend(), but doesn't throw*/
+     virtual ActionResult try_defend(int power)=0;
 
      /*/**********************************************
       * Movement Methods
@@ -56,21 +93,30 @@ public:
       * @param steps how far to move
       * @param way which way to move
       */
-     virtual void move(int steps, Direction way)=0;
+     void move(int steps, Direction way) { try_move(steps,way).raise(); }
+
+     /**Same as move(), but doesn't throw*/
+     virtual ActionResult try_move(int steps, Direction way)=0;
 
      /**
       * pick_up_capsule: pick up a capsule
       * @param adjacent_cell GridCell where capsule is that you want to pick
       *                      up (must be adjacent)
       */
-     virtual void pick_up_capsule(GridCell& adjacent_cell)=0;
+     void pick_up_capsule(GridCell& adjacent_cell) { try_pick_up_capsule(adjacent_cell).raise(); }
+
+     /**Same as pick_up_capsule(), but doesn't throw*/
+     virtual ActionResult try_pick_up_capsule(GridCell& adjacent_cell)=0;
 
      /**
       * drop_capsule: drop a capsule (for an ally to pick up, presumably)
       * @param adjacent_cell where to drop capsule (must be adjacent)
       * @param power_of_capsule how powerful a capsule to drop
       */
-     virtual void drop_capsule(GridCell& adjacent_cell, int power_of_capsule)=0;
+     void drop_capsule(GridCell& adjacent_cell, int power_of_capsule) { try_drop_capsule(adjacent_cell,power_of_capsule).raise(); }
+
+     /**Same as drop_capsule(), but doesn't throw*/
+     virtual ActionResult try_drop_capsule(GridCell& adjacent_cell, int power_of_capsule)=0;
 
      /*/**********************************************
       * Construction Methods
@@ -108,7 +154,10 @@ public:
       * @param location where to direct our building efforts.  Must be an
       *                 adjacent, empty location, or null if status=capsule.
       */
-     virtual void setBuildTarget(BuildStatus status, GridCell* location)=0;
+     void setBuildTarget(BuildStatus status, GridCell* location) { try_setBuildTarget(status,location).raise(); }
+
+     /**Same as setBuildTarget(BuildStatus,GridCell*), but doesn't throw*/
+     virtual ActionResult try_setBuildTarget(BuildStatus status, GridCell* location)=0;
 
      /**
       * Tells the simulator the robot is beginning to build something in an
@@ -128,26 +177,39 @@ public:
       * @param creation_message message to send to newly created robot
       *                         (if we're finalizing one)
       */
-     virtual void setBuildTarget(BuildStatus status, GridCell* location, vector<uint8_t> message)=0;
+     void setBuildTarget(BuildStatus status, GridCell* location, vector<uint8_t> message) { try_setBuildTarget(status,location,message).raise(); }
+
+     /**Same as setBuildTarget(BuildStatus,GridCell*,vector<uint8_t>), but
+      * doesn't throw*/
+     virtual ActionResult try_setBuildTarget(BuildStatus status, GridCell* location, const vector<uint8_t>& message)=0;
 
      /**@param power how much power to apply to building the current target.
       *              Must not be more than remaining power needed to finish
       *              building target.
       */
-     virtual void build(int power)=0;
+     void build(int power) { try_build(power).raise(); }
+
+     /**Same as build(), but doesn't throw*/
+     virtual ActionResult try_build(int power)=0;
 
      /**
       * Spend power to repair yourself.  2 power restores 1 health.
       * @param power amount of power to spend on repairs.  Should be even.
       */
-     virtual void repair(int power)=0;
+     void repair(int power) { try_repair(power).raise(); }
+
+     /**Same as repair(), but doesn't throw*/
+     virtual ActionResult try_repair(int power)=0;
 
      /**
       * Spend power to charge an adjacent ally robot.  1-for-1 efficiency.
       * @param power amount of power to use for charging ally
       * @param ally cell containing ally to charge.  Must be adjacent.
       */
-     virtual void charge(int power, GridCell& ally)=0;
+     void charge(int power, GridCell& ally) { try_charge(power,ally).raise(); }
+
+     /**Same as charge(), but doesn't throw*/
+     virtual ActionResult try_charge(int power, GridCell& ally)=0;
 
      /*/**********************************************
       * Radio Methods
@@ -168,7 +230,10 @@ public:
       * @param message 64-byte array containing message to transmit
       * @param power amount of power to use for sending message
       */
-     virtual void sendMessage(vector<uint8_t> message, int power)=0;
+     void sendMessage(vector<uint8_t> message, int power) { try_sendMessage(message,power).raise(); }
+
+     /**Same as sendMessage(), but doesn't throw*/
+     virtual ActionResult try_sendMessage(const vector<uint8_t>& message, int power)=0;
 
      /**
       * Gets a copy of the portion of the world visible to the robot.
@@ -178,6 +243,14 @@ public:
       */
      virtual vector<vector<GridCell> > getVisibleNeighborhood()=0;
 
+     /**
+      * Same as getVisibleNeighborhood(), but returns a read-only view of
+      * the world instead of copying it.  Does not cost any power.
+      * @return view of the cells visible to the robot, valid until act()
+      *         returns
+      */
+     virtual GridView getVisibleNeighborhoodView()=0;
+
      /**
       * Gets a copy of the entire world.  Takes 3 power, plus additional if
       * jamming is taking place (which won't be; jamming is not implemented).
@@ -188,6 +261,24 @@ public:
       */
      virtual vector<vector<GridCell> > getWorld(int power)=0;
 
+     /**
+      * Same as getWorld(), but returns a read-only view of the world
+      * instead of copying it.  Costs the same as getWorld().
+      * @param power to spend attempting to get the world
+      * @return view of the entire world, valid until act() returns
+      */
+     virtual GridView getWorldView(int power)=0;
+
+     /**
+      * Same as getWorld(), but returns an immutable snapshot of the world
+      * shared with any allies that asked for it since the world last
+      * changed, instead of a private copy.  Costs the same as getWorld().
+      * @param power to spend attempting to get the world
+      * @return snapshot of the entire world, which stays valid for as long
+      *         as it is kept
+      */
+     virtual WorldSnapshot getWorldSnapshot(int power)=0;
+
      /**
       * Scans an enemy (or ally), retrieving information about the robot.
       * The cell scanned must be visible (within defense cells from us).<br>
@@ -196,7 +287,10 @@ public:
       * @param enemyStatus empty Robot_Status object to be filled in
       * @param toScan cell containing robot we want to scan
       */
-     virtual void scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)=0;
+     void scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan) { try_scanEnemy(enemySpecs,enemyStatus,toScan).raise(); }
+
+     /**Same as scanEnemy(), but doesn't throw*/
+     virtual ActionResult try_scanEnemy(Robot_Specs& enemySpecs, Robot_Status& enemyStatus, GridCell toScan)=0;
 
      /**
       * Jams radio.  Affects both allies and enemies.  Also affects self, so
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "robot_api.hpp"
+#include "RobotTable.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace robot_api
+{
+     using std::uint8_t;
+     using std::uint16_t;
+     using std::vector;
+
+     /**
+      * WorldGrid: packed storage for the simulator's world.<br>
+      * Cells are numbered column by column (x-major, so the cell at [x][y]
+      * has index x*width+y, matching the memory order of the old
+      * vector<vector<GridCell> >) and stored in a four-byte encoding.  The
+      * occupant of each cell lives in a separate plane so that searches
+      * which only care about contents never touch it.  Occupants are
+      * stored as slots in the simulator's RobotTable, not pointers, so the
+      * plane stays valid when the table is copied.<br>
+      * Both planes are split into fixed-size chunks shared copy-on-write,
+      * so copying a grid (as RoboSim::fork() does) copies only the chunk
+      * pointers, and each copy pays for the chunks it later changes.<br>
+      * Only RoboSim can modify the grid.
+      */
+     class WorldGrid
+     {
+     public:
+          /**Packed representation of a single cell.*/
+          struct PackedCell
+          {
+               /**bits 0-3: contents (GridObject), bits 4-5: fort orientation*/
+               uint8_t state;
+
+               /**health of the wall or fort in the cell (0 if none)*/
+               uint8_t wallforthealth;
+
+               /**power of the capsule in the cell (saturates at 65535)*/
+               uint16_t capsule_power;
+
+               GridObject contents() const { return GridObject(state & 0xF); }
+               Direction fortOrientation() const { return Direction(state >> 4); }
+          };
+
+          static const int CHUNK_BITS = 12;
+          static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+
+     private:
+          friend class ::RoboSim;
+
+          struct CellChunk { PackedCell cells[CHUNK_SIZE]; };
+          struct OccupantChunk { int robots[CHUNK_SIZE]; };
+
+          int length_;
+          int width_;
+          vector<std::shared_ptr<CellChunk> > cell_chunks;
+          vector<std::shared_ptr<OccupantChunk> > occupant_chunks;
+
+          //Robot table occupants are slots in (set by RoboSim)
+          RobotTable* robots;
+
+          //Bumped on every change to any cell
+          unsigned long long version_;
+
+          //Version of the grid when each chunk last changed
+          vector<unsigned long long> chunk_versions;
+
+          //Bumped whenever a wall or fort appears or disappears
+          unsigned obstacle_version;
+
+          static bool isObstacle(int contents) { return contents==WALL || contents==FORT; }
+
+          const PackedCell& packed(int idx) const { return cell_chunks[idx >> CHUNK_BITS]->cells[idx & (CHUNK_SIZE-1)]; }
+
+          //Makes sure we're the only owner of the chunk before writing to it
+          template<class Chunk>
+          static Chunk& writable(std::shared_ptr<Chunk>& chunk)
+               {
+                    if(chunk.use_count()!=1)
+                         chunk = std::make_shared<Chunk>(*chunk);
+                    return *chunk;
+               }
+
+          PackedCell& writablePacked(int idx) { return writable(cell_chunks[idx >> CHUNK_BITS]).cells[idx & (CHUNK_SIZE-1)]; }
+
+          int occupantIndex(int idx) const { return occupant_chunks[idx >> CHUNK_BITS]->robots[idx & (CHUNK_SIZE-1)]; }
+
+          //Bumps the version after a change to a cell
+          void changed(int idx) { chunk_versions[idx >> CHUNK_BITS] = ++version_; }
+
+     public:
+          WorldGrid() : length_(0), width_(0), robots(NULL), version_(1), obstacle_version(0) { }
+
+          /**
+           * Creates an empty world
+           * @param length length of arena (extent of x coordinate)
+           * @param width width of arena (extent of y coordinate)
+           */
+          WorldGrid(int length, int width) : length_(length), width_(width), robots(NULL), version_(1), obstacle_version(0)
+               {
+                    const int chunks = (length*width + CHUNK_SIZE-1) / CHUNK_SIZE;
+                    for(int i=0; i<chunks; i++)
+                    {
+                         cell_chunks.push_back(std::make_shared<CellChunk>());
+                         for(PackedCell& x : cell_chunks.back()->cells)
+                         {
+                              x.state = EMPTY;
+                              x.wallforthealth = 0;
+                              x.capsule_power = 0;
+                         }
+                         occupant_chunks.push_back(std::make_shared<OccupantChunk>());
+                         for(int& x : occupant_chunks.back()->robots)
+                              x = -1;
+                    }
+                    chunk_versions.assign(chunks,version_);
+               }
+
+          int length() const { return length_; }
+          int width() const { return width_; }
+
+          /**@return total number of cells*/
+          int size() const { return length_*width_; }
+
+          bool inBounds(int x, int y) const { return x >= 0 && x < length_ && y >= 0 && y < width_; }
+
+          /**@return index of cell [x][y] in the packed arrays*/
+          int index(int x, int y) const { return x*width_ + y; }
+          int xOf(int idx) const { return idx / width_; }
+          int yOf(int idx) const { return idx % width_; }
+
+          GridObject contents(int idx) const { return packed(idx).contents(); }
+          GridObject contents(int x, int y) const { return contents(index(x,y)); }
+          Direction fortOrientation(int idx) const { return packed(idx).fortOrientation(); }
+          int wallHealth(int idx) const { return packed(idx).wallforthealth; }
+          int capsulePower(int idx) const { return packed(idx).capsule_power; }
+
+          RobotData* occupant(int idx) const
+               {
+                    const int robot = occupantIndex(idx);
+                    return robot==-1 ? NULL : &robots->inSlot(robot);
+               }
+
+          RobotData* occupant(int x, int y) const { return occupant(index(x,y)); }
+
+          /**@return counter that changes whenever any cell changes (never 0)*/
+          unsigned long long version() const { return version_; }
+
+          /**@return number of chunks the grid is stored in*/
+          int chunks() const { return cell_chunks.size(); }
+
+          /**@return version() as of the last change to any cell in a
+           *         chunk (cells idx with idx/CHUNK_SIZE==chunk)*/
+          unsigned long long chunkVersion(int chunk) const { return chunk_versions[chunk]; }
+
+          /**@return counter that changes whenever a wall or fort is built,
+           *         destroyed, entered or left*/
+          unsigned obstacleVersion() const { return obstacle_version; }
+
+          /**
+           * Materializes a cell, including the simulator-private members.
+           * @param idx index of cell
+           * @return unsanitized copy of the cell
+           */
+          GridCell cell(int idx) const
+               {
+                    GridCell to_return;
+                    to_return.x_coord = xOf(idx);
+                    to_return.y_coord = yOf(idx);
+                    to_return.contents = contents(idx);
+                    to_return.fort_orientation = fortOrientation(idx);
+                    to_return.capsule_power = capsulePower(idx);
+                    to_return.has_private_members = true;
+                    to_return.occupant_data = occupant(idx);
+                    to_return.wallforthealth = wallHealth(idx);
+                    return to_return;
+               }
+
+          GridCell cell(int x, int y) const { return cell(index(x,y)); }
+
+          /**
+           * Adapter for code written against the old vector<vector<GridCell> >
+           * representation of the world.
+           * @param out filled in with a [length][width] unsanitized copy of
+           *            the grid
+           */
+          void exportCells(vector<vector<GridCell> >& out) const
+               {
+                    out.resize(length_);
+                    for(int i=0; i<length_; i++)
+                    {
+                         out[i].resize(width_);
+                         for(int j=0; j<width_; j++)
+                              out[i][j] = cell(i,j);
+                    }
+               }
+
+     private:
+          void setContents(int idx, GridObject contents)
+               {
+                    PackedCell& cell = writablePacked(idx);
+                    if(isObstacle(cell.state & 0xF)!=isObstacle(contents))
+                         obstacle_version++;
+                    cell.state = (cell.state & ~0xF) | contents;
+                    changed(idx);
+               }
+
+          void setFortOrientation(int idx, Direction way)
+               {
+                    PackedCell& cell = writablePacked(idx);
+                    cell.state = (cell.state & 0xF) | (way << 4);
+                    changed(idx);
+               }
+
+          void setWallHealth(int idx, int health)
+               {
+                    writablePacked(idx).wallforthealth = health <= 0 ? 0 : (health > 255 ? 255 : health);
+                    changed(idx);
+               }
+
+          void setCapsulePower(int idx, int power)
+               {
+                    writablePacked(idx).capsule_power = power <= 0 ? 0 : (power > 65535 ? 65535 : power);
+                    changed(idx);
+               }
+
+          void setOccupant(int idx, RobotData* data)
+               {
+                    const int robot = data==NULL ? -1 : data->slot;
+                    if(occupantIndex(idx)==robot)
+                         return;
+                    writable(occupant_chunks[idx >> CHUNK_BITS]).robots[idx & (CHUNK_SIZE-1)] = robot;
+                    changed(idx);
+               }
+     };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Robot.hpp"
+#include "SharedWorld.hpp"
+
+namespace robot_api
+{
+     /**
+      * WorldPublisher: implemented by WorldAPIs that can publish the world
+      * into a SharedWorld themselves, rewriting only what changed, rather
+      * than have it copied out cell by cell through getWorldView().
+      */
+     class WorldPublisher
+     {
+     public:
+          /**Brings shared up to date with the world as the robot the API
+           * belongs to sees it*/
+          virtual void publishWorld(SharedWorld& shared) = 0;
+
+          virtual ~WorldPublisher() { }
+     };
+
+     /**
+      * Brings shared up to date with the world as the robot api belongs to
+      * sees it: through WorldPublisher if api implements it, and otherwise
+      * by copying every cell of getWorldView(3) (which must not throw).
+      */
+     inline void publishWorld(WorldAPI& api, SharedWorld& shared)
+     {
+          if(WorldPublisher* const publisher = dynamic_cast<WorldPublisher*>(&api))
+          {
+               publisher->publishWorld(shared);
+               return;
+          }
+
+          const GridView view = api.getWorldView(3);
+          int self = -1;
+          for(int i=0; i<view.length(); i++)
+               for(int j=0; j<view.width(); j++)
+               {
+                    const int idx = i*view.width() + j;
+                    GridObject contents = view.contents(i,j);
+                    if(contents==SELF)
+                    {
+                         self = idx;
+                         contents = ALLY;
+                    }
+                    const GridCell cell = view.cell(i,j);
+                    WorldGrid::PackedCell packed;
+                    packed.state = contents | cell.fort_orientation << 4;
+                    packed.wallforthealth = 0;
+                    packed.capsule_power = cell.capsule_power;
+                    shared.store(idx,packed);
+               }
+          shared.published(0,0,0);
+
+          const GridView neighborhood = api.getVisibleNeighborhoodView();
+          const SharedWorld::Window window = { neighborhood.xOffset(), neighborhood.yOffset(), neighborhood.length(), neighborhood.width() };
+          shared.setSelf(self,window);
+     }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "robot_api.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace robot_api
+{
+     /**
+      * WorldSnapshot: immutable, sanitized copy of the whole world as seen
+      * by one player.<br>
+      * The simulator builds at most one copy of the world per player for
+      * each state of the world, and every robot of that player asking for
+      * the world before it changes again shares it.  The only thing
+      * particular to the robot holding a snapshot is which cell shows as
+      * SELF, which is overlaid when cells are accessed.<br>
+      * Unlike a GridView, a snapshot stays valid (and unchanged) for as long
+      * as the robot keeps it, even across turns.
+      */
+     class WorldSnapshot
+     {
+     private:
+          std::shared_ptr<const vector<GridCell> > cells;
+          int length_;
+          int width_;
+          int self_index;
+
+     public:
+          WorldSnapshot() : length_(0), width_(0), self_index(-1) { }
+
+          /**
+           * @param cells_ sanitized cells, [x][y] at index x*width+y, with
+           *               every robot shown as either ALLY or ENEMY
+           * @param length_in extent of world in x
+           * @param width_in extent of world in y
+           * @param self_index_ index of cell to show as SELF
+           */
+          WorldSnapshot(std::shared_ptr<const vector<GridCell> > cells_, int length_in, int width_in, int self_index_)
+               : cells(cells_), length_(length_in), width_(width_in), self_index(self_index_) { }
+
+          /**@return whether this snapshot holds a world at all*/
+          bool empty() const { return !cells; }
+
+          int length() const { return length_; }
+          int width() const { return width_; }
+
+          bool inBounds(int x, int y) const { return x >= 0 && x < length_ && y >= 0 && y < width_; }
+
+          /**@return contents of cell [x][y]*/
+          GridObject contents(int x, int y) const
+               {
+                    const int idx = x*width_ + y;
+                    return idx==self_index ? SELF : (*cells)[idx].contents;
+               }
+
+          /**@return copy of cell [x][y]*/
+          GridCell cell(int x, int y) const
+               {
+                    const int idx = x*width_ + y;
+                    GridCell to_return = (*cells)[idx];
+                    if(idx==self_index)
+                         to_return.contents = SELF;
+                    return to_return;
+               }
+
+          /**
+           * Copies the snapshot in the layout getWorld() uses
+           * @param out filled in with a [length][width] copy of the world
+           */
+          void copyTo(vector<vector<GridCell> >& out) const
+               {
+                    out.resize(length_);
+                    for(int i=0; i<length_; i++)
+                         out[i].assign(cells->begin()+i*width_,cells->begin()+(i+1)*width_);
+                    if(self_index!=-1)
+                         out[self_index/width_][self_index%width_].contents = SELF;
+               }
+     };
+}
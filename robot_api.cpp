@@ -1,140 +1,239 @@
 #include "robot_api.hpp"
+#include "GridView.hpp"
 #include "Robot.hpp"
 #include "RoboSim.hpp"
 
-#include <functional>
 #include <list>
-#include <map>
-#include <unordered_map>
+#include <vector>
 
-using std::function;
 using std::list;
-using std::make_pair;
-using std::multimap;
-using std::unordered_map;
 using std::vector;
 
 namespace robot_api
 {
+     string ActionResult::message() const
+     {
+          string text = reason;
+          const string::size_type placeholder = text.find("%d");
+          if(placeholder!=string::npos)
+               text.replace(placeholder,2,std::to_string(detail));
+
+          if(player==0)
+               return text;
+          text = string("Player ")+std::to_string(player)+" "+text;
+          if(cells>=1)
+               text += " with robot at coordinates ["+std::to_string(x1)+"]["+std::to_string(y1)+"]";
+          if(cells>=2)
+               text += ", coordinates of invalid cell are ["+std::to_string(x2)+"]["+std::to_string(y2)+"]";
+          return text;
+     }
+
+     void ActionResult::raiseRefusal() const
+     {
+          RoboSimExecutionException to_throw(message());
+          to_throw.player = player;
+          throw to_throw;
+     }
+
      GridCell* RobotUtility::findNearestAlly(GridCell& origin, vector<vector<GridCell> >& grid)
      {
-          auto path = findShortestPathInternal(origin, RoboSim::SimGridAllyDeterminant{origin}, [](const GridCell& ignored) { return true; }, grid);
+          RoboSim::SimGridAllyDeterminant isAlly{origin};
+          PathSearch& search = PathSearch::forThisThread();
+          const int width = grid[0].size();
+          const int found = findShortestPathInternal(origin,[&](int idx) { return isAlly(grid[idx/width][idx%width]); }, [](int ignored) { return true; }, grid, search);
 
-          if(path.size()==0)
+          if(found==-1)
                return NULL;
           else
-               return *(--path.end());
+               return &grid[found/width][found%width];
      }
 
      list<GridCell*> RobotUtility::findShortestPath(GridCell& origin, const GridCell& target, vector<vector<GridCell> >& grid)
      {
-          return findShortestPathInternal(origin,[&target](const GridCell& maybeTarget)
-                                          {
-                                               //normal == would compare by value;
-                                               //this simulates Java's "same object" test
-                                               //I /think/ compare-by-value would work too here, but why risk it?
-                                               //This is probably faster, anyway.
-                                               return &maybeTarget==&target;
-                                          },
-                                          [](const GridCell& maybePassable)
-                                          {
-                                               return maybePassable.contents==EMPTY;
-                                          }, grid);
-     }
-
-/*TODO: Next up is findShortestPathInternal and the rest of the Robot class.
- * After that, RoboSim class.
- * In RoboSim class, you'll need some sort of preprocessor macro trickery
- * to select the number of players and their classes at compile time.
- */
-     list<GridCell*> RobotUtility::findShortestPathInternal(GridCell& origin, const function<bool(const GridCell&)>& isTarget, const function<bool(const GridCell&)>& isPassable, vector<vector<GridCell> >& grid)
+          vector<GridCell*> path = findShortestPathCells(origin,target,grid);
+          return list<GridCell*>(path.begin(),path.end());
+     }
+
+     vector<GridCell*> RobotUtility::findShortestPathCells(GridCell& origin, const GridCell& target, vector<vector<GridCell> >& grid, PathSearch& search)
      {
-          //Offsets to handle incomplete world map
-          int x_offset = grid[0][0].x_coord;
-          int y_offset = grid[0][0].y_coord;
-                    
-          //Structures to efficiently handle accounting
-          multimap<int,GridCell*> unvisited_nodes;
-          unordered_map<GridCell*,list<GridCell*> > current_costs;
+          return pathCells(findShortestPathTo(origin,target,grid,NULL,search),grid,search);
+     }
+
+     vector<GridCell*> RobotUtility::findShortestPathCells(GridCell& origin, const GridCell& target, vector<vector<GridCell> >& grid, const LandmarkTable& landmarks, PathSearch& search)
+     {
+          return pathCells(findShortestPathTo(origin,target,grid,&landmarks,search),grid,search);
+     }
+
+     vector<Direction> RobotUtility::findShortestPathDirections(GridCell& origin, const GridCell& target, vector<vector<GridCell> >& grid, PathSearch& search)
+     {
+          return pathDirections(findShortestPathTo(origin,target,grid,NULL,search),grid,search);
+     }
+
+     vector<Direction> RobotUtility::findShortestPathDirections(GridCell& origin, const GridCell& target, vector<vector<GridCell> >& grid, const LandmarkTable& landmarks, PathSearch& search)
+     {
+          return pathDirections(findShortestPathTo(origin,target,grid,&landmarks,search),grid,search);
+     }
+
+     void RobotUtility::buildLandmarks(vector<vector<GridCell> >& grid, LandmarkTable& landmarks, int count)
+     {
+          const int width = grid[0].size();
+          landmarks.build(grid.size(),width,count,[&grid,width](int idx)
+                          {
+                               const GridObject contents = grid[idx/width][idx%width].contents;
+                               return contents!=WALL && contents!=FORT;
+                          });
+     }
+
+     vector<GridCell*> RobotUtility::pathCells(int found, vector<vector<GridCell> >& grid, PathSearch& search)
+     {
+          vector<GridCell*> to_return;
+          if(found==-1)
+               return to_return;
+
+          //Walk back from the target to fill in the path
+          const int width = grid[0].size();
+          to_return.resize(search.distanceTo(found));
+          int cell = found;
+          for(int i=to_return.size()-1; i>=0; i--)
+          {
+               to_return[i] = &grid[cell/width][cell%width];
+               cell = search.parentOf(cell);
+          }
+          return to_return;
+     }
 
-          //Origin's shortest path is nothing
-          list<GridCell*> origin_path = {};
+     bool RobotUtility::findNearestAlly(const GridCell& origin, const GridView& view, GridCell& nearest)
+     {
+          const int width = view.width();
+          const int origin_idx = (origin.x_coord - view.xOffset())*width + origin.y_coord - view.yOffset();
+
+          //Views are sanitized, so the robot we're searching for is never ALLY
+          const int found = PathSearch::forThisThread().breadthFirst(view.length(),width,origin_idx,[&view,width,origin_idx](int idx)
+                                                                     {
+                                                                          return idx!=origin_idx && view.contents(idx/width,idx%width)==ALLY;
+                                                                     }, [](int ignored) { return true; });
+          if(found==-1)
+               return false;
+
+          nearest = view.cell(found/width,found%width);
+          return true;
+     }
 
-          //Initialize graph search with origin
-          current_costs[&origin] = origin_path;
-          unvisited_nodes.insert(make_pair(0,&origin));
+     vector<Direction> RobotUtility::findShortestPathDirections(const GridCell& origin, const GridCell& target, const GridView& view, PathSearch& search)
+     {
+          return pathDirections(findShortestPathTo(origin,target,view,NULL,search),view.width(),search);
+     }
+
+     vector<Direction> RobotUtility::findShortestPathDirections(const GridCell& origin, const GridCell& target, const GridView& view, const LandmarkTable& landmarks, PathSearch& search)
+     {
+          return pathDirections(findShortestPathTo(origin,target,view,&landmarks,search),view.width(),search);
+     }
+
+     void RobotUtility::buildLandmarks(const GridView& view, LandmarkTable& landmarks, int count)
+     {
+          const int width = view.width();
+          landmarks.build(view.length(),width,count,[&view,width](int idx)
+                          {
+                               const GridObject contents = view.contents(idx/width,idx%width);
+                               return contents!=WALL && contents!=FORT;
+                          });
+     }
+
+     vector<Direction> RobotUtility::pathDirections(int found, vector<vector<GridCell> >& grid, PathSearch& search)
+     {
+          return pathDirections(found,grid[0].size(),search);
+     }
 
-          while(unvisited_nodes.size()!=0)
+     vector<Direction> RobotUtility::pathDirections(int found, int width, PathSearch& search)
+     {
+          vector<Direction> to_return;
+          if(found==-1)
+               return to_return;
+
+          //Walk back from the target, recording the step into each cell
+          to_return.resize(search.distanceTo(found));
+          int cell = found;
+          for(int i=to_return.size()-1; i>=0; i--)
           {
-               int our_cost;
-               GridCell* our_cell;
-               {
-                    auto current_entry = unvisited_nodes.begin();
-                    our_cost = current_entry->first;
-                    our_cell = current_entry->second;
-                    //Anonymous block because current_entry is dangling iterator after this
-                    unvisited_nodes.erase(current_entry);
-               }
-          
-               list<GridCell*>& current_path = current_costs[our_cell];
-
-               //If we are a destination, algorithm has finished: return our current path
-               if(isTarget(*our_cell))
-                    return current_path;
-
-               /*We are adjacent to up to 4 nodes, with
-                 coordinates relative to ours as follows:
-                 (-1,0),(1,0),(0,-1),(0,1)*/
-               list<GridCell*> adjacent_nodes;
-               int gridX_value = our_cell->x_coord - x_offset;
-               int gridY_value = our_cell->y_coord - y_offset;
-               if(gridX_value!=0)
-                    adjacent_nodes.push_back(&grid[gridX_value-1][gridY_value]);
-               if(gridX_value!=grid.size()-1)
-                    adjacent_nodes.push_back(&grid[gridX_value+1][gridY_value]);
-               if(gridY_value!=0)
-                    adjacent_nodes.push_back(&grid[gridX_value][gridY_value-1]);
-               if(gridY_value!=grid[0].size()-1)
-                    adjacent_nodes.push_back(&grid[gridX_value][gridY_value+1]);
-
-               /*Iterate over adjacent nodes, add to or update
-                 entry in unvisited_nodes and current_costs if
-                 necessary*/
-               for(GridCell* x : adjacent_nodes)
-               {
-                    //If we're not passable, we can't be used as an adjacent cell, unless we're a target
-                    if(!isPassable(*x) && !isTarget(*x))
-                         continue;
-
-                    //Generate proposed path
-                    list<GridCell*> x_proposed_path = current_path;
-                    x_proposed_path.push_back(x);
-
-                    //current least cost path
-                    if(current_costs.count(x))
-                    {
-                         list<GridCell*>& clcp = current_costs[x];
-                         if(clcp.size()-1>our_cost+1)
-                         {
-                              auto old_range = unvisited_nodes.equal_range(clcp.size()-1);
-                              for(auto i = old_range.first; i!=old_range.second; ++i)
-                                   if(i->second==x)
-                                   {
-                                        unvisited_nodes.erase(i);
-                                        break;
-                                   }
-                         }
-                         else
-                              continue;
-                    }
-
-                    unvisited_nodes.insert(make_pair(our_cost+1,x));
-                    current_costs[x]=x_proposed_path;
-               }
+               const int previous = search.parentOf(cell);
+               if(cell==previous-width)
+                    to_return[i] = LEFT;
+               else if(cell==previous+width)
+                    to_return[i] = RIGHT;
+               else if(cell==previous-1)
+                    to_return[i] = UP;
+               else
+                    to_return[i] = DOWN;
+               cell = previous;
           }
+          return to_return;
+     }
+
+     int RobotUtility::findShortestPathTo(GridCell& origin, const GridCell& target, vector<vector<GridCell> >& grid, const LandmarkTable* landmarks, PathSearch& search)
+     {
+          //Offsets to handle incomplete world map
+          const int x_offset = grid[0][0].x_coord;
+          const int y_offset = grid[0][0].y_coord;
+
+          //The target must be a cell of the grid itself (compared by
+          //address, to simulate Java's "same object" test) other than
+          //the origin, or there is no path to it.
+          const int target_x = target.x_coord - x_offset;
+          const int target_y = target.y_coord - y_offset;
+          if(&origin==&target || target_x < 0 || target_x >= int(grid.size()) || target_y < 0 || target_y >= int(grid[0].size()) ||
+             &grid[target_x][target_y]!=&target)
+               return -1;
+
+          const int width = grid[0].size();
+          const int target_idx = target_x*width + target_y;
+          const int origin_idx = (origin.x_coord - x_offset)*width + origin.y_coord - y_offset;
+          if(target_idx==origin_idx)
+               return -1;
+
+          //A table built for some other grid is no use
+          if(landmarks!=NULL && (landmarks->length()!=int(grid.size()) || landmarks->width()!=width))
+               landmarks = NULL;
+
+          return search.aStar(grid.size(),width,origin_idx,target_idx,[&grid,width](int idx)
+                              {
+                                   return grid[idx/width][idx%width].contents==EMPTY;
+                              }, landmarks);
+     }
+
+     int RobotUtility::findShortestPathTo(const GridCell& origin, const GridCell& target, const GridView& view, const LandmarkTable* landmarks, PathSearch& search)
+     {
+          const int origin_x = origin.x_coord - view.xOffset();
+          const int origin_y = origin.y_coord - view.yOffset();
+          const int target_x = target.x_coord - view.xOffset();
+          const int target_y = target.y_coord - view.yOffset();
+          if(!view.inBounds(origin_x,origin_y) || !view.inBounds(target_x,target_y))
+               return -1;
+
+          const int width = view.width();
+          const int target_idx = target_x*width + target_y;
+          const int origin_idx = origin_x*width + origin_y;
+          if(target_idx==origin_idx)
+               return -1;
+
+          //A table built for some other view is no use
+          if(landmarks!=NULL && (landmarks->length()!=view.length() || landmarks->width()!=width))
+               landmarks = NULL;
+
+          return search.aStar(view.length(),width,origin_idx,target_idx,[&view,width](int idx)
+                              {
+                                   return view.contents(idx/width,idx%width)==EMPTY;
+                              }, landmarks);
+     }
+
+     template<class IsTarget, class IsPassable>
+     int RobotUtility::findShortestPathInternal(GridCell& origin, IsTarget isTarget, IsPassable isPassable, vector<vector<GridCell> >& grid, PathSearch& search)
+     {
+          //Offsets to handle incomplete world map
+          const int x_offset = grid[0][0].x_coord;
+          const int y_offset = grid[0][0].y_coord;
+          const int width = grid[0].size();
 
-          /*Loop is over, and we didn't find a path to the target :(
-            Return empty path.*/
-          return list<GridCell*>();
+          const int origin_idx = (origin.x_coord - x_offset)*width + origin.y_coord - y_offset;
+          return search.breadthFirst(grid.size(),width,origin_idx,isTarget,isPassable);
      }
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "GridSearch.hpp"
+#include "CapsuleInventory.hpp"
+
 #include <functional>
 #include <cstdint>
 #include <list>
@@ -7,6 +10,7 @@
 #include <vector>
 
 class Robot;
+class RobotV2;
 class RoboSim;
 
 namespace robot_api
@@ -52,13 +56,12 @@ namespace robot_api
 
           /**
            * Current number and power of capsules.<br>
-           * Each capsule is represented by an element of the list.<br>
-           * The value of the element of the array is equal to the power
-           * of the capsule.<br>
+           * Iterating over it gives the power of each capsule, lowest
+           * first; has() and count() look up capsules by power.<br>
            * In-progress capsules are not represented;
            * use getInvestedBuildPower() for that.
            */
-          list<int> capsules;
+          CapsuleInventory capsules;
      };
 
      /**Represents object located in particular GridCell.*/
@@ -69,6 +72,10 @@ namespace robot_api
 
      class RobotUtility;
      class RobotData;
+     class RobotTable;
+     class WorldGrid;
+     class GridView;
+     class SharedWorld;
      
      /**Represents cell in grid of simulator's world.*/
      struct GridCell
@@ -91,6 +98,9 @@ namespace robot_api
      private:
           friend class ::RoboSim;
           friend class RobotUtility;
+          friend class WorldGrid;
+          friend class GridView;
+          friend class SharedWorld;
 
           bool has_private_members = false;
           RobotData* occupant_data;
@@ -103,20 +113,29 @@ namespace robot_api
      class RobotData
      {
           friend class ::RoboSim;
-          
-          GridCell* assoc_cell;
+          friend class WorldGrid;
+          friend class GridView;
+          friend class RobotTable;
+
+          //Robot's slot in the simulator's RobotTable
+          int slot;
+
+          //Index of robot's cell in world grid
+          int assoc_cell;
           Robot_Specs specs;
           Robot_Status status;
           Robot* robot;
+          RobotV2* robot_v2; //robot, if it implements interface version 2
+          int roster_type; //index of robot's type in player_config.hpp, or -1
           int player;
 
           //Build information
           BuildStatus whatBuilding;
           int investedPower;
-          GridCell* invested_assoc_cell;
+          int invested_assoc_cell; //index in world grid, or -1 if none
 
-          //Buffered radio messages
-          vector<vector<uint8_t>> buffered_radio;
+          //Buffered radio messages (positions in the simulator's RadioPool)
+          vector<int> buffered_radio;
      };
 
      /**Attack type: melee, ranged, or capsule*/
@@ -156,8 +175,9 @@ namespace robot_api
 
           /**Shortest path calculator:<br>
            * Finds the shortest path from one grid cell to another.<br><br>
-           * This uses Dijkstra's algorithm to attempt to find the shortest
-           * path from one grid cell to another.  Cells are adjacent if they
+           * This uses A* with the Manhattan distance as its heuristic to
+           * find the shortest path from one grid cell to another.  Only
+           * empty cells can be crossed.  Cells are adjacent if they
            * are up, down, left, or right of each other.  Cells are
            * <i>not</i> adjacent if they are diagonal to one another.<br>
            * @param origin starting grid cell
@@ -168,35 +188,217 @@ namespace robot_api
            *         could be found in the given grid.
            */
           static std::list<GridCell*> findShortestPath(GridCell& origin, const GridCell& target, std::vector<std::vector<GridCell> >& grid);
+
+          /**Shortest path calculator returning a contiguous path:<br>
+           * Same as findShortestPath(), but doesn't allocate anything other
+           * than the returned vector.
+           * @param search scratch buffers to use for the search (by default,
+           *               ones private to the calling thread)
+           * @return cells on the path, from the cell after the origin to
+           *         the target; empty if no path could be found
+           */
+          static std::vector<GridCell*> findShortestPathCells(GridCell& origin, const GridCell& target, std::vector<std::vector<GridCell> >& grid, PathSearch& search = PathSearch::forThisThread());
+
+          /**Shortest path calculator using landmarks:<br>
+           * Same as findShortestPathCells(), but uses a landmark table built
+           * by buildLandmarks() to sharpen the A* heuristic.  On large maps
+           * this expands far fewer cells.
+           * @param landmarks table built for this grid since the last time
+           *                  a wall or fort was removed from it
+           */
+          static std::vector<GridCell*> findShortestPathCells(GridCell& origin, const GridCell& target, std::vector<std::vector<GridCell> >& grid, const LandmarkTable& landmarks, PathSearch& search = PathSearch::forThisThread());
+
+          /**Shortest path calculator returning directions:<br>
+           * Same as findShortestPath(), but returns the path as the
+           * sequence of single steps to take to follow it.
+           * @param search scratch buffers to use for the search (by default,
+           *               ones private to the calling thread)
+           * @return one Direction per step; empty if no path could be found
+           */
+          static std::vector<Direction> findShortestPathDirections(GridCell& origin, const GridCell& target, std::vector<std::vector<GridCell> >& grid, PathSearch& search = PathSearch::forThisThread());
+
+          /**Same as findShortestPathDirections(), with a landmark table
+           * @see findShortestPathCells(GridCell&,const GridCell&,std::vector<std::vector<GridCell> >&,const LandmarkTable&,PathSearch&)
+           */
+          static std::vector<Direction> findShortestPathDirections(GridCell& origin, const GridCell& target, std::vector<std::vector<GridCell> >& grid, const LandmarkTable& landmarks, PathSearch& search = PathSearch::forThisThread());
+
+          /**Landmark table builder:<br>
+           * Computes a landmark table for a grid, for use with the
+           * findShortestPath*() overloads taking one.  Building it costs
+           * a few breadth-first searches over the whole grid, so it is
+           * worth it when many searches will be run on the same map.  It
+           * must be rebuilt after any wall or fort in the grid is destroyed
+           * (or if the grid is replaced by one where that happened).
+           * @param grid grid to analyze
+           * @param landmarks table to fill in
+           * @param count number of landmarks (each costs 4 bytes per cell)
+           */
+          static void buildLandmarks(std::vector<std::vector<GridCell> >& grid, LandmarkTable& landmarks, int count = 4);
+
+          /**Find nearest neighbor in a view:<br>
+           * Same as findNearestAlly(), but runs directly over a GridView.
+           * @param origin cell to search from (must be inside the view)
+           * @param view view to analyze
+           * @param nearest filled in with the nearest ally, if there is one
+           * @return whether an ally was found
+           */
+          static bool findNearestAlly(const GridCell& origin, const GridView& view, GridCell& nearest);
+
+          /**Shortest path calculator over a view:<br>
+           * Same as findShortestPathDirections(), but runs directly over a
+           * GridView.  Since a view has no cell objects of its own, the
+           * target is identified by its coordinates alone.
+           * @return one Direction per step; empty if no path could be found
+           *         inside the view
+           */
+          static std::vector<Direction> findShortestPathDirections(const GridCell& origin, const GridCell& target, const GridView& view, PathSearch& search = PathSearch::forThisThread());
+
+          /**Same as findShortestPathDirections(const GridCell&,const GridCell&,const GridView&,PathSearch&),
+           * with a landmark table built by buildLandmarks(const GridView&,LandmarkTable&,int)
+           */
+          static std::vector<Direction> findShortestPathDirections(const GridCell& origin, const GridCell& target, const GridView& view, const LandmarkTable& landmarks, PathSearch& search = PathSearch::forThisThread());
+
+          /**Landmark table builder for a view
+           * @see buildLandmarks(std::vector<std::vector<GridCell> >&,LandmarkTable&,int)
+           */
+          static void buildLandmarks(const GridView& view, LandmarkTable& landmarks, int count = 4);
           
      private:
-          static std::list<GridCell*> findShortestPathInternal(GridCell& origin, const std::function<bool(const GridCell&)>& isTarget, const std::function<bool(const GridCell&)>& isPassable, std::vector<std::vector<GridCell> >& grid);
+          template<class IsTarget, class IsPassable>
+          static int findShortestPathInternal(GridCell& origin, IsTarget isTarget, IsPassable isPassable, std::vector<std::vector<GridCell> >& grid, PathSearch& search);
+
+          static int findShortestPathTo(GridCell& origin, const GridCell& target, std::vector<std::vector<GridCell> >& grid, const LandmarkTable* landmarks, PathSearch& search);
+
+          static std::vector<GridCell*> pathCells(int found, std::vector<std::vector<GridCell> >& grid, PathSearch& search);
+          static std::vector<Direction> pathDirections(int found, std::vector<std::vector<GridCell> >& grid, PathSearch& search);
+          static std::vector<Direction> pathDirections(int found, int width, PathSearch& search);
+          static int findShortestPathTo(const GridCell& origin, const GridCell& target, const GridView& view, const LandmarkTable* landmarks, PathSearch& search);
      };
 
      struct RoboSimExecutionException
      {
           string msg;
 
-          RoboSimExecutionException(const string& msg_) : msg(msg_) {}
+          /**player responsible for the error, or 0 if it wasn't a player*/
+          int player;
+
+          RoboSimExecutionException(const string& msg_) : msg(msg_), player(0) {}
 
-          RoboSimExecutionException(const string& msg_, int player)
+          RoboSimExecutionException(const string& msg_, int player_) : player(player_)
                {
                     msg = string("Player ")+std::to_string(player)+" "+msg_;
                }
 
-          RoboSimExecutionException(const string& msg_, int player, const GridCell& cell)
+          RoboSimExecutionException(const string& msg_, int player_, const GridCell& cell) : player(player_)
                {
                     msg = string("Player ")+std::to_string(player)+" "+msg_+" with robot at coordinates ["+std::to_string(cell.x_coord)+"]["+std::to_string(cell.y_coord)+"]";
                }
 
-          RoboSimExecutionException(const string& msg_, int player, const GridCell& cell, const GridCell& cell2)
+          RoboSimExecutionException(const string& msg_, int player_, const GridCell& cell, const GridCell& cell2) : player(player_)
                {
                     msg = string("Player ")+std::to_string(player)+" "+msg_+" with robot at coordinates ["+std::to_string(cell.x_coord)+"]["+std::to_string(cell.y_coord)+"], coordinates of invalid cell are ["+std::to_string(cell2.x_coord)+"]["+std::to_string(cell2.y_coord)+"]";
                }
 
-          RoboSimExecutionException(const string& msg_, int player, int x1, int y1, int x2, int y2)
+          RoboSimExecutionException(const string& msg_, int player_, int x1, int y1, int x2, int y2) : player(player_)
                {
                     msg = string("Player ")+std::to_string(player)+" "+msg_+" with robot at coordinates ["+std::to_string(x1)+"]["+std::to_string(y1)+"], coordinates of invalid cell are ["+std::to_string(x2)+"]["+std::to_string(y2)+"]";
                }
      };
+
+     /**Why the simulator refused an action (or ACTION_OK if it didn't)*/
+     enum ActionStatus
+     {
+          /**Action carried out*/
+          ACTION_OK,
+
+          /**Power out of range for the action, or more than the robot
+           * has left*/
+          INVALID_POWER,
+
+          /**Cell coordinates outside the world*/
+          INVALID_CELL,
+
+          /**Target cell too far away (or, for ranged attacks, too close)*/
+          OUT_OF_RANGE,
+
+          /**Something in the way of the action*/
+          PATH_BLOCKED,
+
+          /**Target cell holds the wrong thing for the action*/
+          INVALID_TARGET,
+
+          /**Robot has no capsule of that power, or no room for another*/
+          CAPSULE_UNAVAILABLE,
+
+          /**Some other argument is malformed (message of the wrong
+           * length, build target that doesn't make sense...)*/
+          INVALID_ARGUMENT,
+
+          /**Robot code failed while a robot was being built*/
+          ROBOT_CREATION_FAILED,
+
+          /**Bug in the simulator*/
+          INTERNAL_ERROR
+     };
+
+     /**
+      * Outcome of a WorldAPI try_* call: whether it succeeded and, if not,
+      * why.<br>
+      * A refusal keeps its reason as a string constant and its context
+      * (player and cells involved) as plain numbers; the human-readable
+      * message is only put together if someone asks for it, so refusals
+      * are cheap to return and to ignore.
+      */
+     class ActionResult
+     {
+     private:
+          ActionStatus status_;
+
+          //Message text; a "%d" in it stands for detail
+          const char* reason;
+          int detail;
+
+          //Player responsible (0 if none), and how many of the cells below
+          //are known: the acting robot's, then the one it acted on
+          int player;
+          int cells;
+          int x1, y1, x2, y2;
+
+     public:
+          /**Success*/
+          ActionResult() : status_(ACTION_OK), reason(""), detail(0), player(0), cells(0), x1(0), y1(0), x2(0), y2(0) { }
+
+          ActionResult(ActionStatus status, const char* reason_) : status_(status), reason(reason_), detail(0), player(0), cells(0), x1(0), y1(0), x2(0), y2(0) { }
+
+          ActionResult(ActionStatus status, const char* reason_, int player_) : status_(status), reason(reason_), detail(0), player(player_), cells(0), x1(0), y1(0), x2(0), y2(0) { }
+
+          ActionResult(ActionStatus status, const char* reason_, int player_, int x, int y) :
+               status_(status), reason(reason_), detail(0), player(player_), cells(1), x1(x), y1(y), x2(0), y2(0) { }
+
+          ActionResult(ActionStatus status, const char* reason_, int player_, int x, int y, int target_x, int target_y) :
+               status_(status), reason(reason_), detail(0), player(player_), cells(2), x1(x), y1(y), x2(target_x), y2(target_y) { }
+
+          /**Sets the number a "%d" in the reason stands for*/
+          ActionResult& withDetail(int detail_) { detail = detail_; return *this; }
+
+          bool ok() const { return status_==ACTION_OK; }
+          explicit operator bool() const { return ok(); }
+
+          ActionStatus status() const { return status_; }
+
+          /**@return message RoboSimExecutionException would carry for this
+           *         refusal*/
+          string message() const;
+
+          /**Throws the RoboSimExecutionException for this refusal, if it
+           * is one*/
+          void raise() const
+               {
+                    if(!ok())
+                         raiseRefusal();
+               }
+
+     private:
+          [[noreturn]] void raiseRefusal() const;
+     };
 }